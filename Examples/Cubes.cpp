@@ -89,14 +89,13 @@ int main(int argc, char **argv) {
 
   auto viewer = Visualizer{};
 
-  for (auto i = 0; i < V.rows(); ++i) {
-    CubeDescriptor vertex;
-    vertex.position = V.row(i).transpose().cast<float>() * 50.f;
-    vertex.color = Colors::White();
-    vertex.scale = 500_um;
-
-    viewer.addGeometry("vertex-" + std::to_string(i), vertex);
-  }
+  // All vertices are rendered with a single instanced draw call. The
+  // positions are given in units of the cube scale.
+  InstancedCubesDescriptor vertices;
+  vertices.positions = V.cast<float>() * 100.f;
+  vertices.color = Colors::White();
+  vertices.scale = 500_um;
+  viewer.addGeometry("vertices", vertices);
 
   viewer.showGrid = true;
   viewer.backgroundColor = (Colors::Magenta() + Colors::Cyan()) / 2.0;
@@ -1,10 +1,7 @@
 #include <VolViz/VolViz.h>
 
 #include <Eigen/Core>
-#include <igl/readOBJ.h>
 #include <igl/readOFF.h>
-#include <igl/readPLY.h>
-#include <igl/readSTL.h>
 
 #include <chrono>
 #include <fstream>
@@ -44,7 +41,6 @@ auto generateVolume() {
 int main(int argc, char **argv) {
   using namespace VolViz;
   using namespace VolViz::literals;
-  using Eigen::Vector3d;
   using Vertices = Eigen::MatrixXd;
   using Triangles = Eigen::MatrixXi;
 
@@ -57,34 +53,34 @@ int main(int argc, char **argv) {
   auto const filename = std::string(argv[1]);
   auto const ext = filename.substr(filename.size() - 3, 3);
   std::cout << "Loading mesh " << argv[1] << "... " << std::flush;
-  Vertices V;
-  Triangles T;
-  if (ext == "off")
-    igl::readOFF(filename, V, T);
-  else if (ext == "ply")
-    igl::readPLY(filename, V, T);
-  else if (ext == "stl") {
-    Vertices N;
-    igl::readSTL(filename, V, T, N);
-  } else if (ext == "obj")
-    igl::readOBJ(filename, V, T);
-  else {
-    std::cerr << std::endl << "Unrecognized mesh format: " << ext << std::endl;
+  MeshDescriptor mesh;
+  try {
+    if (ext == "off") {
+      Vertices V;
+      Triangles T;
+      igl::readOFF(filename, V, T);
+      mesh.vertices = V.cast<float>();
+      mesh.indices = T.cast<std::uint32_t>();
+    } else {
+      mesh = loadMesh(filename);
+    }
+  } catch (std::exception const &e) {
+    std::cerr << std::endl << e.what() << std::endl;
     return EXIT_FAILURE;
   }
   std::cout << "done." << std::endl;
-  std::cout << V.rows() << " vertices, " << T.rows() << " triangles."
-            << std::endl;
+  std::cout << mesh.vertices.rows() << " vertices, " << mesh.indices.rows()
+            << " triangles." << std::endl;
 
-  Eigen::Vector3d const min = V.colwise().minCoeff();
-  Eigen::Vector3d const max = V.colwise().maxCoeff();
+  Eigen::Vector3f const min = mesh.vertices.colwise().minCoeff();
+  Eigen::Vector3f const max = mesh.vertices.colwise().maxCoeff();
 
   Length meshScale = 5_cm;
 
   std::cout << "bbox: " << min.transpose() << " - " << max.transpose()
             << std::endl;
   std::cout << "bbox size: "
-            << ((max - min).transpose() * static_cast<double>(meshScale / 1_mm))
+            << ((max - min).transpose() * static_cast<float>(meshScale / 1_mm))
             << " mm" << std::endl;
 
   //  Eigen::MatrixXd V(3, 3);
@@ -95,9 +91,6 @@ int main(int argc, char **argv) {
   auto viewer = Visualizer{};
 
   // Add mesh
-  MeshDescriptor mesh;
-  mesh.vertices = V.cast<float>();
-  mesh.indices = T.cast<std::uint32_t>();
   mesh.movable = true;
   mesh.scale = 50_mm;
   mesh.color = Colors::White();
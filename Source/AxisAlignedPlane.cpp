@@ -48,37 +48,21 @@ AxisAlignedPlane::AxisAlignedPlane(AxisAlignedPlaneDescriptor const &descriptor,
 
 void AxisAlignedPlane::doInit() {}
 
-void AxisAlignedPlane::doRender(std::uint32_t index, bool selected) {
-  auto const &cameraClient = visualizer_.cameraClient();
-  Length const rScale = visualizer_.cachedScale;
-
-  auto const viewMat = cameraClient.viewMatrix(rScale);
-  auto const destScale = static_cast<float>(scale / rScale);
-  auto const volSize = visualizer_.volumeSize();
-
-  auto const modelMat = (Eigen::Translation3f(position * destScale) *
-                         orientation * volSize.asDiagonal())
-                            .matrix();
-
-  auto const modelViewMat = (viewMat * modelMat).eval();
-  auto const inverseModelViewMatrix =
-      modelViewMat.block<3, 3>(0, 0).inverse().eval();
-
-  auto &shaders = visualizer_.shaders();
+void AxisAlignedPlane::doRender(std::uint32_t, bool) {
+  visualizer_.shaders()[Program::Plane].use();
+  visualizer_.drawSingleVertex();
+}
 
-  shaders["plane"].use();
-  visualizer_.attachVolumeToShader(shaders["plane"]);
-  shaders["plane"]["index"] = index;
-  shaders["plane"]["modelMatrix"] = modelMat;
-  shaders["plane"]["shininess"] = 10.f;
-  shaders["plane"]["color"] = selected ? (color * 1.5f).eval() : color;
-  shaders["plane"]["modelViewProjectionMatrix"] =
-      (cameraClient.projectionMatrix() * modelViewMat).eval();
-  shaders["plane"]["inverseModelViewMatrix"] = inverseModelViewMatrix;
-  shaders["plane"]["textureTransformMatrix"] =
-      visualizer_.textureTransformationMatrix();
+Geometry::RenderState AxisAlignedPlane::doRenderState() const {
+  return {visualizer_.shaders()[Program::Plane].id(), 0};
+}
 
-  visualizer_.drawSingleVertex();
+Matrix4 AxisAlignedPlane::doModelMatrix(Length ambientScale) const {
+  auto const destScale = static_cast<float>(scale / ambientScale);
+  auto const volSize = visualizer_.volumeSize();
+  return (Eigen::Translation3f(position * destScale) * orientation *
+          volSize.asDiagonal())
+      .matrix();
 }
 
 } // namespace Private_
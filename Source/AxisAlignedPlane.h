@@ -16,6 +16,10 @@ protected:
   virtual void doInit() override;
 
   virtual void doRender(std::uint32_t index, bool selected) override;
+
+  virtual RenderState doRenderState() const override;
+
+  virtual Matrix4 doModelMatrix(Length ambientScale) const override;
 };
 
 } // namespace Private_
@@ -0,0 +1,263 @@
+#include "BVH.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <numeric>
+
+namespace VolViz {
+namespace Private_ {
+
+namespace {
+
+/// Number of bins per axis used to evaluate the SAH
+std::size_t constexpr kBins = 16;
+
+/// Nodes with more primitives are always split
+std::uint32_t constexpr kMaxLeafSize = 8;
+
+/// Subtrees with more primitives are built by their own task on the shared
+/// worker pool
+std::uint32_t constexpr kMinParallelPrimitives = 1 << 14;
+
+/// Cost of traversing a node relative to intersecting a primitive
+float constexpr kTraversalCost = 1.f;
+
+inline float surfaceArea(BVH::Box const &box) noexcept {
+  if (box.isEmpty()) return 0.f;
+  Vector3f const d = box.sizes();
+  return 2.f * (d(0) * d(1) + d(1) * d(2) + d(2) * d(0));
+}
+
+} // namespace
+
+constexpr int BVH::kMaxDepth;
+
+/// Builds the nodes recursively. The nodes are preallocated, so that tasks
+/// can build disjoint subtrees concurrently. The children of a node are
+/// allocated as a pair using an atomic counter.
+struct BVH::Builder {
+  Builder(std::vector<Box> const &inputBoxes,
+          CancelFunction const &cancelFunction, std::vector<Node> &outputNodes,
+          std::vector<std::uint32_t> &outputPrimitives)
+      : boxes(inputBoxes), isCancelled(cancelFunction), nodes(outputNodes),
+        primitives(outputPrimitives) {
+    centroids.reserve(boxes.size());
+    for (auto const &box : boxes) centroids.push_back(box.center());
+  }
+
+  std::vector<Box> const &boxes;
+  CancelFunction const &isCancelled;
+  std::vector<Node> &nodes;
+  std::vector<std::uint32_t> &primitives;
+
+  std::vector<Vector3f> centroids;
+  std::atomic<std::uint32_t> nodeCount{1};
+  std::atomic<bool> cancelled{false};
+
+  void build(std::uint32_t nodeIndex, std::uint32_t first, std::uint32_t last,
+             int depth) {
+    auto &node = nodes[nodeIndex];
+    auto const count = last - first;
+
+    Box bounds, centroidBounds;
+    for (auto i = first; i < last; ++i) {
+      bounds.extend(boxes[primitives[i]]);
+      centroidBounds.extend(centroids[primitives[i]]);
+    }
+    for (std::size_t c = 0; c < 3; ++c) {
+      auto const axis = static_cast<Eigen::Index>(c);
+      node.min[c] = bounds.min()(axis);
+      node.max[c] = bounds.max()(axis);
+    }
+    node.first = first;
+    node.count = count;
+
+    if (isCancelled && isCancelled()) cancelled = true;
+    if (count <= 1 || depth >= kMaxDepth || cancelled) return;
+
+    // Find the cheapest split between the bins along any axis
+    auto bestCost = std::numeric_limits<float>::infinity();
+    Eigen::Index bestAxis = -1;
+    std::size_t bestBin = 0;
+    for (Eigen::Index axis = 0; axis < 3; ++axis) {
+      auto const extent =
+          centroidBounds.max()(axis) - centroidBounds.min()(axis);
+      if (!(extent > 0.f)) continue;
+      auto const binScale = static_cast<float>(kBins) / extent;
+      auto const binOf = [&](std::uint32_t primitive) {
+        auto const bin = static_cast<std::size_t>(
+            (centroids[primitive](axis) - centroidBounds.min()(axis)) *
+            binScale);
+        return std::min(bin, kBins - 1);
+      };
+
+      std::array<Box, kBins> binBoxes;
+      std::array<std::uint32_t, kBins> binCounts{};
+      for (auto i = first; i < last; ++i) {
+        auto const bin = binOf(primitives[i]);
+        binBoxes[bin].extend(boxes[primitives[i]]);
+        ++binCounts[bin];
+      }
+
+      // sweep from the right to get the cost of the right sides
+      std::array<float, kBins> rightCosts;
+      Box right;
+      std::uint32_t rightCount = 0;
+      for (auto bin = kBins - 1; bin > 0; --bin) {
+        right.extend(binBoxes[bin]);
+        rightCount += binCounts[bin];
+        rightCosts[bin] = static_cast<float>(rightCount) * surfaceArea(right);
+      }
+      Box left;
+      std::uint32_t leftCount = 0;
+      for (std::size_t bin = 0; bin + 1 < kBins; ++bin) {
+        left.extend(binBoxes[bin]);
+        leftCount += binCounts[bin];
+        auto const cost =
+            static_cast<float>(leftCount) * surfaceArea(left) +
+            rightCosts[bin + 1];
+        if (leftCount > 0 && leftCount < count && cost < bestCost) {
+          bestCost = cost;
+          bestAxis = axis;
+          bestBin = bin;
+        }
+      }
+    }
+
+    auto const leafCost = static_cast<float>(count) * surfaceArea(bounds);
+    auto const splitCost = kTraversalCost * surfaceArea(bounds) + bestCost;
+    if (count <= kMaxLeafSize && !(splitCost < leafCost)) return;
+
+    auto middle = first + count / 2;
+    if (bestAxis >= 0) {
+      auto const binScale =
+          static_cast<float>(kBins) / (centroidBounds.max()(bestAxis) -
+                                       centroidBounds.min()(bestAxis));
+      auto const split = std::partition(
+          primitives.begin() + first, primitives.begin() + last,
+          [&](std::uint32_t primitive) {
+            auto const bin = static_cast<std::size_t>(
+                (centroids[primitive](bestAxis) -
+                 centroidBounds.min()(bestAxis)) *
+                binScale);
+            return std::min(bin, kBins - 1) <= bestBin;
+          });
+      middle = static_cast<std::uint32_t>(split - primitives.begin());
+    } else if (count <= kMaxLeafSize) {
+      // all centroids are equal and there are few primitives
+      return;
+    }
+
+    auto const children = nodeCount.fetch_add(2);
+    node.first = children;
+    node.count = 0;
+
+    if (count >= kMinParallelPrimitives) {
+      // the pool bounds the threads of all BVHs built at the same time
+      WorkerPool::shared().invoke(
+          [=]() { build(children, first, middle, depth + 1); },
+          [=]() { build(children + 1, middle, last, depth + 1); });
+    } else {
+      build(children, first, middle, depth + 1);
+      build(children + 1, middle, last, depth + 1);
+    }
+  }
+};
+
+BVH::BVH(std::vector<Box> const &boxes, CancelFunction const &isCancelled) {
+  if (boxes.empty()) return;
+  Expects(boxes.size() < std::numeric_limits<std::uint32_t>::max() / 2);
+
+  // a binary tree with n leaves has 2n - 1 nodes
+  nodes_.resize(2 * boxes.size() - 1);
+  primitives_.resize(boxes.size());
+  std::iota(primitives_.begin(), primitives_.end(), 0u);
+
+  Builder builder(boxes, isCancelled, nodes_, primitives_);
+
+  builder.build(0, 0, static_cast<std::uint32_t>(boxes.size()), 0);
+  if (builder.cancelled) {
+    nodes_.clear();
+    primitives_.clear();
+    return;
+  }
+  nodes_.resize(builder.nodeCount);
+  nodes_.shrink_to_fit();
+}
+
+BVH::Box BVH::bounds() const noexcept {
+  if (nodes_.empty()) return Box();
+  auto const &root = nodes_.front();
+  return Box(Position(root.min[0], root.min[1], root.min[2]),
+             Position(root.max[0], root.max[1], root.max[2]));
+}
+
+namespace {
+
+std::vector<BVH::Box>
+triangleBoxes(TriangleBVH::Vertices const &vertices,
+              TriangleBVH::Indices const &indices) {
+  std::vector<BVH::Box> boxes(static_cast<std::size_t>(indices.rows()));
+  for (Eigen::Index t = 0; t < indices.rows(); ++t) {
+    auto &box = boxes[static_cast<std::size_t>(t)];
+    for (Eigen::Index c = 0; c < 3; ++c) {
+      auto const v = static_cast<Eigen::Index>(indices(t, c));
+      box.extend(vertices.row(v).transpose());
+    }
+  }
+  return boxes;
+}
+
+} // namespace
+
+TriangleBVH::TriangleBVH(Vertices const &vertices, Indices const &indices,
+                         BVH::CancelFunction const &isCancelled)
+    : vertices_(vertices.transpose()), indices_(indices.transpose()),
+      bvh_(triangleBoxes(vertices, indices), isCancelled) {
+  Expects(indices.rows() == 0 ||
+          static_cast<Eigen::Index>(indices.maxCoeff()) < vertices.rows());
+}
+
+bool TriangleBVH::intersect(Ray const &ray, float maxDistance,
+                            Hit &hit) const noexcept {
+  // Moeller-Trumbore ray triangle intersection
+  float constexpr kEpsilon = 1e-12f;
+
+  bool found = false;
+  bvh_.traverse(ray, maxDistance, [&](std::uint32_t triangle, float &tMax) {
+    auto const t = static_cast<Eigen::Index>(triangle);
+    auto const vertex = [&](Eigen::Index c) {
+      return vertices_.col(static_cast<Eigen::Index>(indices_(c, t)));
+    };
+    Position const v0 = vertex(0);
+    Position const e1 = vertex(1) - v0;
+    Position const e2 = vertex(2) - v0;
+
+    Position const p = ray.direction.cross(e2);
+    auto const determinant = e1.dot(p);
+    if (std::abs(determinant) < kEpsilon) return;
+    auto const inverseDeterminant = 1.f / determinant;
+
+    Position const s = ray.origin - v0;
+    auto const u = s.dot(p) * inverseDeterminant;
+    if (u < 0.f || u > 1.f) return;
+    Position const q = s.cross(e1);
+    auto const v = ray.direction.dot(q) * inverseDeterminant;
+    if (v < 0.f || u + v > 1.f) return;
+
+    auto const distance = e2.dot(q) * inverseDeterminant;
+    if (distance < 0.f || distance >= tMax) return;
+
+    tMax = distance;
+    hit.triangle = triangle;
+    hit.distance = distance;
+    hit.barycentrics = Eigen::Vector2f(u, v);
+    found = true;
+  });
+  return found;
+}
+
+} // namespace Private_
+} // namespace VolViz
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "Types.h"
+
+#include <Eigen/Geometry>
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace VolViz {
+namespace Private_ {
+
+/// A ray given by its origin and direction. The direction does not need to be
+/// normalized, distances along the ray are measured in multiples of it. Thus
+/// distances stay the same if the ray is transformed by an affine
+/// transformation.
+struct Ray {
+  Position origin;
+  Position direction;
+};
+
+/// Bounding volume hierarchy over axis aligned boxes, built top down using
+/// the surface area heuristic (SAH) with binning. Large subtrees are built in
+/// parallel.
+class BVH {
+public:
+  using Box = Eigen::AlignedBox3f;
+  /// Returns true, if the build should be aborted, e.g. because the result is
+  /// not needed anymore. The hierarchy is empty then.
+  using CancelFunction = std::function<bool()>;
+
+  BVH() = default;
+
+  explicit BVH(std::vector<Box> const &boxes,
+               CancelFunction const &isCancelled = {});
+
+  inline bool empty() const noexcept { return nodes_.empty(); }
+
+  /// Bounding box of all primitives
+  Box bounds() const noexcept;
+
+  /// Visits the leaves hit by the ray closer than maxDistance, front to back.
+  /// For each primitive of a visited leaf, intersect(primitive, maxDistance)
+  /// is called, which decreases maxDistance if it hits the primitive.
+  template <class F>
+  void traverse(Ray const &ray, float &maxDistance, F &&intersect) const;
+
+private:
+  struct Builder;
+
+  struct Node {
+    std::array<float, 3> min;
+    /// Index of the first primitive of a leaf or of the left child of an
+    /// inner node. The right child directly follows the left one.
+    std::uint32_t first;
+    std::array<float, 3> max;
+    /// Number of primitives of a leaf, 0 for inner nodes
+    std::uint32_t count;
+  };
+  static_assert(sizeof(Node) == 32, "Unexpected BVH node size");
+
+  /// Maximal depth of the hierarchy, bounds the traversal stack
+  static constexpr int kMaxDepth = 48;
+
+  /// Returns the distance at which the ray enters the box of the node, or
+  /// infinity if it misses the box or enters it behind maxDistance
+  static inline float entryDistance(Node const &node, Position const &origin,
+                                    Position const &inverseDirection,
+                                    float maxDistance) noexcept {
+    float tEnter = 0.f, tExit = maxDistance;
+    for (Eigen::Index c = 0; c < 3; ++c) {
+      auto const i = static_cast<std::size_t>(c);
+      auto t0 = (node.min[i] - origin(c)) * inverseDirection(c);
+      auto t1 = (node.max[i] - origin(c)) * inverseDirection(c);
+      if (t0 > t1) std::swap(t0, t1);
+      // written such that NaNs, i.e. rays within a slab, are ignored
+      tEnter = t0 > tEnter ? t0 : tEnter;
+      tExit = t1 < tExit ? t1 : tExit;
+    }
+    return tEnter <= tExit ? tEnter : std::numeric_limits<float>::infinity();
+  }
+
+  std::vector<Node> nodes_;
+  /// Primitive indices, the primitives of each leaf are stored contiguously
+  std::vector<std::uint32_t> primitives_;
+};
+
+template <class F>
+void BVH::traverse(Ray const &ray, float &maxDistance, F &&intersect) const {
+  auto constexpr kInfinity = std::numeric_limits<float>::infinity();
+  if (nodes_.empty()) return;
+
+  Position const inverseDirection = ray.direction.cwiseInverse();
+  auto const distanceTo = [&](std::uint32_t node) {
+    return entryDistance(nodes_[node], ray.origin, inverseDirection,
+                         maxDistance);
+  };
+
+  std::array<std::pair<std::uint32_t, float>, kMaxDepth + 1> stack;
+  std::size_t stackSize = 0;
+  if (distanceTo(0) < kInfinity) stack[stackSize++] = {0, 0.f};
+
+  while (stackSize > 0) {
+    auto const entry = stack[--stackSize];
+    // skip nodes behind the closest hit found so far
+    if (entry.second > maxDistance) continue;
+
+    auto const &node = nodes_[entry.first];
+    if (node.count > 0) {
+      for (auto i = node.first; i < node.first + node.count; ++i)
+        intersect(primitives_[i], maxDistance);
+      continue;
+    }
+
+    // push the far child first, so that the near child is visited first
+    std::array<std::pair<std::uint32_t, float>, 2> children{
+        {{node.first, distanceTo(node.first)},
+         {node.first + 1, distanceTo(node.first + 1)}}};
+    if (children[0].second < children[1].second)
+      std::swap(children[0], children[1]);
+    for (auto const &child : children)
+      if (child.second < kInfinity) stack[stackSize++] = child;
+  }
+}
+
+/// Triangles of a mesh with a BVH for ray intersection, e.g. for picking
+class TriangleBVH {
+public:
+  using Vertices = Eigen::Matrix<float, Eigen::Dynamic, 3>;
+  using Indices = Eigen::Matrix<std::uint32_t, Eigen::Dynamic, 3>;
+
+  struct Hit {
+    /// Index of the triangle, i.e. the row of the indices
+    std::uint32_t triangle;
+    /// Distance along the ray, in multiples of the ray direction
+    float distance;
+    /// Barycentric coordinates of the hit point with respect to the second
+    /// and third vertex of the triangle
+    Eigen::Vector2f barycentrics;
+  };
+
+  TriangleBVH(Vertices const &vertices, Indices const &indices,
+              BVH::CancelFunction const &isCancelled = {});
+
+  inline BVH::Box bounds() const noexcept { return bvh_.bounds(); }
+
+  /// Finds the closest triangle hit by the ray closer than maxDistance. Both
+  /// sides of the triangles are hit.
+  bool intersect(Ray const &ray, float maxDistance, Hit &hit) const noexcept;
+
+private:
+  Eigen::Matrix<float, 3, Eigen::Dynamic> vertices_;
+  Eigen::Matrix<std::uint32_t, 3, Eigen::Dynamic> indices_;
+  BVH bvh_;
+};
+
+} // namespace Private_
+} // namespace VolViz
@@ -10,22 +10,26 @@ Camera::Camera() noexcept {
   orientation.afterAction = [this](auto const &) {
     cachedViewMatrix_.markAsDirty();
     cachedViewProjectionMatrix_.markAsDirty();
+    if (afterChange) afterChange();
   };
 
   position.afterAction = [this](auto const &) {
     cachedViewMatrix_.markAsDirty();
     cachedViewProjectionMatrix_.markAsDirty();
+    if (afterChange) afterChange();
   };
 
   verticalFieldOfView.afterAction = [this](auto const &) {
     cachedVerticalFOV_.markAsDirty();
     cachedProjectionMatrix_.markAsDirty();
     cachedViewProjectionMatrix_.markAsDirty();
+    if (afterChange) afterChange();
   };
 
   aspectRatio.afterAction = [this](auto const &) {
     cachedProjectionMatrix_.markAsDirty();
     cachedViewProjectionMatrix_.markAsDirty();
+    if (afterChange) afterChange();
   };
 }
 
@@ -11,39 +11,13 @@ Cube::Cube(CubeDescriptor const &descriptor, VisualizerImpl &visualizer)
   scale = descriptor.scale;
 
   radius = descriptor.radius;
+  setModelBounds(Box(Position::Constant(-radius), Position::Constant(radius)));
 }
 
 void Cube::doInit() {}
 
-void Cube::doRender(std::uint32_t index, bool selected) {
-  auto const &cameraClient = visualizer_.cameraClient();
-  Length const rScale = visualizer_.cachedScale;
-
-  auto const viewMat = cameraClient.viewMatrix(rScale);
-  auto const destScale = static_cast<float>(scale / rScale);
-
-  auto const modelMat = (Eigen::Translation3f(position) * orientation *
-                         Eigen::Scaling(destScale * radius))
-                            .matrix();
-
-  auto const modelViewMat = (viewMat * modelMat).eval();
-  auto const inverseModelViewMatrix =
-      modelViewMat.block<3, 3>(0, 0).inverse().eval();
-
-  auto &shaders = visualizer_.shaders();
-
-  shaders["cube"].use();
-  visualizer_.attachVolumeToShader(shaders["cube"]);
-  shaders["cube"]["index"] = index;
-  shaders["cube"]["modelMatrix"] = modelMat;
-  shaders["cube"]["shininess"] = 10.f;
-  shaders["cube"]["color"] = selected ? (color * 1.5f).eval() : color;
-  shaders["cube"]["modelViewProjectionMatrix"] =
-      (cameraClient.projectionMatrix() * modelViewMat).eval();
-  shaders["cube"]["inverseModelViewMatrix"] = inverseModelViewMatrix;
-  shaders["cube"]["textureTransformMatrix"] =
-      visualizer_.textureTransformationMatrix();
-
+void Cube::doRender(std::uint32_t, bool) {
+  visualizer_.shaders()[Program::Cube].use();
   visualizer_.drawSingleVertex();
 }
 
@@ -55,6 +29,7 @@ void Cube::doUpdate() {
   radius = descriptor.radius;
   color = descriptor.color;
   scale = descriptor.scale;
+  setModelBounds(Box(Position::Constant(-radius), Position::Constant(radius)));
 }
 
 void Cube::doEnqueueUpdate(GeometryDescriptor const &descriptor) {
@@ -65,5 +40,16 @@ void Cube::doEnqueueUpdate(GeometryDescriptor &&descriptor) {
   updateQueue_.enqueue(std::move(dynamic_cast<CubeDescriptor &&>(descriptor)));
 }
 
+Geometry::RenderState Cube::doRenderState() const {
+  return {visualizer_.shaders()[Program::Cube].id(), 0};
+}
+
+Matrix4 Cube::doModelMatrix(Length ambientScale) const {
+  auto const destScale = static_cast<float>(scale / ambientScale);
+  return (Eigen::Translation3f(position) * orientation *
+          Eigen::Scaling(destScale * radius))
+      .matrix();
+}
+
 } // namespace Private_
 } // namespace VolViz
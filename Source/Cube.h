@@ -22,6 +22,10 @@ protected:
   virtual void doEnqueueUpdate(GeometryDescriptor const &descriptor) override;
   virtual void doEnqueueUpdate(GeometryDescriptor &&descriptor) override;
 
+  virtual RenderState doRenderState() const override;
+
+  virtual Matrix4 doModelMatrix(Length ambientScale) const override;
+
 private:
   using UpdateQueue = moodycamel::ConcurrentQueue<CubeDescriptor>;
 
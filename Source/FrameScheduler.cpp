@@ -0,0 +1,115 @@
+#include "FrameScheduler.h"
+#include "Types.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace VolViz {
+namespace Private_ {
+
+namespace {
+
+using namespace std::chrono_literals;
+
+/// Time spent spinning before a frame is due, sleeping is not accurate
+/// enough for the last part of the wait
+constexpr auto kSpinDuration = 1ms;
+
+/// Amount the lead of a frame shrinks by after a frame met its deadline
+constexpr auto kLeadStep = 100us;
+
+/// Weight of the latest frame in the running mean and variance
+constexpr double kStatisticsWeight = 1.0 / 32.0;
+
+inline FrameScheduler::Clock::duration
+toClock(FrameScheduler::Duration duration) noexcept {
+  return std::chrono::duration_cast<FrameScheduler::Clock::duration>(duration);
+}
+
+} // namespace
+
+FrameScheduler::FrameScheduler(double fps, Duration refreshInterval,
+                               bool lowLatency)
+    : period_(1.0 / fps), refreshInterval_(refreshInterval),
+      lowLatency_(lowLatency) {
+  Expects(fps > 0.0);
+
+  if (refreshInterval_.count() > 0.0) {
+    auto const refreshes =
+        std::max(1.0, std::round(period_ / refreshInterval_));
+    period_ = refreshes * refreshInterval_;
+  }
+  lead_ = std::min(period_ / 2.0, maxLead());
+  deadline_ = Clock::now() + toClock(period_);
+}
+
+void FrameScheduler::waitForFrame() {
+  // With vsync, a frame started earlier than a refresh before its deadline
+  // would be presented at an earlier refresh
+  auto const lead = lowLatency_ ? lead_ : maxLead();
+  waitUntil(deadline_ - toClock(lead));
+}
+
+void FrameScheduler::frameFinished(bool presented) {
+  auto const now = Clock::now();
+  auto const period = toClock(period_);
+
+  if (!presented) {
+    // An interval spanning skipped frames says nothing about the pacing
+    lastPresentationValid_ = false;
+    deadline_ += period;
+    if (deadline_ <= now) deadline_ = now + period;
+    return;
+  }
+
+  bool const vsync = refreshInterval_.count() > 0.0;
+  auto const tolerance = vsync ? refreshInterval_ / 2.0 : period_ / 4.0;
+  if (now > deadline_ + toClock(tolerance)) {
+    ++statistics_.missedFrames;
+    lead_ = std::min(maxLead(), lead_ * 1.5);
+  } else {
+    lead_ = std::max<Duration>(kSpinDuration, lead_ - kLeadStep);
+  }
+
+  if (lastPresentationValid_) recordInterval(now - lastPresentation_);
+  lastPresentation_ = now;
+  lastPresentationValid_ = true;
+
+  if (vsync) {
+    // The swap returned at a refresh, so the next deadline is a refresh, too.
+    // A late frame was presented at a later refresh than its deadline, the
+    // schedule continues from that refresh.
+    deadline_ = now + period;
+  } else {
+    // Late frames are not caught up with, the schedule starts over instead
+    deadline_ += period;
+    if (deadline_ <= now) deadline_ = now + period;
+  }
+}
+
+void FrameScheduler::waitUntil(Clock::time_point timePoint) {
+  auto const sleepEnd = timePoint - kSpinDuration;
+  if (Clock::now() < sleepEnd) std::this_thread::sleep_until(sleepEnd);
+  while (Clock::now() < timePoint) std::this_thread::yield();
+}
+
+void FrameScheduler::recordInterval(Duration interval) noexcept {
+  auto const x = interval.count();
+  auto mean = statistics_.frameInterval.count();
+
+  if (mean == 0.0) {
+    mean = x;
+  } else {
+    auto const delta = x - mean;
+    mean += kStatisticsWeight * delta;
+    intervalVariance_ = (1.0 - kStatisticsWeight) *
+                        (intervalVariance_ + kStatisticsWeight * delta * delta);
+  }
+
+  statistics_.frameInterval = Duration(mean);
+  statistics_.frameIntervalJitter = Duration(std::sqrt(intervalVariance_));
+}
+
+} // namespace Private_
+} // namespace VolViz
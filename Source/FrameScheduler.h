@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace VolViz {
+namespace Private_ {
+
+/// Paces a render loop to a target frame rate.
+///
+/// Frames are scheduled at fixed deadlines, the times they should be
+/// presented, instead of sleeping for the remainder of each frame, so that
+/// timing errors do not accumulate. The thread sleeps until shortly before
+/// a frame is due and spins for the rest, since sleeping is only accurate to
+/// a few milliseconds.
+///
+/// With vsync the swap waits for the next refresh of the display. The frame
+/// duration is rounded to a multiple of the refresh interval and the
+/// deadlines are aligned to the refreshes, otherwise frames regularly miss
+/// the refresh they were meant for. Frames are started at most one refresh
+/// before their deadline, so that the swap blocks until the target refresh
+/// instead of an earlier one.
+class FrameScheduler {
+public:
+  using Clock = std::chrono::steady_clock;
+  using Duration = std::chrono::duration<double>;
+
+  /// Timing of the presented frames
+  struct Statistics {
+    /// Mean interval between two presented frames
+    Duration frameInterval{0};
+    /// Standard deviation of the interval between two presented frames
+    Duration frameIntervalJitter{0};
+    /// Number of frames that were presented after their deadline
+    std::size_t missedFrames{0};
+  };
+
+  /// @param fps the target frame rate
+  /// @param refreshInterval interval between two refreshes of the display if
+  /// the swap is synchronized to them, zero otherwise
+  /// @param lowLatency if true, frames are started as late as possible to
+  /// still meet their deadline, such that the input is sampled shortly
+  /// before the frame is presented. Otherwise frames are started as soon as
+  /// the previous frame was presented.
+  FrameScheduler(double fps, Duration refreshInterval, bool lowLatency);
+
+  /// Waits until the next frame has to be started
+  void waitForFrame();
+
+  /// Records the end of the frame, after the buffers were swapped
+  /// @param presented false if the frame was skipped and nothing was swapped
+  void frameFinished(bool presented);
+
+  inline Duration frameDuration() const noexcept { return period_; }
+
+  inline Statistics const &statistics() const noexcept { return statistics_; }
+
+private:
+  /// Sleeps until shortly before the time point and spins for the rest
+  static void waitUntil(Clock::time_point timePoint);
+
+  /// Longest time before its deadline a frame is started
+  inline Duration maxLead() const noexcept {
+    return refreshInterval_.count() > 0.0 ? refreshInterval_ : period_;
+  }
+
+  /// Updates the statistics with the interval to the last presented frame
+  void recordInterval(Duration interval) noexcept;
+
+  Duration period_;
+  Duration refreshInterval_;
+  bool lowLatency_;
+
+  /// Time the next frame should be presented
+  Clock::time_point deadline_;
+  /// How long before its deadline a frame is started in low latency mode.
+  /// It grows when a deadline is missed and shrinks slowly otherwise.
+  Duration lead_;
+
+  Clock::time_point lastPresentation_;
+  bool lastPresentationValid_{false};
+
+  Statistics statistics_;
+  /// Running variance of the frame interval
+  double intervalVariance_{0.0};
+};
+
+} // namespace Private_
+} // namespace VolViz
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Types.h"
+
+namespace VolViz {
+namespace Private_ {
+
+/// The view frustum of a camera, represented by its six planes. A point p
+/// is inside the frustum if n.dot(p) + d >= 0 for all planes (n, d).
+///
+/// The planes are extracted from a projection matrix following Gribb &
+/// Hartmann, for the [0, 1] clip space depth range. Planes that are
+/// degenerated, e.g. the far plane of an infinite projection, have a zero
+/// normal and never reject anything.
+struct Frustum {
+  /// One plane (normal, distance) per row: left, right, bottom, top and the
+  /// depth planes z = 0 and z = w in clip space
+  Eigen::Matrix<float, 6, 4> planes;
+
+  /// Extracts the frustum in the coordinate system the given matrix maps
+  /// from, e.g. model space for a model view projection matrix
+  static Frustum fromMatrix(Matrix4 const &m) noexcept {
+    Frustum f;
+    f.planes.row(0) = m.row(3) + m.row(0);
+    f.planes.row(1) = m.row(3) - m.row(0);
+    f.planes.row(2) = m.row(3) + m.row(1);
+    f.planes.row(3) = m.row(3) - m.row(1);
+    f.planes.row(4) = m.row(2);
+    f.planes.row(5) = m.row(3) - m.row(2);
+
+    for (int i = 0; i < 6; ++i) {
+      auto const norm = f.planes.block<1, 3>(i, 0).norm();
+      if (norm > 0.f) f.planes.row(i) /= norm;
+    }
+    return f;
+  }
+
+  /// Returns false if the sphere is completely outside of the frustum
+  inline bool intersectsSphere(Position const &center, float radius) const
+      noexcept {
+    return ((planes.leftCols<3>() * center + planes.col(3)).array() >= -radius)
+        .all();
+  }
+
+  /// Returns false if the axis aligned box is completely outside of the
+  /// frustum
+  inline bool intersectsBox(Position const &min, Position const &max) const
+      noexcept {
+    for (int i = 0; i < 6; ++i) {
+      // test the corner that is farthest along the plane normal
+      Position const p =
+          (planes.block<1, 3>(i, 0).transpose().array() >= 0.f)
+              .select(max, min);
+      if (planes.block<1, 3>(i, 0) * p + planes(i, 3) < 0.f) return false;
+    }
+    return true;
+  }
+};
+
+} // namespace Private_
+} // namespace VolViz
@@ -5,6 +5,7 @@
 #include "Error.h"
 
 #include <cstddef>
+#include <utility>
 
 namespace VolViz {
 namespace Private_ {
@@ -27,8 +28,8 @@ struct Buffer {
   inline Buffer(Buffer &&rhs) noexcept : name(rhs.name) { rhs.name = 0; }
 
   inline Buffer &operator=(Buffer &&rhs) noexcept {
-    name = rhs.name;
-    rhs.name = 0;
+    using std::swap;
+    swap(name, rhs.name);
     return *this;
   }
 
@@ -50,6 +51,25 @@ struct Buffer {
   GLuint name = 0;
 };
 
+/// Returns a buffer of the new size, containing the first usedSize bytes of
+/// the given buffer. The data is copied on the GPU, it never goes back to the
+/// host.
+inline Buffer resized(Buffer const &buffer, std::size_t usedSize,
+                      std::size_t newSize, GLenum usage) {
+  Buffer newBuffer;
+  newBuffer.upload(GL_COPY_WRITE_BUFFER, newSize,
+                   static_cast<char const *>(nullptr), usage);
+  if (usedSize > 0) {
+    buffer.bind(GL_COPY_READ_BUFFER);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                        static_cast<GLsizeiptr>(usedSize));
+    Buffer::unbind(GL_COPY_READ_BUFFER);
+  }
+  Buffer::unbind(GL_COPY_WRITE_BUFFER);
+  assertGL("Failed to resize buffer");
+  return newBuffer;
+}
+
 } // namespace GL
 } // namespace Private_
 } // namespace VolViz
@@ -48,6 +48,17 @@ GLFW::GLFW(std::string title, std::size_t width, std::size_t height) {
 
   glfwSetWindowUserPointer(window, this);
 
+  // cache the sizes, the callbacks keep them up to date
+  {
+    int w, h;
+    glfwGetWindowSize(window, &w, &h);
+    width_ = static_cast<std::size_t>(w);
+    height_ = static_cast<std::size_t>(h);
+    glfwGetFramebufferSize(window, &w, &h);
+    framebufferWidth_ = static_cast<std::size_t>(w);
+    framebufferHeight_ = static_cast<std::size_t>(h);
+  }
+
   // setup key callback handler
   glfwSetKeyCallback(
       window, [](GLFWwindow *win, int key, int scancode, int action, int mode) {
@@ -62,10 +73,22 @@ GLFW::GLFW(std::string title, std::size_t width, std::size_t height) {
     auto ptr = glfwGetWindowUserPointer(win);
     assert(ptr != nullptr && "Invalid user pointer");
     auto *const self = static_cast<GLFW *>(ptr);
+    self->width_ = static_cast<std::size_t>(w);
+    self->height_ = static_cast<std::size_t>(h);
     if (self->windowResizeCallback)
       self->windowResizeCallback(static_cast<std::size_t>(w),
                                  static_cast<std::size_t>(h));
   });
+  glfwSetFramebufferSizeCallback(window, [](GLFWwindow *win, int w, int h) {
+    auto ptr = glfwGetWindowUserPointer(win);
+    assert(ptr != nullptr && "Invalid user pointer");
+    auto *const self = static_cast<GLFW *>(ptr);
+    self->framebufferWidth_ = static_cast<std::size_t>(w);
+    self->framebufferHeight_ = static_cast<std::size_t>(h);
+    if (self->framebufferResizeCallback)
+      self->framebufferResizeCallback(static_cast<std::size_t>(w),
+                                      static_cast<std::size_t>(h));
+  });
 
   // setup scroll wheel input
   glfwSetScrollCallback(window, [](GLFWwindow *win, double x, double y) {
@@ -91,6 +114,14 @@ GLFW::GLFW(std::string title, std::size_t width, std::size_t height) {
     if (self->mouseMoveCallback) self->mouseMoveCallback(x, y);
   });
 
+  // setup window refresh callback
+  glfwSetWindowRefreshCallback(window, [](GLFWwindow *win) {
+    auto ptr = glfwGetWindowUserPointer(win);
+    assert(ptr != nullptr && "Invalid user pointer");
+    auto *const self = static_cast<GLFW *>(ptr);
+    if (self->windowRefreshCallback) self->windowRefreshCallback();
+  });
+
   makeCurrent();
   
   if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress))) {
@@ -101,37 +132,37 @@ GLFW::GLFW(std::string title, std::size_t width, std::size_t height) {
   glfwSwapInterval(1);
 }
 
-GLFW::GLFW(GLFW &&rhs) : window(rhs.window) { rhs.window = nullptr; }
+GLFW::GLFW(GLFW &&rhs)
+    : window(rhs.window), width_(rhs.width_), height_(rhs.height_),
+      framebufferWidth_(rhs.framebufferWidth_),
+      framebufferHeight_(rhs.framebufferHeight_), hidden_(rhs.hidden_) {
+  rhs.window = nullptr;
+}
 
 GLFW::~GLFW() {
   if (window) glfwDestroyWindow(window);
   glfwTerminate();
 }
 
-void GLFW::hide() noexcept { glfwHideWindow(window); }
-
-void GLFW::show() noexcept { glfwShowWindow(window); }
+void GLFW::hide() noexcept {
+  glfwHideWindow(window);
+  hidden_ = true;
+}
 
-bool GLFW::isHidden() const noexcept {
-  return glfwGetWindowAttrib(window, GLFW_VISIBLE) == 0;
+void GLFW::show() noexcept {
+  glfwShowWindow(window);
+  hidden_ = false;
 }
 
 void GLFW::makeCurrent() noexcept { glfwMakeContextCurrent(window); }
 
 void GLFW::detachContext() noexcept { glfwMakeContextCurrent(nullptr); }
 
-std::size_t GLFW::width() const noexcept {
-  int w, h;
-  glfwGetWindowSize(window, &w, &h);
-  if (!isHidden()) return static_cast<std::size_t>(w);
-  return VOLVIZ_DEFAULT_WINDOW_WIDTH;
-}
-
-std::size_t GLFW::height() const noexcept {
-  int w, h;
-  glfwGetWindowSize(window, &w, &h);
-  if (!isHidden()) return static_cast<std::size_t>(h);
-  return VOLVIZ_DEFAULT_WINDOW_HEIGHT;
+int GLFW::refreshRate() const noexcept {
+  auto const monitor = glfwGetPrimaryMonitor();
+  if (monitor == nullptr) return 0;
+  auto const mode = glfwGetVideoMode(monitor);
+  return mode != nullptr ? mode->refreshRate : 0;
 }
 
 bool GLFW::supportsExtension(std::string name) const noexcept {
@@ -41,7 +41,7 @@ public:
   void show() noexcept;
 
   /// Returns true if the window is hidden
-  bool isHidden() const noexcept;
+  inline bool isHidden() const noexcept { return hidden_; }
 
   /// Makes the window's conext current
   void makeCurrent() noexcept;
@@ -57,8 +57,16 @@ public:
 
   inline void waitEvents() const noexcept { glfwWaitEvents(); }
 
+  /// Waits for events, but no longer than timeout seconds
+  inline void waitEvents(double timeout) const noexcept {
+    glfwWaitEventsTimeout(timeout);
+  }
+
   inline void pollEvents() const noexcept { glfwPollEvents(); }
 
+  /// Ends waitEvents, can be called from any thread
+  inline void postEmptyEvent() const noexcept { glfwPostEmptyEvent(); }
+
   bool supportsExtension(std::string name) const noexcept;
 
   inline decltype(auto) supportedExtensions() const noexcept {
@@ -66,24 +74,53 @@ public:
   }
 
   /// Returns the width of the window
-  std::size_t width() const noexcept;
+  inline std::size_t width() const noexcept {
+    return hidden_ ? VOLVIZ_DEFAULT_WINDOW_WIDTH : width_;
+  }
   /// Returns the height of the window
-  std::size_t height() const noexcept;
+  inline std::size_t height() const noexcept {
+    return hidden_ ? VOLVIZ_DEFAULT_WINDOW_HEIGHT : height_;
+  }
+
+  /// Returns the width of the window's framebuffer in pixels, which differs
+  /// from the width on high resolution displays
+  inline std::size_t framebufferWidth() const noexcept {
+    return hidden_ ? VOLVIZ_DEFAULT_WINDOW_WIDTH : framebufferWidth_;
+  }
+  /// Returns the height of the window's framebuffer in pixels
+  inline std::size_t framebufferHeight() const noexcept {
+    return hidden_ ? VOLVIZ_DEFAULT_WINDOW_HEIGHT : framebufferHeight_;
+  }
+
+  /// Returns the refresh rate of the primary monitor in Hz, 0 if unknown
+  int refreshRate() const noexcept;
 
   /// keyboard input handler
   std::function<void(int, int, int, int)> keyInputHandler;
   /// window resize callback
   std::function<void(std::size_t, std::size_t)> windowResizeCallback;
+  /// framebuffer resize callback, the size is in pixels
+  std::function<void(std::size_t, std::size_t)> framebufferResizeCallback;
   /// scroll wheel input handler
   std::function<void(double, double)> scrollWheelInputHandler;
   /// mouse button callback
   std::function<void(int, int, int)> mouseButtonCallback;
   /// mouse move callback
   std::function<void(double, double)> mouseMoveCallback;
+  /// window refresh callback, called when the window contents are damaged
+  std::function<void()> windowRefreshCallback;
 
 private:
   GLFWwindow *window = nullptr;
   std::vector<std::string> supportedExtensions_;
+
+  /// Sizes of the window and its framebuffer, updated by the size callbacks
+  /// instead of being queried on every access
+  std::size_t width_{0};
+  std::size_t height_{0};
+  std::size_t framebufferWidth_{0};
+  std::size_t framebufferHeight_{0};
+  bool hidden_{true};
 };
 #pragma clang diagnostic pop
 
@@ -0,0 +1,41 @@
+#ifndef VolViz_Queries_h
+#define VolViz_Queries_h
+
+#include "GLdefs.h"
+
+#include <array>
+
+namespace VolViz {
+namespace Private_ {
+namespace GL {
+
+/// RAII wrapper for arrays of OpenGL query objects
+template <std::size_t N> struct Queries {
+
+  inline Queries(int) noexcept {
+    for (std::size_t i = 0; i < N; ++i) names[i] = 0;
+  }
+
+  inline Queries() noexcept { glGenQueries(N, names.data()); }
+
+  inline Queries(Queries &&rhs) noexcept {
+    using std::swap;
+    swap(names, rhs.names);
+  }
+
+  inline ~Queries() { glDeleteQueries(N, names.data()); }
+
+  inline Queries &operator=(Queries &&rhs) noexcept {
+    using std::swap;
+    swap(names, rhs.names);
+    return *this;
+  }
+
+  std::array<GLuint, N> names;
+};
+
+} // namespace GL
+} // namespace Private_
+} // namespace VolViz
+
+#endif // VolViz_Queries_h
@@ -68,6 +68,17 @@ ShaderProgram &ShaderProgram::link() {
   return *this;
 }
 
+ShaderProgram &ShaderProgram::bindUniformBlock(std::string const &name,
+                                               GLuint binding) {
+  auto const blockIndex = glGetUniformBlockIndex(program_, name.c_str());
+  assertGL("Failed to get uniform block index");
+  if (blockIndex == GL_INVALID_INDEX) return *this;
+
+  glUniformBlockBinding(program_, blockIndex, binding);
+  assertGL("Failed to bind uniform block");
+  return *this;
+}
+
 void ShaderProgram::queryUniforms() {
   assert(uniforms_.empty() && "Precondition violation");
   // get uniform count
@@ -84,13 +95,22 @@ void ShaderProgram::queryUniforms() {
                            nameBuffer.data());
 
     auto const loc = glGetUniformLocation(program_, nameBuffer.data());
-
-    uniforms_.emplace(std::piecewise_construct,
-                      std::forward_as_tuple(nameBuffer.data()),
-                      std::forward_as_tuple(loc));
+    // members of uniform blocks are set through buffers
+    if (loc < 0) continue;
+
+    std::string const name(nameBuffer.data());
+    auto const inserted = uniforms_.emplace(
+        std::piecewise_construct,
+        std::forward_as_tuple(UniformName::hash(name.c_str(), name.size())),
+        std::forward_as_tuple(loc));
+    if (!inserted.second) {
+      throw std::runtime_error("Hash of uniform " + name +
+                               " collides with another uniform");
+    }
+    uniformNames_.push_back(name);
   }
 
-  assert(uniforms_.size() == static_cast<std::size_t>(count) &&
+  assert(uniforms_.size() <= static_cast<std::size_t>(count) &&
          "Postcondition violation");
 }
 } // namespace GL
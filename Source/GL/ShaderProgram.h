@@ -6,6 +6,10 @@
 
 #include <Eigen/Core>
 
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -44,6 +48,31 @@ private:
   GLuint shader_;
 };
 
+/// Name of a uniform, identified by its FNV-1a hash. Computing the hash is
+/// constexpr, so that the hash of a literal is folded by the compiler and
+/// setting uniforms neither builds nor hashes strings.
+class UniformName {
+public:
+  template <std::size_t N>
+  constexpr UniformName(char const (&name)[N]) noexcept
+      : hash_(hash(name, N - 1)) {}
+
+  constexpr std::uint32_t value() const noexcept { return hash_; }
+
+  static constexpr std::uint32_t hash(char const *name,
+                                      std::size_t length) noexcept {
+    std::uint32_t h = 2166136261u;
+    for (std::size_t i = 0; i < length; ++i) {
+      h ^= static_cast<unsigned char>(name[i]);
+      h *= 16777619u;
+    }
+    return h;
+  }
+
+private:
+  std::uint32_t hash_;
+};
+
 class UniformProxy {
 public:
   inline UniformProxy(GLint loccation) noexcept : location_(loccation) {}
@@ -52,6 +81,7 @@ public:
   UniformProxy(UniformProxy &&) = default;
 
   UniformProxy const &operator=(float f) const noexcept {
+    if (!changed(Kind::Float, &f, sizeof(f))) return *this;
     assertGL("Precondition violation");
     glUniform1f(location_, f);
     assertGL("Failed to upload uniform");
@@ -59,6 +89,7 @@ public:
   }
 
   UniformProxy const &operator=(GLint i) const noexcept {
+    if (!changed(Kind::Int, &i, sizeof(i))) return *this;
     assertGL("Precondition violation");
     glUniform1i(location_, i);
     assertGL("Failed to upload uniform");
@@ -66,6 +97,7 @@ public:
   }
 
   UniformProxy const &operator=(GLuint i) const noexcept {
+    if (!changed(Kind::UnsignedInt, &i, sizeof(i))) return *this;
     assertGL("Precondition violation");
     glUniform1ui(location_, i);
     assertGL("Failed to upload uniform");
@@ -73,6 +105,7 @@ public:
   }
 
   UniformProxy const &operator=(Eigen::Vector2f const &v) const noexcept {
+    if (!changed(Kind::Vector, v.data(), sizeof(v))) return *this;
     assertGL("Precondition violation");
     glUniform2fv(location_, 1, v.data());
     assertGL("Failed to upload uniform");
@@ -80,6 +113,7 @@ public:
   }
 
   UniformProxy const &operator=(Eigen::Vector3f const &v) const noexcept {
+    if (!changed(Kind::Vector, v.data(), sizeof(v))) return *this;
     assertGL("Precondition violation");
     glUniform3fv(location_, 1, v.data());
     assertGL("Failed to upload uniform");
@@ -87,6 +121,7 @@ public:
   }
 
   UniformProxy const &operator=(Eigen::Vector4f const &v) const noexcept {
+    if (!changed(Kind::Vector, v.data(), sizeof(v))) return *this;
     assertGL("Precondition violation");
     glUniform4fv(location_, 1, v.data());
     assertGL("Failed to upload uniform");
@@ -94,6 +129,7 @@ public:
   }
 
   UniformProxy const &operator=(Eigen::Matrix4f const &m) const noexcept {
+    if (!changed(Kind::Matrix, m.data(), sizeof(m))) return *this;
     assertGL("Precondition violation");
     glUniformMatrix4fv(location_, 1, false, m.data());
     assertGL("Failed to upload uniform");
@@ -102,6 +138,9 @@ public:
 
   UniformProxy const &
   operator=(Eigen::Transpose<Eigen::Matrix4f> const &m) const noexcept {
+    auto const &transposed = m.nestedExpression();
+    if (!changed(Kind::TransposedMatrix, transposed.data(), sizeof(transposed)))
+      return *this;
     assertGL("Precondition violation");
     glUniformMatrix4fv(location_, 1, true, m.nestedExpression().data());
     assertGL("Failed to upload uniform");
@@ -109,6 +148,7 @@ public:
   }
 
   UniformProxy const &operator=(Eigen::Matrix3f const &m) const noexcept {
+    if (!changed(Kind::TransposedMatrix, m.data(), sizeof(m))) return *this;
     assertGL("Precondition violation");
     glUniformMatrix3fv(location_, 1, true, m.data());
     assertGL("Failed to upload uniform");
@@ -116,7 +156,39 @@ public:
   }
 
 private:
+  /// Type of the cached value, values of different types are never equal
+  enum class Kind : std::uint8_t {
+    None,
+    Float,
+    Int,
+    UnsignedInt,
+    Vector,
+    Matrix,
+    TransposedMatrix
+  };
+
+  /// Returns true, if the value differs from the last uploaded one, and
+  /// remembers it. Uniforms are state of the program, so the upload can be
+  /// skipped if the value did not change, e.g. if many geometries share a
+  /// program.
+  inline bool changed(Kind kind, void const *value, std::size_t size) const
+      noexcept {
+    assert(size <= cache_.size() && "Uniform value too large for the cache");
+    if (kind == cachedKind_ && size == cachedSize_ &&
+        std::memcmp(cache_.data(), value, size) == 0)
+      return false;
+
+    cachedKind_ = kind;
+    cachedSize_ = static_cast<std::uint8_t>(size);
+    std::memcpy(cache_.data(), value, size);
+    return true;
+  }
+
   GLint const location_;
+  mutable Kind cachedKind_{Kind::None};
+  mutable std::uint8_t cachedSize_{0};
+  /// Last uploaded value, large enough for a 4x4 matrix
+  mutable std::array<unsigned char, 16 * sizeof(float)> cache_{};
 };
 
 #pragma clang diagnostic push
@@ -132,6 +204,8 @@ public:
 
   inline ~ShaderProgram() {
     detachShaders();
+    // the name might be reused by a new program
+    if (current() == program_) current() = 0;
     glDeleteProgram(program_);
   }
 
@@ -142,6 +216,7 @@ public:
     swap(program_, rhs.program_);
     swap(attachedShaders_, rhs.attachedShaders_);
     swap(uniforms_, rhs.uniforms_);
+    swap(uniformNames_, rhs.uniformNames_);
   }
 
   inline ShaderProgram &operator=(ShaderProgram &&rhs) noexcept {
@@ -149,6 +224,7 @@ public:
     swap(program_, rhs.program_);
     swap(attachedShaders_, rhs.attachedShaders_);
     swap(uniforms_, rhs.uniforms_);
+    swap(uniformNames_, rhs.uniformNames_);
     return *this;
   }
 
@@ -167,28 +243,46 @@ public:
 
   ShaderProgram &link();
 
+  /// Assigns the binding point to the uniform block with the given name.
+  /// Programs not using the block are left untouched.
+  ShaderProgram &bindUniformBlock(std::string const &name, GLuint binding);
+
+  /// Makes the program current. The call is skipped, if the program is
+  /// current already.
   inline void use() const noexcept {
+    if (current() == program_) return;
     assertGL("Dirty OpenGL error stack");
     glUseProgram(program_);
     assertGL("Failed to use program");
+    current() = program_;
   }
 
-  inline UniformProxy const &operator[](std::string const &name) const {
-    auto search = uniforms_.find(name);
+  /// Returns the OpenGL name of the program
+  inline GLuint id() const noexcept { return program_; }
+
+  inline UniformProxy const &operator[](UniformName name) const {
+    auto search = uniforms_.find(name.value());
+    if (search != uniforms_.end()) return search->second;
+
+    throw std::runtime_error("Uniform with hash " +
+                             std::to_string(name.value()) +
+                             " is not active in shader program " +
+                             std::to_string(program_));
+  }
+
+  /// Looks up a uniform by a name only known at runtime, meant for debugging
+  inline UniformProxy const &uniform(std::string const &name) const {
+    auto search =
+        uniforms_.find(UniformName::hash(name.c_str(), name.size()));
     if (search != uniforms_.end()) return search->second;
 
     throw std::runtime_error(name +
                              " is not an active uniform of shader program " +
                              std::to_string(program_));
-    // Dummy return statement because GCC is complaining, this code is never
-    // reached!
-    return uniforms_.begin()->second;
   }
 
-  inline auto activeUniformNames() const {
-    std::vector<std::string> activeUniforms;
-    for (auto const &kv : uniforms_) activeUniforms.push_back(kv.first);
-    return activeUniforms;
+  inline std::vector<std::string> const &activeUniformNames() const noexcept {
+    return uniformNames_;
   }
 
 private:
@@ -199,10 +293,23 @@ private:
 
   void queryUniforms();
 
-  using UniformTable = std::unordered_map<std::string, UniformProxy>;
+  /// The program that is currently in use. There is a single OpenGL context,
+  /// which is only used by the render thread.
+  static inline GLuint &current() noexcept {
+    static GLuint program = 0;
+    return program;
+  }
+
+  /// The keys are hashes already
+  struct IdentityHash {
+    inline std::size_t operator()(std::uint32_t h) const noexcept { return h; }
+  };
+  using UniformTable =
+      std::unordered_map<std::uint32_t, UniformProxy, IdentityHash>;
 
   std::vector<GLuint> attachedShaders_;
   UniformTable uniforms_;
+  std::vector<std::string> uniformNames_;
   GLuint program_ = 0;
 };
 #pragma clang diagnostic pop
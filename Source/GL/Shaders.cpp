@@ -36,6 +36,18 @@ std::string const deferredVertexShaderSrc =
 #include "Shaders/deferred.vert"
     ;
 
+std::string const deferredColormapFragShaderSrc =
+#include "Shaders/deferredColormap.frag"
+    ;
+
+std::string const deferredBatchVertexShaderSrc =
+#include "Shaders/deferredBatch.vert"
+    ;
+
+std::string const deferredBatchFragShaderSrc =
+#include "Shaders/deferredBatch.frag"
+    ;
+
 std::string const deferredPassthroughFragShaderSrc =
 #include "Shaders/deferredPassThrough.frag"
     ;
@@ -48,16 +60,12 @@ std::string const depthVisualizationFragShaderSrc =
 #include "Shaders/depthVisualization.frag"
     ;
 
-std::string const ambientPassFragShaderSrc =
-#include "Shaders/ambientPass.frag"
-    ;
-
-std::string const diffuseLightingPassFragShaderSrc =
-#include "Shaders/diffuseLighting.frag"
+std::string const gBufferFragShaderSrc =
+#include "Shaders/gBuffer.frag"
     ;
 
-std::string const specularLightingPassFragShaderSrc =
-#include "Shaders/specularLighting.frag"
+std::string const lightingPassFragShaderSrc =
+#include "Shaders/lighting.frag"
     ;
 
 std::string const specularVisualizationFragShaderSrc =
@@ -72,6 +80,30 @@ std::string const cubeGeomShaderSrc =
 #include "Shaders/cube.geom"
     ;
 
+std::string const instancedCubeVertShaderSrc =
+#include "Shaders/instancedCube.vert"
+    ;
+
+std::string const pointCloudVertShaderSrc =
+#include "Shaders/pointCloud.vert"
+    ;
+
+std::string const pointCloudFragShaderSrc =
+#include "Shaders/pointCloud.frag"
+    ;
+
+std::string const polylineVertShaderSrc =
+#include "Shaders/polyline.vert"
+    ;
+
+std::string const polylineGeomShaderSrc =
+#include "Shaders/polyline.geom"
+    ;
+
+std::string const polylineFragShaderSrc =
+#include "Shaders/polyline.frag"
+    ;
+
 std::string const coloredQuadFragmentShaderSrc =
 #include "Shaders/coloredQuad.frag"
     ;
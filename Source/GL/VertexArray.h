@@ -3,6 +3,8 @@
 
 #include "GLdefs.h"
 
+#include <utility>
+
 namespace VolViz {
 namespace Private_ {
 namespace GL {
@@ -25,8 +27,8 @@ struct VertexArray {
   }
 
   inline VertexArray &operator=(VertexArray &&rhs) noexcept {
-    name = rhs.name;
-    rhs.name = 0;
+    using std::swap;
+    swap(name, rhs.name);
     return *this;
   }
 
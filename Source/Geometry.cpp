@@ -24,5 +24,85 @@ void Geometry::doUpdate() {}
 void Geometry::doEnqueueUpdate(GeometryDescriptor const &) {}
 void Geometry::doEnqueueUpdate(GeometryDescriptor &&) {}
 
+std::shared_ptr<TriangleBVH const> Geometry::doTriangleBVH() const {
+  return nullptr;
+}
+
+Geometry::RenderState Geometry::doRenderState() const { return {}; }
+
+Matrix4 Geometry::doModelMatrix(Length ambientScale) const {
+  auto const destScale = static_cast<float>(scale / ambientScale);
+  return (Eigen::Translation3f(position) * orientation *
+          Eigen::Scaling(destScale))
+      .matrix();
+}
+
+Geometry::Material Geometry::doMaterial(bool selected) const {
+  return {selected ? (color * 1.5f).eval() : color, 10.f};
+}
+
+ObjectUniforms Geometry::objectUniforms(Matrix4 const &viewMatrix,
+                                        Matrix4 const &projectionMatrix,
+                                        Length ambientScale,
+                                        std::uint32_t index,
+                                        bool selected) const {
+  ObjectUniforms uniforms;
+  Matrix4 const modelMat = modelMatrix(ambientScale);
+  Matrix4 const modelViewMatrix = viewMatrix * modelMat;
+  uniforms.modelMatrix = modelMat;
+  uniforms.modelViewMatrix = modelViewMatrix;
+  uniforms.modelViewProjectionMatrix = projectionMatrix * modelViewMatrix;
+
+  // normals are transformed by the transposed inverse, the columns of a mat3
+  // are padded to four floats
+  Matrix3 const normalMatrix =
+      modelViewMatrix.block<3, 3>(0, 0).inverse().transpose();
+  uniforms.inverseModelViewMatrix.fill(0.f);
+  for (Eigen::Index c = 0; c < 3; ++c) {
+    for (Eigen::Index r = 0; r < 3; ++r) {
+      uniforms.inverseModelViewMatrix[static_cast<std::size_t>(4 * c + r)] =
+          normalMatrix(r, c);
+    }
+  }
+
+  auto const material = doMaterial(selected);
+  uniforms.color = {{material.color(0), material.color(1), material.color(2)}};
+  uniforms.shininess = material.shininess;
+  uniforms.index = index;
+  uniforms.selected = static_cast<GLint>(selected);
+  uniforms.padding = {{0, 0}};
+  return uniforms;
+}
+
+Geometry::Box const &Geometry::worldBounds(Length ambientScale) {
+  if (worldBoundsValid_ && position == boundsPosition_ &&
+      orientation.coeffs() == boundsOrientation_.coeffs() &&
+      scale == boundsScale_ && ambientScale == boundsAmbientScale_)
+    return worldBounds_;
+
+  worldBoundsValid_ = true;
+  boundsPosition_ = position;
+  boundsOrientation_ = orientation;
+  boundsScale_ = scale;
+  boundsAmbientScale_ = ambientScale;
+
+  worldBounds_.setEmpty();
+  if (modelBounds_.isEmpty()) return worldBounds_;
+
+  auto const destScale = static_cast<float>(scale / ambientScale);
+  Eigen::Affine3f const modelToWorld = Eigen::Translation3f(position) *
+                                       orientation * Eigen::Scaling(destScale);
+  for (int corner = 0; corner < 8; ++corner) {
+    auto const cornerType = static_cast<Box::CornerType>(corner);
+    worldBounds_.extend(modelToWorld * modelBounds_.corner(cornerType));
+  }
+  return worldBounds_;
+}
+
+void Geometry::setModelBounds(Box const &bounds) noexcept {
+  modelBounds_ = bounds;
+  worldBoundsValid_ = false;
+}
+
 } // namespace Private_
 } // namespace VolViz
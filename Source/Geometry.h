@@ -1,15 +1,30 @@
 #pragma once
 
+#include "GL/GLdefs.h"
 #include "GeometryDescriptor.h"
+#include "UniformBlocks.h"
+
+#include <memory>
 
 namespace VolViz {
 namespace Private_ {
 
+class TriangleBVH;
 class VisualizerImpl;
 
 class Geometry {
 public:
   using UniquePtr = std::unique_ptr<Geometry>;
+  using Box = Eigen::AlignedBox3f;
+
+  /// OpenGL state a geometry is rendered with. The render queue is sorted by
+  /// it, so that geometries sharing a program or a vertex array are rendered
+  /// one after another.
+  struct RenderState {
+    GLuint program{0};
+    /// 0 if the vertex array is shared, e.g. for single vertex draws
+    GLuint vertexArray{0};
+  };
 
   Position position{Position::Zero()};
   Orientation orientation{Orientation::Identity()};
@@ -32,7 +47,38 @@ public:
     doEnqueueUpdate(std::forward<Descriptor>(descriptor));
   }
 
+  /// Returns the triangles of the geometry in model coordinates for picking
+  /// on the CPU, nullptr if the geometry cannot be picked this way
+  inline std::shared_ptr<TriangleBVH const> triangleBVH() const {
+    return doTriangleBVH();
+  }
+
+  /// Returns the bounding box in world coordinates. It is only recomputed if
+  /// position, orientation, scale or the model bounds changed since the last
+  /// call. An empty box means the geometry is unbounded and is never culled.
+  Box const &worldBounds(Length ambientScale);
+
+  inline RenderState renderState() const { return doRenderState(); }
+
+  /// Returns the transformation from model to world coordinates
+  inline Matrix4 modelMatrix(Length ambientScale) const {
+    return doModelMatrix(ambientScale);
+  }
+
+  /// Returns the values of the ObjectUniforms block the geometry is rendered
+  /// with
+  ObjectUniforms objectUniforms(Matrix4 const &viewMatrix,
+                                Matrix4 const &projectionMatrix,
+                                Length ambientScale, std::uint32_t index,
+                                bool selected) const;
+
 protected:
+  /// Surface properties passed to the geometry stage
+  struct Material {
+    Color color;
+    float shininess;
+  };
+
   Geometry(VisualizerImpl &visualizer);
   Geometry(GeometryDescriptor const &descriptor, VisualizerImpl &visualizer);
 
@@ -45,7 +91,36 @@ protected:
   virtual void doEnqueueUpdate(GeometryDescriptor const &descriptor);
   virtual void doEnqueueUpdate(GeometryDescriptor &&descriptor);
 
+  virtual std::shared_ptr<TriangleBVH const> doTriangleBVH() const;
+
+  virtual RenderState doRenderState() const;
+
+  /// Defaults to translation, rotation and scaling relative to the ambient
+  /// scale
+  virtual Matrix4 doModelMatrix(Length ambientScale) const;
+
+  /// Defaults to the color, brightened if selected
+  virtual Material doMaterial(bool selected) const;
+
+  /// Sets the bounding box in model coordinates, i.e. before position,
+  /// orientation and scale are applied. Must be called whenever the data of
+  /// the geometry changes.
+  void setModelBounds(Box const &bounds) noexcept;
+
+  inline Box const &modelBounds() const noexcept { return modelBounds_; }
+
   VisualizerImpl &visualizer_;
+
+private:
+  Box modelBounds_;
+  Box worldBounds_;
+
+  /// Transformation the world bounds were computed for
+  bool worldBoundsValid_{false};
+  Position boundsPosition_{Position::Zero()};
+  Orientation boundsOrientation_{Orientation::Identity()};
+  Length boundsScale_{1 * milli * meter};
+  Length boundsAmbientScale_{1 * milli * meter};
 };
 
 } // namespace VolViz
@@ -10,4 +10,10 @@ MeshDescriptor::~MeshDescriptor() = default;
 
 CubeDescriptor::~CubeDescriptor() = default;
 
+InstancedCubesDescriptor::~InstancedCubesDescriptor() = default;
+
+PointCloudDescriptor::~PointCloudDescriptor() = default;
+
+PolylineDescriptor::~PolylineDescriptor() = default;
+
 } // namespace VolViz
@@ -2,7 +2,10 @@
 
 #include "AxisAlignedPlane.h"
 #include "Cube.h"
+#include "InstancedCubes.h"
 #include "Mesh.h"
+#include "PointCloud.h"
+#include "Polyline.h"
 #include "VisualizerImpl.h"
 
 namespace VolViz {
@@ -26,5 +29,20 @@ GeometryFactory::create(MeshDescriptor const &descriptor) {
   return std::make_unique<Mesh>(descriptor, visualizer_);
 }
 
+GeometryFactory::GeometryPtr
+GeometryFactory::create(InstancedCubesDescriptor const &descriptor) {
+  return std::make_unique<InstancedCubes>(descriptor, visualizer_);
+}
+
+GeometryFactory::GeometryPtr
+GeometryFactory::create(PointCloudDescriptor const &descriptor) {
+  return std::make_unique<PointCloud>(descriptor, visualizer_);
+}
+
+GeometryFactory::GeometryPtr
+GeometryFactory::create(PolylineDescriptor const &descriptor) {
+  return std::make_unique<Polyline>(descriptor, visualizer_);
+}
+
 } // namespace Private_
 } // namespace VolViz
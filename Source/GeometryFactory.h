@@ -16,6 +16,9 @@ public:
   GeometryPtr create(AxisAlignedPlaneDescriptor const &descriptor);
   GeometryPtr create(CubeDescriptor const &descriptor);
   GeometryPtr create(MeshDescriptor const &descriptor);
+  GeometryPtr create(InstancedCubesDescriptor const &descriptor);
+  GeometryPtr create(PointCloudDescriptor const &descriptor);
+  GeometryPtr create(PolylineDescriptor const &descriptor);
 
 private:
   VisualizerImpl &visualizer_;
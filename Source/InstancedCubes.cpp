@@ -0,0 +1,196 @@
+#include "InstancedCubes.h"
+#include "Quantization.h"
+#include "VisualizerImpl.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace VolViz {
+namespace Private_ {
+
+namespace {
+
+/// Vertex of the shared unit cube [-1, 1]^3
+struct CubeVertex {
+  std::array<float, 3> position;
+  std::array<float, 3> normal;
+};
+
+/// Per instance data: center, radius and color of a cube
+struct InstanceData {
+  std::array<float, 4> centerAndRadius;
+  std::array<std::uint8_t, 4> color;
+};
+static_assert(sizeof(InstanceData) == 20, "Unexpected instance data size");
+
+/// Number of indices of the cube, two triangles per face
+GLsizei constexpr kCubeIndices = 36;
+
+} // namespace
+
+InstancedCubes::InstancedCubes(InstancedCubesDescriptor const &descriptor,
+                               VisualizerImpl &visualizer)
+    : Geometry(descriptor, visualizer) {
+  Expects(!descriptor.partialUpdate);
+
+  scale = descriptor.scale;
+  updateQueue_.enqueue(descriptor);
+}
+
+void InstancedCubes::doInit() {
+  using GL::Buffer;
+  using GL::VertexArray;
+
+  // Build the faces of the unit cube, with counter-clockwise winding seen
+  // from outside
+  std::vector<CubeVertex> vertices;
+  std::vector<std::uint8_t> indices;
+  for (int axis = 0; axis < 3; ++axis) {
+    for (auto sign : {1.f, -1.f}) {
+      Vector3f const n = sign * Vector3f::Unit(axis);
+      Vector3f u = Vector3f::Unit((axis + 1) % 3);
+      Vector3f v = Vector3f::Unit((axis + 2) % 3);
+      if (sign < 0.f) std::swap(u, v);
+
+      auto const first = static_cast<std::uint8_t>(vertices.size());
+      std::array<Vector3f, 4> const corners{
+          {n - u - v, n + u - v, n - u + v, n + u + v}};
+      for (auto const &corner : corners) {
+        vertices.push_back(
+            {{{corner(0), corner(1), corner(2)}}, {{n(0), n(1), n(2)}}});
+      }
+      for (auto i : {0, 1, 3, 0, 3, 2})
+        indices.push_back(static_cast<std::uint8_t>(first + i));
+    }
+  }
+
+  Buffer vertexBuffer;
+  vertexBuffer.upload(GL_ARRAY_BUFFER, vertices.size() * sizeof(CubeVertex),
+                      vertices.data(), GL_STATIC_DRAW);
+  Buffer indexBuffer;
+  indexBuffer.upload(GL_ELEMENT_ARRAY_BUFFER, indices.size(), indices.data(),
+                     GL_STATIC_DRAW);
+  Buffer instanceBuffer;
+  assertGL("Failed to upload cube");
+
+  VertexArray vao;
+  auto const vaoBinding = binding(vao);
+  indexBuffer.bind(GL_ELEMENT_ARRAY_BUFFER);
+
+  vertexBuffer.bind(GL_ARRAY_BUFFER);
+  vao.enableVertexAttribArray(0);
+  vao.enableVertexAttribArray(1);
+  glVertexAttribPointer(
+      0, 3, GL_FLOAT, false, sizeof(CubeVertex),
+      reinterpret_cast<void const *>(offsetof(CubeVertex, position)));
+  glVertexAttribPointer(
+      1, 3, GL_FLOAT, false, sizeof(CubeVertex),
+      reinterpret_cast<void const *>(offsetof(CubeVertex, normal)));
+
+  instanceBuffer.bind(GL_ARRAY_BUFFER);
+  vao.enableVertexAttribArray(2);
+  vao.enableVertexAttribArray(3);
+  glVertexAttribPointer(
+      2, 4, GL_FLOAT, false, sizeof(InstanceData),
+      reinterpret_cast<void const *>(offsetof(InstanceData, centerAndRadius)));
+  glVertexAttribPointer(
+      3, 4, GL_UNSIGNED_BYTE, true, sizeof(InstanceData),
+      reinterpret_cast<void const *>(offsetof(InstanceData, color)));
+  glVertexAttribDivisor(2, 1);
+  glVertexAttribDivisor(3, 1);
+  assertGL("Failed to setup vertex array");
+
+  cubeVertexBuffer_ = std::move(vertexBuffer);
+  cubeIndexBuffer_ = std::move(indexBuffer);
+  instanceBuffer_ = std::move(instanceBuffer);
+  vertexArrayObject_ = std::move(vao);
+
+  doUpdate();
+}
+
+void InstancedCubes::doRender(std::uint32_t, bool) {
+  if (nInstances_ == 0) return;
+
+  visualizer_.shaders()[Program::InstancedCubes].use();
+
+  auto const vaoBinding = GL::binding(vertexArrayObject_);
+  glDrawElementsInstanced(GL_TRIANGLES, kCubeIndices, GL_UNSIGNED_BYTE,
+                          nullptr, static_cast<GLsizei>(nInstances_));
+  assertGL("glDrawElementsInstanced failed");
+}
+
+void InstancedCubes::doUpdate() {
+  // Partial updates build on each other, so all of them are applied
+  InstancedCubesDescriptor descriptor;
+  while (updateQueue_.try_dequeue(descriptor)) uploadInstances(descriptor);
+}
+
+void InstancedCubes::uploadInstances(
+    InstancedCubesDescriptor const &descriptor) {
+  auto const n = static_cast<std::size_t>(descriptor.positions.rows());
+  Expects(descriptor.radii.rows() == 0 ||
+          static_cast<std::size_t>(descriptor.radii.rows()) == n);
+  Expects(descriptor.colors.rows() == 0 ||
+          static_cast<std::size_t>(descriptor.colors.rows()) == n);
+
+  std::vector<InstanceData> instances(n);
+  Box bounds;
+  for (std::size_t i = 0; i < n; ++i) {
+    auto const row = static_cast<Eigen::Index>(i);
+    auto const r =
+        descriptor.radii.rows() > 0 ? descriptor.radii(row) : descriptor.radius;
+    Color const c = descriptor.colors.rows() > 0
+                        ? Color(descriptor.colors.row(row).transpose())
+                        : descriptor.color;
+    instances[i].centerAndRadius = {{descriptor.positions(row, 0),
+                                     descriptor.positions(row, 1),
+                                     descriptor.positions(row, 2), r}};
+    instances[i].color = {{toUnorm8(c(0)), toUnorm8(c(1)), toUnorm8(c(2)),
+                           255}};
+    Position const center = descriptor.positions.row(row).transpose();
+    bounds.extend(center - Position::Constant(r));
+    bounds.extend(center + Position::Constant(r));
+  }
+
+  auto const instanceBinding =
+      GL::binding(instanceBuffer_, static_cast<GLenum>(GL_ARRAY_BUFFER));
+  if (descriptor.partialUpdate) {
+    Expects(descriptor.firstInstance + n <= nInstances_);
+    glBufferSubData(
+        GL_ARRAY_BUFFER,
+        static_cast<GLintptr>(descriptor.firstInstance * sizeof(InstanceData)),
+        static_cast<GLsizeiptr>(n * sizeof(InstanceData)), instances.data());
+    assertGL("glBufferSubData failed");
+    // the replaced cubes are kept in the bounds, which stay conservative
+    setModelBounds(modelBounds().merged(bounds));
+  } else {
+    scale = descriptor.scale;
+    color = descriptor.color;
+    glBufferData(GL_ARRAY_BUFFER,
+                 static_cast<GLsizeiptr>(n * sizeof(InstanceData)),
+                 instances.data(), GL_DYNAMIC_DRAW);
+    assertGL("glBufferData failed");
+    nInstances_ = n;
+    setModelBounds(bounds);
+  }
+}
+
+void InstancedCubes::doEnqueueUpdate(GeometryDescriptor const &descriptor) {
+  updateQueue_.enqueue(
+      dynamic_cast<InstancedCubesDescriptor const &>(descriptor));
+}
+
+void InstancedCubes::doEnqueueUpdate(GeometryDescriptor &&descriptor) {
+  updateQueue_.enqueue(
+      std::move(dynamic_cast<InstancedCubesDescriptor &&>(descriptor)));
+}
+
+Geometry::RenderState InstancedCubes::doRenderState() const {
+  return {visualizer_.shaders()[Program::InstancedCubes].id(),
+          vertexArrayObject_.name};
+}
+
+} // namespace Private_
+} // namespace VolViz
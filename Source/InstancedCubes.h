@@ -0,0 +1,51 @@
+#pragma once
+
+#include "GL/Buffer.h"
+#include "GL/VertexArray.h"
+#include "Geometry.h"
+#include "Types.h"
+
+#include <concurrentqueue.h>
+
+namespace VolViz {
+namespace Private_ {
+
+/// Many cubes rendered with a single instanced draw call. The cube geometry
+/// is shared, the center, radius and color of each cube are stored in a per
+/// instance vertex buffer.
+class InstancedCubes : public Geometry {
+public:
+  InstancedCubes(InstancedCubesDescriptor const &descriptor,
+                 VisualizerImpl &visualizer);
+
+protected:
+  virtual void doInit() override;
+
+  virtual void doRender(std::uint32_t index, bool selected) override;
+
+  virtual void doUpdate() override;
+
+  virtual void doEnqueueUpdate(GeometryDescriptor const &descriptor) override;
+  virtual void doEnqueueUpdate(GeometryDescriptor &&descriptor) override;
+
+  virtual RenderState doRenderState() const override;
+
+private:
+  using UpdateQueue = moodycamel::ConcurrentQueue<InstancedCubesDescriptor>;
+
+  /// Uploads the instances of the descriptor, either replacing all instances
+  /// or only a range of them
+  void uploadInstances(InstancedCubesDescriptor const &descriptor);
+
+  UpdateQueue updateQueue_;
+
+  GL::Buffer cubeVertexBuffer_{0};
+  GL::Buffer cubeIndexBuffer_{0};
+  GL::Buffer instanceBuffer_{0};
+  GL::VertexArray vertexArrayObject_{0};
+
+  std::size_t nInstances_{0};
+};
+
+} // namespace Private_
+} // namespace VolViz
@@ -0,0 +1,105 @@
+#include "LightCuller.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace VolViz {
+namespace Private_ {
+
+namespace {
+
+/// Smallest w of a projected corner, corners closer to the camera make the
+/// light cover the whole screen
+constexpr float kMinW = 1e-6f;
+
+} // namespace
+
+constexpr std::size_t LightCuller::kTileSize;
+
+void LightCuller::reset(Eigen::Vector2f const &renderSize,
+                        Matrix4 const &projectionMatrix) {
+  renderSize_ = renderSize.cwiseMax(1.f);
+  projectionMatrix_ = projectionMatrix;
+
+  auto const tileSize = static_cast<float>(kTileSize);
+  tileCount_ = (renderSize_ / tileSize).array().ceil().cast<std::size_t>();
+  footprints_.clear();
+}
+
+bool LightCuller::addLight(std::uint16_t index, Vector3f const &center,
+                           float radius) {
+  // corners of the bounding box of the sphere, projected at once
+  Eigen::Matrix<float, 4, 8> corners;
+  for (Eigen::Index i = 0; i < 8; ++i) {
+    corners.col(i) << center(0) + ((i & 1) ? radius : -radius),
+        center(1) + ((i & 2) ? radius : -radius),
+        center(2) + ((i & 4) ? radius : -radius), 1.f;
+  }
+  Eigen::Matrix<float, 4, 8> const projected = projectionMatrix_ * corners;
+
+  auto const w = projected.row(3).array();
+  if ((w <= kMinW).all()) return false;
+
+  Footprint footprint{index, {{0, 0}}, {{0, 0}}};
+  if ((w <= kMinW).any()) {
+    // the box reaches behind the camera, where its projection is unbounded
+    footprint.max = {{tileCount_(0) - 1, tileCount_(1) - 1}};
+    footprints_.push_back(footprint);
+    return true;
+  }
+
+  Eigen::Array<float, 2, 8> const ndc =
+      projected.topRows<2>().array().rowwise() / w;
+  Eigen::Array2f const ndcMin = ndc.rowwise().minCoeff();
+  Eigen::Array2f const ndcMax = ndc.rowwise().maxCoeff();
+  if ((ndcMax < -1.f).any() || (ndcMin > 1.f).any()) return false;
+
+  auto const tileSize = static_cast<float>(kTileSize);
+  for (Eigen::Index d = 0; d < 2; ++d) {
+    auto const toTile = [&](float x) {
+      auto const pixel = (0.5f * x + 0.5f) * renderSize_(d);
+      auto const tile = std::floor(pixel / tileSize);
+      auto const maxTile = static_cast<float>(tileCount_(d) - 1);
+      return static_cast<std::size_t>(std::min(maxTile, std::max(0.f, tile)));
+    };
+    auto const i = static_cast<std::size_t>(d);
+    footprint.min[i] = toTile(ndcMin(d));
+    footprint.max[i] = toTile(ndcMax(d));
+  }
+  footprints_.push_back(footprint);
+  return true;
+}
+
+void LightCuller::assign() {
+  auto const width = tileCount_(0);
+  tiles_.assign(tileCount_(0) * tileCount_(1), Tile{{0, 0}});
+
+  // count the lights per tile, then compute the offsets of the lists and
+  // fill them
+  for (auto const &footprint : footprints_) {
+    for (auto y = footprint.min[1]; y <= footprint.max[1]; ++y) {
+      for (auto x = footprint.min[0]; x <= footprint.max[0]; ++x)
+        ++tiles_[y * width + x][1];
+    }
+  }
+
+  std::uint32_t offset = 0;
+  for (auto &tile : tiles_) {
+    tile[0] = offset;
+    offset += tile[1];
+    tile[1] = 0;
+  }
+
+  indices_.resize(offset);
+  for (auto const &footprint : footprints_) {
+    for (auto y = footprint.min[1]; y <= footprint.max[1]; ++y) {
+      for (auto x = footprint.min[0]; x <= footprint.max[0]; ++x) {
+        auto &tile = tiles_[y * width + x];
+        indices_[tile[0] + tile[1]++] = footprint.index;
+      }
+    }
+  }
+}
+
+} // namespace Private_
+} // namespace VolViz
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Types.h"
+
+#include <Eigen/Core>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace VolViz {
+namespace Private_ {
+
+/// Assigns point and spot lights to screen tiles, so that the lighting pass
+/// only evaluates the lights that may touch the pixels of a tile.
+///
+/// The lights are bounded by a sphere in view space. The screen space bounds
+/// of the sphere are computed from the projected corners of its bounding box,
+/// which is conservative, but only needs a single matrix product per light.
+class LightCuller {
+public:
+  /// Width and height of a tile in pixels
+  static constexpr std::size_t kTileSize = 16;
+
+  /// First light index and number of lights of a tile
+  using Tile = std::array<std::uint32_t, 2>;
+
+  /// Starts the assignment of a frame
+  /// @param renderSize size of the rendered image in pixels
+  void reset(Eigen::Vector2f const &renderSize,
+             Matrix4 const &projectionMatrix);
+
+  /// Adds a light bounded by the given sphere in view space
+  /// @return false if the light is outside of the view, it is not assigned
+  /// to any tile then
+  bool addLight(std::uint16_t index, Vector3f const &center, float radius);
+
+  /// Builds the light lists of the tiles from the added lights
+  void assign();
+
+  /// Number of tiles in x and y direction
+  inline Size2 const &tileCount() const noexcept { return tileCount_; }
+
+  /// Light lists of the tiles, row by row starting in the lower left corner
+  inline std::vector<Tile> const &tiles() const noexcept { return tiles_; }
+
+  /// Indices of the lights, the tiles refer to ranges of it
+  inline std::vector<std::uint16_t> const &indices() const noexcept {
+    return indices_;
+  }
+
+private:
+  /// Tiles touched by a light, the maximum is inclusive
+  struct Footprint {
+    std::uint16_t index;
+    std::array<std::size_t, 2> min, max;
+  };
+
+  Eigen::Vector2f renderSize_{Eigen::Vector2f::Ones()};
+  Matrix4 projectionMatrix_{Matrix4::Identity()};
+  Size2 tileCount_{Size2::Ones()};
+  std::vector<Footprint> footprints_;
+  std::vector<Tile> tiles_;
+  std::vector<std::uint16_t> indices_;
+};
+
+} // namespace Private_
+} // namespace VolViz
@@ -1,149 +1,475 @@
 #include "Mesh.h"
+#include "Quantization.h"
 #include "VisualizerImpl.h"
+#include "WorkerPool.h"
 
 #include <Eigen/Geometry>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <numeric>
 
 namespace VolViz {
 namespace Private_ {
 
 using Lock = std::lock_guard<std::mutex>;
 
+namespace {
+
+/// Levels of detail with fewer triangles are drawn without meshlet culling
+Eigen::Index constexpr kMinMeshletCullingTriangles = 16 * 128;
+
+/// Maps a unit vector to a point in [-1, 1]^2 using the octahedral mapping
+inline Eigen::Vector2f encodeOctahedral(Vector3f const &n) noexcept {
+  using std::abs;
+
+  auto const l1Norm = abs(n(0)) + abs(n(1)) + abs(n(2));
+  if (l1Norm <= 0.f) return Eigen::Vector2f::Zero();
+
+  Eigen::Vector2f e = n.head<2>() / l1Norm;
+  if (n(2) < 0.f) {
+    auto const signNotZero = [](float x) { return x >= 0.f ? 1.f : -1.f; };
+    e = Eigen::Vector2f((1.f - abs(e(1))) * signNotZero(e(0)),
+                        (1.f - abs(e(0))) * signNotZero(e(1)));
+  }
+  return e;
+}
+
+inline MeshPool::Vertex packVertex(Position const &p, Vector3f const &n,
+                                   QuantizationBox const &box) noexcept {
+  MeshPool::Vertex v;
+  v.position = box.toUnorm16(p);
+  v.padding = 0;
+  v.normal = toSnorm16(encodeOctahedral(n));
+  return v;
+}
+
+} // namespace
+
 Mesh::Mesh(MeshDescriptor const &descriptor, VisualizerImpl &visualizer)
     : Geometry(descriptor, visualizer) {
+  Expects(descriptor.update == MeshDescriptor::Part::All);
   scale = descriptor.scale;
   updateQueue_.enqueue(descriptor);
 }
 
+Mesh::~Mesh() {
+  // abort running level of detail jobs and wait for them, queued jobs return
+  // right away
+  ++generation_;
+  for (auto &job : jobs_) job.wait();
+}
+
 void Mesh::doInit() { uploadMesh(); }
 
 void Mesh::doRender(std::uint32_t index, bool selected) {
+  if (levels_.empty()) return;
+
   Length const rScale = visualizer_.cachedScale;
   auto cameraClient = visualizer_.cameraClient();
-  auto &shaders = visualizer_.shaders();
-
-  auto const viewMat = cameraClient.viewMatrix(rScale);
-  auto const destScale = static_cast<float>(scale / rScale);
-  // auto const volSize = visualizer_.volumeSize();
-
-  Matrix4 const modelMat =
-      (Eigen::Translation3f(position) * orientation * Eigen::Scaling(destScale))
-          .matrix();
-  // Matrix4 const modelMat = (Eigen::Translation3f(position * destScale) *
-  //                           orientation * volSize.asDiagonal())
-  //                              .matrix();
-  Matrix4 const modelViewMat = (viewMat * modelMat).eval();
-  Matrix3 const inverseModelViewMatrix =
-      modelViewMat.block<3, 3>(0, 0).inverse();
-
-  // Setup shader uniforms
-  assertGL("Pevious OpenGL error");
-  shaders["geometryStage"].use();
-  visualizer_.attachVolumeToShader(shaders["geometryStage"]);
-  shaders["geometryStage"]["index"] = index;
-  shaders["geometryStage"]["color"] = selected ? (color * 1.2f).eval() : color;
-  shaders["geometryStage"]["shininess"] = selected ? 10.0f : 1000.f;
-  shaders["geometryStage"]["modelViewProjectionMatrix"] =
-      (cameraClient.projectionMatrix() * modelViewMat).eval();
-  shaders["geometryStage"]["inverseModelViewMatrix"] = inverseModelViewMatrix;
-  shaders["geometryStage"]["textureTransformMatrix"] =
-      (visualizer_.textureTransformationMatrix() * modelMat).eval();
 
+  Matrix4 const viewMat = cameraClient.viewMatrix(rScale);
+  Matrix4 const projMat = cameraClient.projectionMatrix();
+  Matrix4 const modelViewMat = viewMat * modelMatrix(rScale);
+  Matrix4 const modelViewProjectionMat = projMat * modelViewMat;
+
+  auto const &lod = levels_[selectLevelOfDetail(modelViewMat)];
+
+  drawRanges_.clear();
+  if (lod.meshlets.empty()) {
+    drawRanges_.push_back(
+        {0u, narrow_cast<std::uint32_t>(lod.numTriangles)});
+  } else {
+    Position const viewerPosition =
+        modelViewMat.inverse().block<3, 1>(0, 3);
+    drawRanges_ =
+        cullMeshlets(lod.meshlets, Frustum::fromMatrix(modelViewProjectionMat),
+                     viewerPosition, cullBackFaces_);
+  }
+  if (drawRanges_.empty()) return;
+
+  auto &pool = visualizer_.meshPool();
+
+  // Meshes without scalars are drawn together by the mesh pool
+  if (scalars_.rows() == 0) {
+    MeshPool::DrawRecord record;
+    record.object =
+        objectUniforms(viewMat, visualizer_.projectionMatrix(), rScale, index,
+                       selected);
+    record.positionOffset = {{lod.positionOffset(0), lod.positionOffset(1),
+                              lod.positionOffset(2), 0.f}};
+    record.positionScale = {{lod.positionScale(0), lod.positionScale(1),
+                             lod.positionScale(2), 0.f}};
+    pool.queueDraw(lod.allocation, record, drawRanges_, cullBackFaces_);
+    return;
+  }
+
+  // Meshes with scalars have their own colormap and are drawn one by one.
+  // The common uniforms are in the uniform blocks.
+  auto &program = visualizer_.shaders()[Program::GeometryStage];
+  assertGL("Pevious OpenGL error");
+  program.use();
+  program["useScalars"] = static_cast<GLint>(true);
+  // always set, two samplers of different type must not share a unit
+  program["colormap"] = static_cast<GLint>(1);
+  program["colormapSize"] = static_cast<float>(colormapSize_);
+  program["scalarRange"] = Eigen::Vector2f(scalarRange_.min, scalarRange_.max);
+  program["positionOffset"] = lod.positionOffset;
+  program["positionScale"] = lod.positionScale;
   assertGL("Setting uniforms failed");
 
-  auto const vaoBinding = GL::binding(vertexArrayObject_);
-  glDrawElements(GL_TRIANGLES, 3 * static_cast<GLsizei>(numTriangles_),
-                 GL_UNSIGNED_INT, nullptr);
-  assertGL("glDrawElements failed");
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_1D, colormapTexture_.names[0]);
+  glActiveTexture(GL_TEXTURE0);
+
+  drawCounts_.clear();
+  drawOffsets_.clear();
+  drawBaseVertices_.clear();
+  for (auto const &range : drawRanges_) {
+    auto const firstIndex = lod.allocation.firstIndex() + 3 * range.min;
+    drawCounts_.push_back(3 * static_cast<GLsizei>(range.length()));
+    drawOffsets_.push_back(reinterpret_cast<void const *>(
+        static_cast<std::uintptr_t>(sizeof(std::uint32_t) * firstIndex)));
+    drawBaseVertices_.push_back(lod.allocation.baseVertex());
+  }
+
+  auto const vaoBinding = GL::binding(pool.vertexArrayObject());
+  if (cullBackFaces_) glEnable(GL_CULL_FACE);
+  glMultiDrawElementsBaseVertex(
+      GL_TRIANGLES, drawCounts_.data(), GL_UNSIGNED_INT, drawOffsets_.data(),
+      static_cast<GLsizei>(drawCounts_.size()), drawBaseVertices_.data());
+  assertGL("glMultiDrawElementsBaseVertex failed");
+  if (cullBackFaces_) glDisable(GL_CULL_FACE);
 }
 
-void Mesh::doUpdate() { uploadMesh(); }
+void Mesh::doUpdate() {
+  uploadMesh();
+  uploadLevelsOfDetail();
+  updateTriangleBVH();
+
+  // forget about finished jobs
+  using namespace std::chrono_literals;
+  jobs_.erase(std::remove_if(jobs_.begin(), jobs_.end(),
+                             [](auto const &job) {
+                               return job.wait_for(0s) ==
+                                      std::future_status::ready;
+                             }),
+              jobs_.end());
+}
 
-void Mesh::uploadMesh() {
-  using GL::Buffer;
-  using GL::VertexArray;
+std::size_t Mesh::selectLevelOfDetail(Matrix4 const &modelViewMat) const {
+  // Number of pixels a triangle should cover at least
+  float constexpr kPixelsPerTriangle = 2.f;
+
+  if (levels_.size() < 2) return 0;
+
+  auto const projMat = visualizer_.cameraClient().projectionMatrix();
+  PositionH const center =
+      modelViewMat * boundingSphereCenter_.homogeneous();
+  // The model view matrix only contains uniform scaling, so the norm of any
+  // column is the scale factor
+  auto const radius =
+      boundingSphereRadius_ * modelViewMat.block<3, 1>(0, 0).norm();
+  float const w = projMat.row(3) * center;
+
+  // Always use full resolution if the camera is inside the bounding sphere
+  if (w <= radius) return 0;
+
+  auto const windowHeight = visualizer_.renderSize()(1);
+  auto const projectedDiameter = projMat(1, 1) * radius / w * windowHeight;
+  auto const projectedArea =
+      static_cast<float>(M_PI) / 4.f * projectedDiameter * projectedDiameter;
+  auto const requiredTriangles =
+      static_cast<std::size_t>(projectedArea / kPixelsPerTriangle);
+
+  // choose the coarsest level that has enough triangles, or an even coarser
+  // one while the quality is lowered
+  std::size_t level = 0;
+  for (auto i = levels_.size() - 1; i > 0; --i) {
+    if (levels_[i].numTriangles >= requiredTriangles) {
+      level = i;
+      break;
+    }
+  }
+  return std::min(level + visualizer_.levelOfDetailBias(), levels_.size() - 1);
+}
 
+void Mesh::uploadMesh() {
   MeshDescriptor descriptor;
 
   if (!updateQueue_.try_dequeue(descriptor)) return;
 
-  auto const N = descriptor.vertices.rows();
-  auto const M = descriptor.indices.rows();
-  auto const vertBuffSize = N * 8 * narrow_cast<int>(sizeof(float));
-  auto const indexBufferSize = M * 3 * narrow_cast<int>(sizeof(std::uint32_t));
-
-  // Create and map vertex buffer
-  Buffer vertBuffer;
-  auto const vertBinding =
-      binding(vertBuffer, static_cast<GLenum>(GL_ARRAY_BUFFER));
-  glBufferData(GL_ARRAY_BUFFER, vertBuffSize, nullptr, GL_STATIC_DRAW);
-  assertGL("glBufferData failed");
-  float *mappedVertBuffer =
-      reinterpret_cast<float *>(glMapBuffer(GL_ARRAY_BUFFER, GL_READ_WRITE));
-
-  Ensures(mappedVertBuffer != nullptr);
-
-  Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, 8, Eigen::RowMajor>> vertices(
-      mappedVertBuffer, N, 8);
-
-  // Create and map index buffer
-  Buffer indexBuffer;
-  auto const indexBinding =
-      binding(indexBuffer, static_cast<GLenum>(GL_ELEMENT_ARRAY_BUFFER));
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBufferSize, nullptr,
-               GL_STATIC_DRAW);
-  std::uint32_t *mappedIndexBuffer = reinterpret_cast<std::uint32_t *>(
-      glMapBuffer(GL_ELEMENT_ARRAY_BUFFER, GL_WRITE_ONLY));
-  Ensures(mappedIndexBuffer != nullptr);
-  Eigen::Map<Eigen::Matrix<std::uint32_t, Eigen::Dynamic, 3, Eigen::RowMajor>>
-      indices(mappedIndexBuffer, M, 3);
+  if (descriptor.update != MeshDescriptor::Part::All) {
+    updateScalars(std::move(descriptor));
+    return;
+  }
 
-  assertGL("Failed to create or map buffers");
+  Expects(descriptor.scalars.rows() == 0 ||
+          descriptor.scalars.rows() == descriptor.vertices.rows());
+
+  cullBackFaces_ = descriptor.cullBackFaces;
+  numVertices_ = descriptor.vertices.rows();
+  scalars_ = std::move(descriptor.scalars);
+  scalarRange_ = descriptor.scalarRange;
+  uploadColormap(descriptor.colormap);
+
+  // Drop the levels of detail of the previous mesh and abort running jobs
+  ++generation_;
+  levels_.clear();
+  triangleBVH_.reset();
+  levels_.push_back(
+      createLevelOfDetail(descriptor.vertices, descriptor.indices));
+  uploadScalars(levels_.back());
+
+  // compute bounding sphere
+  auto const &V = descriptor.vertices;
+  if (V.rows() > 0) {
+    Position const min = V.colwise().minCoeff();
+    Position const max = V.colwise().maxCoeff();
+    setModelBounds(Box(min, max));
+    boundingSphereCenter_ = (min + max) / 2;
+    boundingSphereRadius_ =
+        std::sqrt((V.rowwise() - boundingSphereCenter_.transpose())
+                      .rowwise()
+                      .squaredNorm()
+                      .maxCoeff());
+  } else {
+    setModelBounds(Box());
+    boundingSphereCenter_ = Position::Zero();
+    boundingSphereRadius_ = 0.f;
+  }
 
-  // copy vertices
-  for (int i = 0; i < N; ++i) {
-    vertices.row(i) << descriptor.vertices.row(i), 0.f, 0.f, 0.f, 0.f, 0.f;
+  if (descriptor.optimizeForRendering ||
+      (descriptor.generateLevelsOfDetail &&
+       !descriptor.levelOfDetailRatios.empty())) {
+    buildTriangleBVH(descriptor.vertices, descriptor.indices);
+    processMesh(std::move(descriptor));
+  } else {
+    buildTriangleBVH(std::move(descriptor.vertices),
+                     std::move(descriptor.indices));
   }
+}
 
-  // copy indices
-  indices = descriptor.indices;
+void Mesh::buildTriangleBVH(TriangleBVH::Vertices vertices,
+                            TriangleBVH::Indices indices) {
+  auto job = [
+    this, generation = generation_.load(), v = std::move(vertices),
+    i = std::move(indices)
+  ]() {
+    auto const isOutdated = [this, generation]() {
+      return generation_ != generation;
+    };
+    if (isOutdated()) return;
+    auto bvh = std::make_shared<TriangleBVH const>(v, i, isOutdated);
+    if (isOutdated()) return;
+    triangleBVHQueue_.enqueue({generation, std::move(bvh)});
+    visualizer_.markSceneChanged();
+  };
+
+  jobs_.push_back(WorkerPool::shared().submit(std::move(job)));
+}
+
+void Mesh::updateTriangleBVH() {
+  TriangleBVHData data;
+  while (triangleBVHQueue_.try_dequeue(data)) {
+    if (data.generation == generation_) triangleBVH_ = std::move(data.bvh);
+  }
+}
+
+std::shared_ptr<TriangleBVH const> Mesh::doTriangleBVH() const {
+  return triangleBVH_;
+}
+
+void Mesh::uploadLevelsOfDetail() {
+  LevelOfDetailData data;
+  while (levelOfDetailQueue_.try_dequeue(data)) {
+    // skip levels of outdated meshes
+    if (data.generation != generation_) continue;
+
+    if (data.level != 0 && data.level != levels_.size()) continue;
+
+    auto lod = createLevelOfDetail(data.mesh.vertices, data.mesh.indices);
+    lod.sourceVertices = std::move(data.mesh.sourceVertices);
+    uploadScalars(lod);
+
+    // the optimized full resolution mesh replaces the unoptimized one
+    if (data.level == 0) {
+      levels_.front() = std::move(lod);
+      visualizer_.meshOptimized(data.cacheMissRatioBefore,
+                                data.cacheMissRatioAfter);
+    } else
+      levels_.push_back(std::move(lod));
+  }
+}
+
+void Mesh::updateScalars(MeshDescriptor &&descriptor) {
+  scalarRange_ = descriptor.scalarRange;
+  uploadColormap(descriptor.colormap);
+  if (descriptor.update == MeshDescriptor::Part::Colormap) return;
+
+  Expects(descriptor.scalars.rows() == 0 ||
+          descriptor.scalars.rows() == numVertices_);
+  scalars_ = std::move(descriptor.scalars);
+  for (auto &lod : levels_) uploadScalars(lod);
+}
+
+void Mesh::uploadScalars(LevelOfDetail const &lod) const {
+  if (scalars_.rows() == 0) return;
+
+  // Levels of detail only have a subset of the vertices
+  std::vector<float> scalars;
+  if (lod.sourceVertices.empty()) {
+    scalars.assign(scalars_.data(), scalars_.data() + scalars_.rows());
+  } else {
+    scalars.reserve(lod.sourceVertices.size());
+    for (auto v : lod.sourceVertices)
+      scalars.push_back(scalars_(static_cast<Eigen::Index>(v)));
+  }
+  visualizer_.meshPool().uploadScalars(lod.allocation, scalars);
+}
+
+void Mesh::uploadColormap(Colormap const &colormap) {
+  Expects(!colormap.empty());
+
+  std::vector<float> texels;
+  texels.reserve(3 * colormap.size());
+  for (auto const &c : colormap)
+    texels.insert(texels.end(), c.data(), c.data() + 3);
+
+  if (colormapTexture_.names[0] == 0) colormapTexture_ = GL::Textures<1>();
+  colormapSize_ = narrow_cast<GLsizei>(colormap.size());
+
+  // use the unit the texture is bound to when rendering
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_1D, colormapTexture_.names[0]);
+  glTexImage1D(GL_TEXTURE_1D, 0, GL_RGB32F, colormapSize_, 0, GL_RGB,
+               GL_FLOAT, texels.data());
+  glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_1D, 0);
+  glActiveTexture(GL_TEXTURE0);
+  assertGL("Failed to upload colormap");
+}
+
+void Mesh::processMesh(MeshDescriptor &&descriptor) {
+  Expects(std::is_sorted(descriptor.levelOfDetailRatios.rbegin(),
+                         descriptor.levelOfDetailRatios.rend()));
+
+  if (!descriptor.generateLevelsOfDetail)
+    descriptor.levelOfDetailRatios.clear();
+
+  auto job = [
+    this, generation = generation_.load(),
+    optimize = descriptor.optimizeForRendering,
+    ratios = std::move(descriptor.levelOfDetailRatios),
+    vertices = std::move(descriptor.vertices),
+    indices = std::move(descriptor.indices)
+  ]() {
+    auto const isOutdated = [this, generation]() {
+      return generation_ != generation;
+    };
+    if (isOutdated()) return;
+    auto const nTriangles = static_cast<float>(indices.rows());
+
+    SimplifiedMesh previous;
+    previous.vertices = vertices;
+    previous.indices = indices;
+    previous.sourceVertices.resize(static_cast<std::size_t>(vertices.rows()));
+    std::iota(previous.sourceVertices.begin(), previous.sourceVertices.end(),
+              0u);
+
+    if (optimize) {
+      auto const nVertices = static_cast<std::size_t>(vertices.rows());
+      auto const acmrBefore = computeACMR(previous.indices, nVertices);
+      optimizeMeshForRendering(previous);
+      if (isOutdated()) return;
+
+      auto const acmrAfter = computeACMR(
+          previous.indices, static_cast<std::size_t>(previous.vertices.rows()));
+      levelOfDetailQueue_.enqueue(
+          {generation, 0, previous, acmrBefore, acmrAfter});
+      visualizer_.markSceneChanged();
+    }
+
+    // Each level is generated from the previous one, which is much faster
+    // than starting from the full resolution mesh each time
+    for (std::size_t i = 0; i < ratios.size(); ++i) {
+      auto const target = static_cast<std::size_t>(ratios[i] * nTriangles);
+      auto mesh = simplifyMesh(previous.vertices, previous.indices, target,
+                               isOutdated);
+      if (isOutdated()) return;
+
+      // map source vertices to the full resolution mesh
+      for (auto &s : mesh.sourceVertices) s = previous.sourceVertices[s];
+      if (optimize) optimizeMeshForRendering(mesh);
+
+      previous = mesh;
+      levelOfDetailQueue_.enqueue({generation, i + 1, std::move(mesh)});
+      visualizer_.markSceneChanged();
+    }
+  };
+
+  jobs_.push_back(WorkerPool::shared().submit(std::move(job)));
+}
+
+Mesh::LevelOfDetail
+Mesh::createLevelOfDetail(SimplifiedMesh::Vertices const &meshVertices,
+                          SimplifiedMesh::Indices const &meshIndices) const {
+  auto const N = meshVertices.rows();
+  auto const M = meshIndices.rows();
 
   // compute normals
+  Eigen::Matrix<float, Eigen::Dynamic, 3> normals =
+      Eigen::Matrix<float, Eigen::Dynamic, 3>::Zero(N, 3);
   for (int i = 0; i < M; ++i) {
-    auto const &I = descriptor.indices;
-    auto &V = vertices;
-    Vector3f const normal =
-        (V.row(I(i, 1)) - V.row(I(i, 0)))
-            .head<3>()
-            .cross((V.row(I(i, 2)) - V.row(I(i, 0))).head<3>())
-            .normalized();
-    V.block<1, 3>(I(i, 0), 4) += normal;
-    V.block<1, 3>(I(i, 1), 4) += normal;
-    V.block<1, 3>(I(i, 2), 4) += normal;
+    auto const &I = meshIndices;
+    auto const &V = meshVertices;
+    Vector3f const normal = (V.row(I(i, 1)) - V.row(I(i, 0)))
+                                .cross(V.row(I(i, 2)) - V.row(I(i, 0)))
+                                .normalized();
+    normals.row(I(i, 0)) += normal;
+    normals.row(I(i, 1)) += normal;
+    normals.row(I(i, 2)) += normal;
   }
 
-  // normalize normals
-  for (int i = 0; i < N; ++i) vertices.block<1, 3>(i, 4).normalize();
-
-  // unmap buffers
-  glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
-  glUnmapBuffer(GL_ARRAY_BUFFER);
+  // Split large levels into meshlets, which reorders the triangles
+  Meshlets meshlets;
+  SimplifiedMesh::Indices reorderedIndices;
+  if (M >= kMinMeshletCullingTriangles) {
+    reorderedIndices = meshIndices;
+    meshlets = buildMeshlets(meshVertices, reorderedIndices);
+  }
 
-  // setup VAO
-  VertexArray vao;
-  auto const vaoBinding = binding(vao);
-  indexBuffer.bind(GL_ELEMENT_ARRAY_BUFFER);
-  vao.enableVertexAttribArray(0);
-  vao.enableVertexAttribArray(1);
-  glVertexAttribPointer(0, 3, GL_FLOAT, false, 8 * sizeof(float), nullptr);
-  glVertexAttribPointer(1, 3, GL_FLOAT, false, 8 * sizeof(float),
-                        reinterpret_cast<void const *>(4 * sizeof(float)));
+  // Positions are quantized relative to the bounding box
+  auto const box = QuantizationBox::of(meshVertices);
+  std::vector<MeshPool::Vertex> vertices(static_cast<std::size_t>(N));
+  for (int i = 0; i < N; ++i) {
+    vertices[static_cast<std::size_t>(i)] = packVertex(
+        meshVertices.row(i).transpose(), normals.row(i).transpose(), box);
+  }
 
-  vertexBuffer_ = std::move(vertBuffer);
-  indexBuffer_ = std::move(indexBuffer);
-  vertexArrayObject_ = std::move(vao);
-  numTriangles_ = static_cast<std::size_t>(M);
+  // copy indices, the triangles of a row are stored one after another
+  std::vector<std::uint32_t> indexData(static_cast<std::size_t>(3 * M));
+  Eigen::Map<Eigen::Matrix<std::uint32_t, Eigen::Dynamic, 3, Eigen::RowMajor>>
+      indices(indexData.data(), M, 3);
+  if (meshlets.empty())
+    indices = meshIndices;
+  else
+    indices = reorderedIndices;
+
+  LevelOfDetail lod;
+  lod.allocation = visualizer_.meshPool().allocate(vertices, indexData);
+  lod.numTriangles = static_cast<std::size_t>(M);
+  lod.positionOffset = box.offset;
+  lod.positionScale = box.scale;
+  lod.meshlets = std::move(meshlets);
+  return lod;
 }
 
 void Mesh::doEnqueueUpdate(GeometryDescriptor const &descriptor) {
@@ -154,5 +480,21 @@ void Mesh::doEnqueueUpdate(GeometryDescriptor &&descriptor) {
   updateQueue_.enqueue(std::move(dynamic_cast<MeshDescriptor &&>(descriptor)));
 }
 
+Geometry::Material Mesh::doMaterial(bool selected) const {
+  // with scalars, the color only brightens selected meshes
+  Color const baseColor = scalars_.rows() > 0 ? Colors::White() : color;
+  return {selected ? (baseColor * 1.2f).eval() : baseColor,
+          selected ? 10.f : 1000.f};
+}
+
+Geometry::RenderState Mesh::doRenderState() const {
+  // all levels of detail share the vertex array of the mesh pool, meshes
+  // without scalars are drawn by the batch program
+  auto const program =
+      scalars_.rows() == 0 ? Program::MeshBatch : Program::GeometryStage;
+  return {visualizer_.shaders()[program].id(),
+          visualizer_.meshPool().vertexArrayObject().name};
+}
+
 } // namespace Private_
 } // namespace VolViz
@@ -1,12 +1,21 @@
 #pragma once
 
-#include "GL/Buffer.h"
-#include "GL/VertexArray.h"
+#include "BVH.h"
+#include "GL/Textures.h"
 #include "Geometry.h"
+#include "MeshOptimization.h"
+#include "MeshPool.h"
+#include "MeshSimplification.h"
+#include "Meshlets.h"
 #include "Types.h"
 
 #include <concurrentqueue.h>
 
+#include <atomic>
+#include <future>
+#include <memory>
+#include <vector>
+
 namespace VolViz {
 namespace Private_ {
 
@@ -14,6 +23,8 @@ class Mesh : public Geometry {
 public:
   Mesh(MeshDescriptor const &descriptor, VisualizerImpl &visualizer);
 
+  virtual ~Mesh();
+
 protected:
   virtual void doInit() override;
 
@@ -24,18 +35,124 @@ protected:
   virtual void doEnqueueUpdate(GeometryDescriptor const &descriptor) override;
   virtual void doEnqueueUpdate(GeometryDescriptor &&descriptor) override;
 
+  virtual std::shared_ptr<TriangleBVH const> doTriangleBVH() const override;
+
+  virtual RenderState doRenderState() const override;
+
+  virtual Material doMaterial(bool selected) const override;
+
 private:
   using UpdateQueue = moodycamel::ConcurrentQueue<MeshDescriptor>;
+
+  /// Single level of detail, its vertices and indices are stored in the
+  /// mesh pool
+  struct LevelOfDetail {
+    MeshPool::Allocation allocation;
+    std::size_t numTriangles{0};
+    /// Dequantization parameters of the vertex positions, i.e.
+    /// position = positionOffset + positionScale * quantizedPosition
+    Position positionOffset{Position::Zero()};
+    Position positionScale{Position::Ones()};
+    /// Meshlets for culling, empty if the level is too small to benefit
+    Meshlets meshlets;
+    /// Vertex of the full resolution mesh each vertex originates from, empty
+    /// if the vertices are the ones of the full resolution mesh
+    std::vector<std::uint32_t> sourceVertices;
+  };
+
+  /// An optimized or simplified mesh, generated by a background job
+  struct LevelOfDetailData {
+    /// Generation of the mesh the level was generated from
+    std::uint32_t generation;
+    std::size_t level;
+    SimplifiedMesh mesh;
+    /// ACMR of the full resolution mesh before and after its optimization
+    float cacheMissRatioBefore{0.f};
+    float cacheMissRatioAfter{0.f};
+  };
+  using LevelOfDetailQueue = moodycamel::ConcurrentQueue<LevelOfDetailData>;
+
+  /// BVH of the full resolution mesh, built by a background job
+  struct TriangleBVHData {
+    std::uint32_t generation;
+    std::shared_ptr<TriangleBVH const> bvh;
+  };
+  using TriangleBVHQueue = moodycamel::ConcurrentQueue<TriangleBVHData>;
+
   void uploadMesh();
 
+  /// Replaces the scalars and the colormap, keeping the vertices
+  void updateScalars(MeshDescriptor &&descriptor);
+
+  /// Uploads the scalars of the vertices of the level of detail
+  void uploadScalars(LevelOfDetail const &lod) const;
+
+  /// Uploads the colormap into the lookup texture
+  void uploadColormap(Colormap const &colormap);
+
+  /// Uploads all levels of detail that were finished by the background job
+  void uploadLevelsOfDetail();
+
+  /// Starts a background job that optimizes the mesh for rendering and
+  /// generates the levels of detail, as requested by the descriptor
+  void processMesh(MeshDescriptor &&descriptor);
+
+  /// Starts a background job that builds the BVH for picking
+  void buildTriangleBVH(TriangleBVH::Vertices vertices,
+                        TriangleBVH::Indices indices);
+
+  /// Takes the BVH of the current mesh, if it was finished
+  void updateTriangleBVH();
+
+  /// Selects the level of detail by the projected size of the bounding sphere
+  std::size_t selectLevelOfDetail(Matrix4 const &modelViewMatrix) const;
+
+  LevelOfDetail
+  createLevelOfDetail(SimplifiedMesh::Vertices const &meshVertices,
+                      SimplifiedMesh::Indices const &meshIndices) const;
+
   UpdateQueue updateQueue_;
+  LevelOfDetailQueue levelOfDetailQueue_;
+  TriangleBVHQueue triangleBVHQueue_;
+
+  /// All uploaded levels of detail, level 0 is the full resolution mesh
+  std::vector<LevelOfDetail> levels_;
+
+  bool cullBackFaces_{false};
+
+  /// Number of vertices of the full resolution mesh
+  Eigen::Index numVertices_{0};
 
-  GL::Buffer vertexBuffer_;
-  GL::Buffer indexBuffer_;
-  GL::VertexArray vertexArrayObject_;
-  std::size_t numTriangles_{0};
+  /// Scalars of the full resolution mesh, needed for levels of detail that are
+  /// uploaded later
+  Eigen::Matrix<float, Eigen::Dynamic, 1> scalars_;
+  Range<float> scalarRange_{0.f, 1.f};
+
+  /// Colormap lookup table, sampled with linear interpolation
+  GL::Textures<1> colormapTexture_{0};
+  GLsizei colormapSize_{0};
+
+  /// BVH of the current mesh, nullptr until it was built
+  std::shared_ptr<TriangleBVH const> triangleBVH_;
+
+  /// Triangle ranges of the visible meshlets and the resulting draws, reused
+  /// every frame
+  std::vector<Range<std::uint32_t>> drawRanges_;
+  std::vector<GLsizei> drawCounts_;
+  std::vector<void const *> drawOffsets_;
+  std::vector<GLint> drawBaseVertices_;
+
+  /// Bounding sphere in model coordinates
+  Position boundingSphereCenter_{Position::Zero()};
+  float boundingSphereRadius_{0.f};
+
+  /// Incremented on every mesh upload, used to discard outdated levels of
+  /// detail and to abort running jobs
+  std::atomic<std::uint32_t> generation_{0};
+
+  /// Queued and running background jobs, the destructor waits for them
+  std::vector<std::future<void>> jobs_;
 };
 
 } // namespace Private_
 } // namespace VolViz
-
@@ -0,0 +1,1149 @@
+#include "MeshIO.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <initializer_list>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace VolViz {
+
+namespace {
+
+using Corner = std::array<float, 3>;
+using Vertices = Eigen::Matrix<float, Eigen::Dynamic, 3>;
+using Indices = Eigen::Matrix<std::uint32_t, Eigen::Dynamic, 3>;
+
+/// Minimal number of bytes of an ASCII file parsed by a single task
+std::size_t constexpr kMinChunkSize = 1 << 20;
+
+/// Minimal number of elements of a binary file decoded by a single task
+std::size_t constexpr kMinElementsPerTask = 1 << 16;
+
+/// Number of shards of the hash table used to merge STL vertices
+int constexpr kShardBits = 6;
+std::size_t constexpr kShards = 1 << kShardBits;
+
+/// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+  explicit MappedFile(std::string const &filename);
+  ~MappedFile();
+
+  MappedFile(MappedFile const &) = delete;
+  MappedFile &operator=(MappedFile const &) = delete;
+
+  char const *begin() const noexcept { return data_; }
+  char const *end() const noexcept { return data_ + size_; }
+  std::size_t size() const noexcept { return size_; }
+
+private:
+  char const *data_{nullptr};
+  std::size_t size_{0};
+};
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(std::string const &filename) {
+  auto const file = CreateFileA(filename.c_str(), GENERIC_READ,
+                                FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    throw std::runtime_error("Could not open " + filename);
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize)) {
+    CloseHandle(file);
+    throw std::runtime_error("Could not get the size of " + filename);
+  }
+  size_ = static_cast<std::size_t>(fileSize.QuadPart);
+  if (size_ == 0) {
+    CloseHandle(file);
+    return;
+  }
+
+  // The view keeps the mapping and the file open, so both handles can be
+  // closed right away
+  auto const mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (mapping == nullptr) throw std::runtime_error("Could not map " + filename);
+  auto const data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (data == nullptr) throw std::runtime_error("Could not map " + filename);
+  data_ = static_cast<char const *>(data);
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) UnmapViewOfFile(data_);
+}
+
+#else
+
+MappedFile::MappedFile(std::string const &filename) {
+  auto const file = ::open(filename.c_str(), O_RDONLY);
+  if (file < 0) throw std::runtime_error("Could not open " + filename);
+
+  struct stat status;
+  if (::fstat(file, &status) != 0) {
+    ::close(file);
+    throw std::runtime_error("Could not get the size of " + filename);
+  }
+  size_ = static_cast<std::size_t>(status.st_size);
+  if (size_ == 0) {
+    ::close(file);
+    return;
+  }
+
+  // The mapping stays valid after the file is closed
+  auto const data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file, 0);
+  ::close(file);
+  if (data == MAP_FAILED) throw std::runtime_error("Could not map " + filename);
+  ::madvise(data, size_, MADV_WILLNEED);
+  data_ = static_cast<char const *>(data);
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) ::munmap(const_cast<char *>(data_), size_);
+}
+
+#endif
+
+/// Calls f(task) for each task in [0, nTasks) in parallel and rethrows the
+/// first exception of the tasks
+template <class F> void runTasks(std::size_t nTasks, F &&f) {
+  if (nTasks == 1) {
+    f(std::size_t{0});
+    return;
+  }
+  std::vector<std::future<void>> tasks;
+  tasks.reserve(nTasks);
+  for (std::size_t task = 0; task < nTasks; ++task)
+    tasks.push_back(std::async(std::launch::async, [&f, task]() { f(task); }));
+  for (auto &task : tasks) task.get();
+}
+
+/// Number of parallel tasks for n work items, with at least minPerTask items
+/// per task
+std::size_t taskCount(std::size_t n, std::size_t minPerTask) noexcept {
+  std::size_t const nThreads =
+      std::max(1u, std::thread::hardware_concurrency());
+  return std::max(std::size_t{1}, std::min(nThreads, n / minPerTask));
+}
+
+/// Calls f(first, last) for ranges covering [0, n) in parallel
+template <class F>
+void parallelFor(std::size_t n, std::size_t minPerTask, F &&f) {
+  auto const nTasks = taskCount(n, minPerTask);
+  runTasks(nTasks, [&](std::size_t task) {
+    f(n * task / nTasks, n * (task + 1) / nTasks);
+  });
+}
+
+/// Splits [begin, end) into chunks that start at the beginning of a line
+std::vector<std::pair<char const *, char const *>>
+splitLines(char const *begin, char const *end) {
+  auto const size = static_cast<std::size_t>(end - begin);
+  auto const nChunks = taskCount(size, kMinChunkSize);
+
+  std::vector<std::pair<char const *, char const *>> chunks;
+  auto chunkBegin = begin;
+  for (std::size_t i = 1; i <= nChunks && chunkBegin != end; ++i) {
+    auto chunkEnd = begin + size * i / nChunks;
+    if (chunkEnd < chunkBegin) chunkEnd = chunkBegin;
+    if (chunkEnd != end) {
+      auto const newline = static_cast<char const *>(std::memchr(
+          chunkEnd, '\n', static_cast<std::size_t>(end - chunkEnd)));
+      chunkEnd = newline != nullptr ? newline + 1 : end;
+    }
+    chunks.emplace_back(chunkBegin, chunkEnd);
+    chunkBegin = chunkEnd;
+  }
+  return chunks;
+}
+
+/// Counts the lines starting in [begin, end)
+std::size_t countLines(char const *begin, char const *end) noexcept {
+  std::size_t n = 0;
+  for (auto p = begin; p != end; ++n) {
+    auto const newline = static_cast<char const *>(
+        std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+    p = newline != nullptr ? newline + 1 : end;
+  }
+  return n;
+}
+
+/// Reads numbers and words from the lines of an ASCII file
+class Tokenizer {
+public:
+  Tokenizer(char const *begin, char const *end) noexcept
+      : pos_(begin), end_(end) {}
+
+  bool atEnd() const noexcept { return pos_ == end_; }
+
+  /// Returns true, if there are no more tokens on the current line
+  bool atLineEnd() noexcept {
+    skipSpaces();
+    return pos_ == end_ || *pos_ == '\n';
+  }
+
+  void nextLine() noexcept {
+    auto const newline = static_cast<char const *>(
+        std::memchr(pos_, '\n', static_cast<std::size_t>(end_ - pos_)));
+    pos_ = newline != nullptr ? newline + 1 : end_;
+  }
+
+  /// Consumes word, if it is the next token
+  bool consume(char const *word) noexcept {
+    skipSpaces();
+    auto const length = std::strlen(word);
+    if (static_cast<std::size_t>(end_ - pos_) < length ||
+        std::memcmp(pos_, word, length) != 0)
+      return false;
+    auto const next = pos_ + length;
+    if (next != end_ && !isSpace(*next)) return false;
+    pos_ = next;
+    return true;
+  }
+
+  /// Skips the characters up to the next space, e.g. the texture and normal
+  /// indices of an OBJ face vertex
+  void skipToSpace() noexcept {
+    while (pos_ != end_ && !isSpace(*pos_)) ++pos_;
+  }
+
+  bool parseInteger(std::int64_t &value) noexcept {
+    skipSpaces();
+    auto p = pos_;
+    bool const negative = p != end_ && *p == '-';
+    if (p != end_ && (*p == '-' || *p == '+')) ++p;
+    if (p == end_ || !isDigit(*p)) return false;
+    std::int64_t v = 0;
+    for (; p != end_ && isDigit(*p); ++p) v = 10 * v + (*p - '0');
+    value = negative ? -v : v;
+    pos_ = p;
+    return true;
+  }
+
+  bool parseFloat(float &value) noexcept {
+    skipSpaces();
+    auto p = pos_;
+    bool const negative = p != end_ && *p == '-';
+    if (p != end_ && (*p == '-' || *p == '+')) ++p;
+
+    double mantissa = 0.;
+    int exponent = 0;
+    bool hasDigits = false;
+    for (; p != end_ && isDigit(*p); ++p, hasDigits = true)
+      mantissa = 10. * mantissa + (*p - '0');
+    if (p != end_ && *p == '.') {
+      for (++p; p != end_ && isDigit(*p); ++p, hasDigits = true, --exponent)
+        mantissa = 10. * mantissa + (*p - '0');
+    }
+    if (!hasDigits) return false;
+
+    if (p != end_ && (*p == 'e' || *p == 'E')) {
+      Tokenizer exponentTokenizer(p + 1, end_);
+      std::int64_t e;
+      if (!exponentTokenizer.parseInteger(e)) return false;
+      exponent += static_cast<int>(std::max<std::int64_t>(
+          std::min<std::int64_t>(e, 1000), -1000));
+      p = exponentTokenizer.pos_;
+    }
+
+    auto const v =
+        static_cast<float>(exponent == 0 ? mantissa
+                                         : mantissa * std::pow(10., exponent));
+    value = negative ? -v : v;
+    pos_ = p;
+    return true;
+  }
+
+private:
+  static bool isDigit(char c) noexcept { return c >= '0' && c <= '9'; }
+
+  static bool isSpace(char c) noexcept {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+  }
+
+  void skipSpaces() noexcept {
+    while (pos_ != end_ && (*pos_ == ' ' || *pos_ == '\t' || *pos_ == '\r'))
+      ++pos_;
+  }
+
+  char const *pos_;
+  char const *end_;
+};
+
+/// Reads a value of type T stored with the given byte order
+template <class T> T load(char const *p, bool swapBytes) noexcept {
+  std::array<char, sizeof(T)> bytes;
+  std::memcpy(bytes.data(), p, sizeof(T));
+  if (swapBytes) std::reverse(bytes.begin(), bytes.end());
+  T value;
+  std::memcpy(&value, bytes.data(), sizeof(T));
+  return value;
+}
+
+bool isBigEndianHost() noexcept {
+  std::uint16_t const one = 1;
+  char firstByte;
+  std::memcpy(&firstByte, &one, 1);
+  return firstByte == 0;
+}
+
+/// Number of triangles of a polygon with n vertices, triangulated as a fan
+inline std::size_t fanTriangles(std::size_t n) noexcept {
+  return n >= 3 ? n - 2 : 0;
+}
+
+/// Triangulates a polygon as a fan and writes the triangles to the rows
+/// starting at row, returns the row behind them
+Eigen::Index writePolygon(std::vector<std::uint32_t> const &polygon,
+                          Indices &indices, Eigen::Index row) noexcept {
+  for (std::size_t i = 2; i < polygon.size(); ++i, ++row)
+    indices.row(row) << polygon[0], polygon[i - 1], polygon[i];
+  return row;
+}
+
+/// Creates a descriptor with room for the given numbers of vertices and
+/// triangles, which are then decoded directly into its matrices
+MeshDescriptor allocateMesh(std::size_t nVertices, std::size_t nTriangles) {
+  MeshDescriptor mesh;
+  mesh.vertices.resize(static_cast<Eigen::Index>(nVertices), 3);
+  mesh.indices.resize(static_cast<Eigen::Index>(nTriangles), 3);
+  return mesh;
+}
+
+/// Checks that all indices refer to a vertex of the mesh
+void checkIndices(MeshDescriptor const &mesh) {
+  auto const nVertices = static_cast<std::uint64_t>(mesh.vertices.rows());
+  if (nVertices > std::numeric_limits<std::uint32_t>::max()) return;
+
+  auto const limit = static_cast<std::uint32_t>(nVertices);
+  std::atomic<bool> valid{true};
+  parallelFor(static_cast<std::size_t>(mesh.indices.rows()),
+              kMinElementsPerTask, [&](std::size_t first, std::size_t last) {
+                auto const rows = mesh.indices.middleRows(
+                    static_cast<Eigen::Index>(first),
+                    static_cast<Eigen::Index>(last - first));
+                if ((rows.array() >= limit).any()) valid = false;
+              });
+  if (!valid) throw std::runtime_error("Mesh has invalid vertex indices");
+}
+
+/// Converts a 1-based or negative (relative) OBJ index to a 0-based index
+bool objIndex(std::int64_t index, std::size_t nVertices,
+              std::uint32_t &result) noexcept {
+  auto const n = static_cast<std::int64_t>(nVertices);
+  auto const i = index < 0 ? n + index : index - 1;
+  if (i < 0 || i > std::numeric_limits<std::uint32_t>::max()) return false;
+  result = static_cast<std::uint32_t>(i);
+  return true;
+}
+
+MeshDescriptor loadOBJ(MappedFile const &file) {
+  auto const chunks = splitLines(file.begin(), file.end());
+
+  // Count the vertices and triangles of each chunk first, so that the chunks
+  // know the rows of their first vertex and triangle. Relative indices can
+  // then be resolved while parsing, and all chunks decode directly into the
+  // matrices of the descriptor.
+  std::vector<std::size_t> firstVertex(chunks.size() + 1, 0);
+  std::vector<std::size_t> firstTriangle(chunks.size() + 1, 0);
+  runTasks(chunks.size(), [&](std::size_t c) {
+    Tokenizer tokenizer(chunks[c].first, chunks[c].second);
+    for (; !tokenizer.atEnd(); tokenizer.nextLine()) {
+      if (tokenizer.consume("v")) {
+        ++firstVertex[c + 1];
+      } else if (tokenizer.consume("f")) {
+        std::size_t n = 0;
+        for (; !tokenizer.atLineEnd(); ++n) tokenizer.skipToSpace();
+        firstTriangle[c + 1] += fanTriangles(n);
+      }
+    }
+  });
+  std::partial_sum(firstVertex.begin(), firstVertex.end(),
+                   firstVertex.begin());
+  std::partial_sum(firstTriangle.begin(), firstTriangle.end(),
+                   firstTriangle.begin());
+
+  auto mesh = allocateMesh(firstVertex.back(), firstTriangle.back());
+  std::vector<std::size_t> errorLines(chunks.size(), 0);
+  runTasks(chunks.size(), [&](std::size_t c) {
+    auto nVertices = firstVertex[c];
+    auto row = static_cast<Eigen::Index>(firstTriangle[c]);
+    std::vector<std::uint32_t> polygon;
+    Tokenizer tokenizer(chunks[c].first, chunks[c].second);
+    for (std::size_t line = 1; !tokenizer.atEnd();
+         tokenizer.nextLine(), ++line) {
+      if (tokenizer.consume("v")) {
+        float x, y, z;
+        if (!tokenizer.parseFloat(x) || !tokenizer.parseFloat(y) ||
+            !tokenizer.parseFloat(z)) {
+          errorLines[c] = line;
+          return;
+        }
+        mesh.vertices.row(static_cast<Eigen::Index>(nVertices++)) << x, y, z;
+      } else if (tokenizer.consume("f")) {
+        polygon.clear();
+        while (!tokenizer.atLineEnd()) {
+          std::int64_t index;
+          std::uint32_t vertex;
+          if (!tokenizer.parseInteger(index) ||
+              !objIndex(index, nVertices, vertex)) {
+            errorLines[c] = line;
+            return;
+          }
+          tokenizer.skipToSpace();
+          polygon.push_back(vertex);
+        }
+        row = writePolygon(polygon, mesh.indices, row);
+      }
+    }
+  });
+
+  for (std::size_t c = 0; c < chunks.size(); ++c) {
+    if (errorLines[c] == 0) continue;
+    auto const line = std::accumulate(
+        chunks.begin(), chunks.begin() + static_cast<std::ptrdiff_t>(c),
+        errorLines[c], [](std::size_t n, auto const &chunk) {
+          return n + countLines(chunk.first, chunk.second);
+        });
+    throw std::runtime_error("Malformed OBJ file in line " +
+                             std::to_string(line));
+  }
+
+  checkIndices(mesh);
+  return mesh;
+}
+
+enum class PlyType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float, Double };
+
+std::size_t sizeOf(PlyType type) noexcept {
+  switch (type) {
+  case PlyType::Int8:
+  case PlyType::UInt8:
+    return 1;
+  case PlyType::Int16:
+  case PlyType::UInt16:
+    return 2;
+  case PlyType::Int32:
+  case PlyType::UInt32:
+  case PlyType::Float:
+    return 4;
+  case PlyType::Double:
+    return 8;
+  }
+  return 0;
+}
+
+PlyType parsePlyType(std::string const &name) {
+  if (name == "char" || name == "int8") return PlyType::Int8;
+  if (name == "uchar" || name == "uint8") return PlyType::UInt8;
+  if (name == "short" || name == "int16") return PlyType::Int16;
+  if (name == "ushort" || name == "uint16") return PlyType::UInt16;
+  if (name == "int" || name == "int32") return PlyType::Int32;
+  if (name == "uint" || name == "uint32") return PlyType::UInt32;
+  if (name == "float" || name == "float32") return PlyType::Float;
+  if (name == "double" || name == "float64") return PlyType::Double;
+  throw std::runtime_error("Unknown PLY property type " + name);
+}
+
+/// Reads a binary PLY value and converts it to double
+double loadPly(char const *p, PlyType type, bool swapBytes) noexcept {
+  switch (type) {
+  case PlyType::Int8:
+    return load<std::int8_t>(p, swapBytes);
+  case PlyType::UInt8:
+    return load<std::uint8_t>(p, swapBytes);
+  case PlyType::Int16:
+    return load<std::int16_t>(p, swapBytes);
+  case PlyType::UInt16:
+    return load<std::uint16_t>(p, swapBytes);
+  case PlyType::Int32:
+    return load<std::int32_t>(p, swapBytes);
+  case PlyType::UInt32:
+    return load<std::uint32_t>(p, swapBytes);
+  case PlyType::Float:
+    return static_cast<double>(load<float>(p, swapBytes));
+  case PlyType::Double:
+    return load<double>(p, swapBytes);
+  }
+  return 0.;
+}
+
+struct PlyProperty {
+  std::string name;
+  PlyType type;
+  bool isList{false};
+  /// Type of the element count of a list
+  PlyType countType{PlyType::UInt8};
+};
+
+struct PlyElement {
+  std::string name;
+  std::size_t count{0};
+  std::vector<PlyProperty> properties;
+
+  bool hasLists() const noexcept {
+    return std::any_of(properties.begin(), properties.end(),
+                       [](auto const &p) { return p.isList; });
+  }
+
+  /// Index of the property with one of the given names
+  std::size_t find(std::initializer_list<char const *> names) const {
+    for (std::size_t i = 0; i < properties.size(); ++i) {
+      for (auto candidate : names)
+        if (properties[i].name == candidate) return i;
+    }
+    throw std::runtime_error("PLY element " + name +
+                             " has no property " + *names.begin());
+  }
+};
+
+enum class PlyFormat { Ascii, BinaryLittleEndian, BinaryBigEndian };
+
+struct PlyHeader {
+  PlyFormat format{PlyFormat::Ascii};
+  std::vector<PlyElement> elements;
+  /// Beginning of the data after the header
+  char const *body{nullptr};
+};
+
+PlyHeader parsePlyHeader(MappedFile const &file) {
+  PlyHeader header;
+  bool hasFormat = false;
+  for (auto p = file.begin(); p != file.end();) {
+    auto const newline = static_cast<char const *>(std::memchr(
+        p, '\n', static_cast<std::size_t>(file.end() - p)));
+    if (newline == nullptr) break;
+    std::istringstream line(std::string(p, newline));
+    p = newline + 1;
+
+    std::string keyword;
+    line >> keyword;
+    if (keyword == "format") {
+      std::string format;
+      line >> format;
+      if (format == "ascii")
+        header.format = PlyFormat::Ascii;
+      else if (format == "binary_little_endian")
+        header.format = PlyFormat::BinaryLittleEndian;
+      else if (format == "binary_big_endian")
+        header.format = PlyFormat::BinaryBigEndian;
+      else
+        throw std::runtime_error("Unknown PLY format " + format);
+      hasFormat = true;
+    } else if (keyword == "element") {
+      PlyElement element;
+      line >> element.name >> element.count;
+      header.elements.push_back(element);
+    } else if (keyword == "property") {
+      if (header.elements.empty())
+        throw std::runtime_error("PLY property without element");
+      PlyProperty property;
+      std::string type;
+      line >> type;
+      if (type == "list") {
+        std::string countType;
+        line >> countType >> type;
+        property.isList = true;
+        property.countType = parsePlyType(countType);
+      }
+      property.type = parsePlyType(type);
+      line >> property.name;
+      header.elements.back().properties.push_back(property);
+    } else if (keyword == "end_header") {
+      if (!hasFormat) throw std::runtime_error("PLY header has no format");
+      header.body = p;
+      return header;
+    }
+    if (line.fail()) throw std::runtime_error("Malformed PLY header");
+  }
+  throw std::runtime_error("PLY header is not terminated");
+}
+
+void decodeBinaryPlyVertices(PlyElement const &element, char const *data,
+                             bool swapBytes, Vertices &vertices) {
+  if (element.hasLists())
+    throw std::runtime_error("PLY vertices with list properties are not "
+                             "supported");
+
+  std::array<std::size_t, 3> offsets;
+  std::array<PlyType, 3> types;
+  std::size_t stride = 0;
+  std::array<std::size_t, 3> const xyz{{element.find({"x"}),
+                                         element.find({"y"}),
+                                         element.find({"z"})}};
+  for (std::size_t i = 0; i < element.properties.size(); ++i) {
+    for (std::size_t c = 0; c < 3; ++c) {
+      if (xyz[c] != i) continue;
+      offsets[c] = stride;
+      types[c] = element.properties[i].type;
+    }
+    stride += sizeOf(element.properties[i].type);
+  }
+
+  vertices.resize(static_cast<Eigen::Index>(element.count), 3);
+  parallelFor(element.count, kMinElementsPerTask,
+              [&](std::size_t first, std::size_t last) {
+                for (auto i = first; i < last; ++i) {
+                  auto const row = data + i * stride;
+                  for (std::size_t c = 0; c < 3; ++c)
+                    vertices(static_cast<Eigen::Index>(i),
+                             static_cast<Eigen::Index>(c)) =
+                        static_cast<float>(
+                            loadPly(row + offsets[c], types[c], swapBytes));
+                }
+              });
+}
+
+/// Walks the faces of a binary PLY file one after the other and calls
+/// f(n, list) with the size and the first index of each vertex index list,
+/// returns a pointer behind the faces
+template <class F>
+char const *forEachBinaryPlyFace(PlyElement const &element,
+                                 PlyProperty const &indices, char const *data,
+                                 char const *end, bool swapBytes, F &&f) {
+  auto p = data;
+  auto const checkSize = [&p, end](std::size_t size) {
+    if (static_cast<std::size_t>(end - p) < size)
+      throw std::runtime_error("PLY file is truncated");
+  };
+  for (std::size_t i = 0; i < element.count; ++i) {
+    for (auto const &property : element.properties) {
+      if (!property.isList) {
+        checkSize(sizeOf(property.type));
+        p += sizeOf(property.type);
+        continue;
+      }
+      checkSize(sizeOf(property.countType));
+      auto const n = static_cast<std::size_t>(
+          loadPly(p, property.countType, swapBytes));
+      p += sizeOf(property.countType);
+      checkSize(n * sizeOf(property.type));
+      if (&property == &indices) f(n, p);
+      p += n * sizeOf(property.type);
+    }
+  }
+  return p;
+}
+
+/// Decodes the faces of a binary PLY file and appends their triangles,
+/// returns a pointer behind them
+char const *decodeBinaryPlyFaces(PlyElement const &element, char const *data,
+                                 char const *end, bool swapBytes,
+                                 Indices &triangles) {
+  auto const indexProperty = element.find({"vertex_indices", "vertex_index"});
+  auto const &indices = element.properties[indexProperty];
+  auto const indexSize = sizeOf(indices.type);
+  auto const countSize = sizeOf(indices.countType);
+
+  // Fast path: if the faces are all triangles and the index list is the only
+  // list, all faces have the same size and are decoded in parallel.
+  bool const fixedSize =
+      std::none_of(element.properties.begin(), element.properties.end(),
+                   [&](auto const &p) { return p.isList && &p != &indices; });
+  if (fixedSize) {
+    std::size_t listOffset = 0, stride = 0;
+    for (auto const &p : element.properties) {
+      if (&p == &indices) {
+        listOffset = stride;
+        stride += countSize + 3 * indexSize;
+      } else {
+        stride += sizeOf(p.type);
+      }
+    }
+
+    if (element.count * stride <= static_cast<std::size_t>(end - data)) {
+      std::atomic<bool> allTriangles{true};
+      auto const firstRow = triangles.rows();
+      triangles.conservativeResize(
+          firstRow + static_cast<Eigen::Index>(element.count), 3);
+      parallelFor(element.count, kMinElementsPerTask,
+                  [&](std::size_t first, std::size_t last) {
+                    for (auto i = first; i < last && allTriangles; ++i) {
+                      auto const list = data + i * stride + listOffset;
+                      if (loadPly(list, indices.countType, swapBytes) != 3.) {
+                        allTriangles = false;
+                        return;
+                      }
+                      auto const row =
+                          firstRow + static_cast<Eigen::Index>(i);
+                      for (std::size_t c = 0; c < 3; ++c)
+                        triangles(row, static_cast<Eigen::Index>(c)) =
+                            static_cast<std::uint32_t>(
+                                loadPly(list + countSize + c * indexSize,
+                                        indices.type, swapBytes));
+                    }
+                  });
+      if (allTriangles) return data + element.count * stride;
+      triangles.conservativeResize(firstRow, 3);
+    }
+  }
+
+  // General case: count the triangles in a first walk over the faces, then
+  // decode them in a second one
+  std::size_t nTriangles = 0;
+  forEachBinaryPlyFace(element, indices, data, end, swapBytes,
+                       [&](std::size_t n, char const *) {
+                         nTriangles += fanTriangles(n);
+                       });
+
+  auto row = triangles.rows();
+  triangles.conservativeResize(row + static_cast<Eigen::Index>(nTriangles),
+                               3);
+  std::vector<std::uint32_t> polygon;
+  return forEachBinaryPlyFace(
+      element, indices, data, end, swapBytes,
+      [&](std::size_t n, char const *list) {
+        polygon.resize(n);
+        for (std::size_t j = 0; j < n; ++j)
+          polygon[j] = static_cast<std::uint32_t>(
+              loadPly(list + j * indexSize, indices.type, swapBytes));
+        row = writePolygon(polygon, triangles, row);
+      });
+}
+
+/// Skips an element of a binary PLY file, returns a pointer behind it
+char const *skipBinaryPlyElement(PlyElement const &element, char const *data,
+                                 char const *end, bool swapBytes) {
+  if (!element.hasLists()) {
+    std::size_t stride = 0;
+    for (auto const &p : element.properties) stride += sizeOf(p.type);
+    return data + element.count * stride;
+  }
+  auto p = data;
+  for (std::size_t i = 0; i < element.count; ++i) {
+    for (auto const &property : element.properties) {
+      auto n = std::size_t{1};
+      if (property.isList) {
+        if (static_cast<std::size_t>(end - p) < sizeOf(property.countType))
+          throw std::runtime_error("PLY file is truncated");
+        n = static_cast<std::size_t>(loadPly(p, property.countType, swapBytes));
+        p += sizeOf(property.countType);
+      }
+      if (static_cast<std::size_t>(end - p) < n * sizeOf(property.type))
+        throw std::runtime_error("PLY file is truncated");
+      p += n * sizeOf(property.type);
+    }
+  }
+  return p;
+}
+
+MeshDescriptor loadBinaryPLY(MappedFile const &file, PlyHeader const &header) {
+  bool const swapBytes = (header.format == PlyFormat::BinaryBigEndian) !=
+                         isBigEndianHost();
+
+  MeshDescriptor mesh;
+  auto p = header.body;
+  for (auto const &element : header.elements) {
+    if (element.name == "vertex") {
+      std::size_t stride = 0;
+      for (auto const &property : element.properties)
+        stride += sizeOf(property.type);
+      if (element.count * stride > static_cast<std::size_t>(file.end() - p))
+        throw std::runtime_error("PLY file is truncated");
+      decodeBinaryPlyVertices(element, p, swapBytes, mesh.vertices);
+      p += element.count * stride;
+    } else if (element.name == "face") {
+      p = decodeBinaryPlyFaces(element, p, file.end(), swapBytes,
+                               mesh.indices);
+    } else {
+      p = skipBinaryPlyElement(element, p, file.end(), swapBytes);
+    }
+    if (p > file.end()) throw std::runtime_error("PLY file is truncated");
+  }
+  checkIndices(mesh);
+  return mesh;
+}
+
+/// Parses the properties of a face in an ASCII PLY file and stores the size
+/// of its vertex index list. If polygon is not null, the indices are stored
+/// as well, otherwise parsing stops at the size of the list.
+/// @return false, if the line is malformed
+bool parseAsciiPlyFace(Tokenizer &tokenizer, PlyElement const &element,
+                       std::size_t &size,
+                       std::vector<std::uint32_t> *polygon) {
+  size = 0;
+  for (auto const &property : element.properties) {
+    std::int64_t n = 1;
+    if (property.isList && (!tokenizer.parseInteger(n) || n < 0))
+      return false;
+    bool const isIndexList =
+        property.isList && (property.name == "vertex_indices" ||
+                            property.name == "vertex_index");
+    if (isIndexList) {
+      size = static_cast<std::size_t>(n);
+      if (polygon == nullptr) return true;
+      polygon->clear();
+    }
+    for (std::int64_t j = 0; j < n; ++j) {
+      std::int64_t index;
+      float value;
+      auto constexpr kMaxIndex = std::numeric_limits<std::uint32_t>::max();
+      bool const valid = isIndexList ? tokenizer.parseInteger(index) &&
+                                           index >= 0 && index <= kMaxIndex
+                                     : tokenizer.parseFloat(value);
+      if (!valid) return false;
+      if (isIndexList) polygon->push_back(static_cast<std::uint32_t>(index));
+    }
+  }
+  return true;
+}
+
+MeshDescriptor loadAsciiPLY(MappedFile const &file, PlyHeader const &header) {
+  // Each element occupies a range of lines. The chunks know the number of
+  // their first line, so each line can be assigned to its element.
+  auto const chunks = splitLines(header.body, file.end());
+  std::vector<std::size_t> firstLine(chunks.size() + 1, 0);
+  runTasks(chunks.size(), [&](std::size_t c) {
+    firstLine[c + 1] = countLines(chunks[c].first, chunks[c].second);
+  });
+  std::partial_sum(firstLine.begin(), firstLine.end(), firstLine.begin());
+
+  std::vector<std::size_t> elementLines{0};
+  for (auto const &element : header.elements)
+    elementLines.push_back(elementLines.back() + element.count);
+  if (firstLine.back() < elementLines.back())
+    throw std::runtime_error("PLY file is truncated");
+
+  auto const vertexElement = static_cast<std::size_t>(
+      std::find_if(header.elements.begin(), header.elements.end(),
+                   [](auto const &e) { return e.name == "vertex"; }) -
+      header.elements.begin());
+  std::array<std::size_t, 3> xyz{{0, 1, 2}};
+  if (vertexElement < header.elements.size()) {
+    auto const &element = header.elements[vertexElement];
+    if (element.hasLists())
+      throw std::runtime_error("PLY vertices with list properties are not "
+                               "supported");
+    xyz = {{element.find({"x"}), element.find({"y"}), element.find({"z"})}};
+  }
+
+  // Calls f(tokenizer, element, line) for the data lines of chunk c until f
+  // returns false
+  auto const forEachLine = [&](std::size_t c, auto &&f) {
+    std::size_t e = 0;
+    Tokenizer tokenizer(chunks[c].first, chunks[c].second);
+    for (auto line = firstLine[c];
+         !tokenizer.atEnd() && line < elementLines.back();
+         tokenizer.nextLine(), ++line) {
+      while (line >= elementLines[e + 1]) ++e;
+      if (!f(tokenizer, e, line)) return;
+    }
+  };
+  std::vector<std::size_t> errorLines(chunks.size(), 0);
+  auto const checkErrors = [&errorLines]() {
+    for (auto line : errorLines) {
+      if (line != 0)
+        throw std::runtime_error("Malformed PLY file in data line " +
+                                 std::to_string(line));
+    }
+  };
+
+  // Count the triangles of each chunk first, so that the chunks know the row
+  // of their first triangle and decode directly into the descriptor
+  std::vector<std::size_t> firstTriangle(chunks.size() + 1, 0);
+  runTasks(chunks.size(), [&](std::size_t c) {
+    forEachLine(c, [&](Tokenizer &tokenizer, std::size_t e, std::size_t line) {
+      if (header.elements[e].name != "face") return true;
+      std::size_t n;
+      if (!parseAsciiPlyFace(tokenizer, header.elements[e], n, nullptr)) {
+        errorLines[c] = line + 1;
+        return false;
+      }
+      firstTriangle[c + 1] += fanTriangles(n);
+      return true;
+    });
+  });
+  checkErrors();
+  std::partial_sum(firstTriangle.begin(), firstTriangle.end(),
+                   firstTriangle.begin());
+
+  auto mesh = allocateMesh(vertexElement < header.elements.size()
+                               ? header.elements[vertexElement].count
+                               : 0,
+                           firstTriangle.back());
+  runTasks(chunks.size(), [&](std::size_t c) {
+    std::vector<std::uint32_t> polygon;
+    auto row = static_cast<Eigen::Index>(firstTriangle[c]);
+    forEachLine(c, [&](Tokenizer &tokenizer, std::size_t e, std::size_t line) {
+      auto const &element = header.elements[e];
+      if (e == vertexElement) {
+        auto const v = static_cast<Eigen::Index>(line - elementLines[e]);
+        for (std::size_t i = 0; i < element.properties.size(); ++i) {
+          float value;
+          if (!tokenizer.parseFloat(value)) {
+            errorLines[c] = line + 1;
+            return false;
+          }
+          for (std::size_t k = 0; k < 3; ++k) {
+            if (xyz[k] == i)
+              mesh.vertices(v, static_cast<Eigen::Index>(k)) = value;
+          }
+        }
+      } else if (element.name == "face") {
+        std::size_t n;
+        if (!parseAsciiPlyFace(tokenizer, element, n, &polygon)) {
+          errorLines[c] = line + 1;
+          return false;
+        }
+        row = writePolygon(polygon, mesh.indices, row);
+      }
+      return true;
+    });
+  });
+  checkErrors();
+
+  checkIndices(mesh);
+  return mesh;
+}
+
+MeshDescriptor loadPLY(MappedFile const &file) {
+  if (file.size() < 3 || std::memcmp(file.begin(), "ply", 3) != 0)
+    throw std::runtime_error("Not a PLY file");
+
+  auto const header = parsePlyHeader(file);
+  if (header.format == PlyFormat::Ascii) return loadAsciiPLY(file, header);
+  return loadBinaryPLY(file, header);
+}
+
+/// Bitwise representation of a vertex position, used to merge equal STL
+/// vertices
+struct VertexKey {
+  std::array<std::uint32_t, 3> bits;
+
+  explicit VertexKey(Corner const &corner) noexcept {
+    for (std::size_t c = 0; c < 3; ++c) {
+      // adding zero maps -0 to +0
+      auto const value = corner[c] + 0.f;
+      std::memcpy(&bits[c], &value, sizeof(float));
+    }
+  }
+
+  bool operator==(VertexKey const &rhs) const noexcept {
+    return bits == rhs.bits;
+  }
+
+  std::size_t hash() const noexcept {
+    std::uint64_t h = bits[0] * 0x9e3779b97f4a7c15ull;
+    h ^= bits[1] * 0xc2b2ae3d27d4eb4full + (h >> 29);
+    h ^= bits[2] * 0x165667b19e3779f9ull + (h >> 32);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return static_cast<std::size_t>(h);
+  }
+};
+
+/// Merges equal corners of the triangles to shared vertices. The corners are
+/// distributed to shards by their hash, each shard is deduplicated by its own
+/// task with its own hash table. The vertices are numbered in the order of
+/// their first use.
+/// Merges the corners with equal positions into vertices, cornerAt(i)
+/// returns the position of the i-th corner
+template <class CornerAt>
+MeshDescriptor mergeCorners(std::size_t nCorners, CornerAt const &cornerAt) {
+  if (nCorners > std::numeric_limits<std::uint32_t>::max())
+    throw std::runtime_error("STL file has too many triangles");
+
+  // Sort the corners into shards, per task to avoid synchronization
+  auto const nTasks = taskCount(nCorners, kMinElementsPerTask);
+  std::vector<std::array<std::vector<std::uint32_t>, kShards>> bins(nTasks);
+  std::vector<std::uint8_t> cornerShard(nCorners);
+  runTasks(nTasks, [&](std::size_t task) {
+    for (auto i = nCorners * task / nTasks;
+         i < nCorners * (task + 1) / nTasks; ++i) {
+      // the upper bits select the shard, the lower bits the hash table bucket
+      auto const shard = static_cast<std::uint8_t>(
+          VertexKey(cornerAt(i)).hash() >>
+          (std::numeric_limits<std::size_t>::digits - kShardBits));
+      cornerShard[i] = shard;
+      bins[task][shard].push_back(static_cast<std::uint32_t>(i));
+    }
+  });
+
+  // Deduplicate each shard, corners are visited in ascending order
+  std::vector<std::uint32_t> cornerVertex(nCorners);
+  std::array<std::vector<std::uint32_t>, kShards> shardVertices;
+  runTasks(taskCount(kShards, 1), [&](std::size_t task) {
+    auto const nShardTasks = taskCount(kShards, 1);
+    for (auto shard = kShards * task / nShardTasks;
+         shard < kShards * (task + 1) / nShardTasks; ++shard) {
+      std::size_t shardSize = 0;
+      for (auto const &bin : bins) shardSize += bin[shard].size();
+      std::size_t capacity = 16;
+      while (capacity < 2 * shardSize) capacity *= 2;
+
+      // Open addressing with linear probing, the slots hold the index of the
+      // vertex within the shard
+      auto constexpr kEmpty = std::numeric_limits<std::uint32_t>::max();
+      std::vector<std::uint32_t> slots(capacity, kEmpty);
+      auto &vertices = shardVertices[shard];
+      vertices.reserve(shardSize / 4);
+      for (auto const &bin : bins) {
+        for (auto corner : bin[shard]) {
+          VertexKey const key(cornerAt(corner));
+          auto slot = key.hash() & (capacity - 1);
+          while (slots[slot] != kEmpty &&
+                 !(VertexKey(cornerAt(vertices[slots[slot]])) == key))
+            slot = (slot + 1) & (capacity - 1);
+          if (slots[slot] == kEmpty) {
+            slots[slot] = static_cast<std::uint32_t>(vertices.size());
+            vertices.push_back(corner);
+          }
+          cornerVertex[corner] = slots[slot];
+        }
+      }
+    }
+  });
+  bins.clear();
+
+  std::array<std::uint32_t, kShards + 1> shardOffsets;
+  shardOffsets[0] = 0;
+  for (std::size_t shard = 0; shard < kShards; ++shard)
+    shardOffsets[shard + 1] = shardOffsets[shard] +
+        static_cast<std::uint32_t>(shardVertices[shard].size());
+  auto const nVertices = shardOffsets.back();
+
+  // Number the vertices in the order of their first use
+  auto constexpr kUnused = std::numeric_limits<std::uint32_t>::max();
+  std::vector<std::uint32_t> order(nVertices, kUnused);
+  std::uint32_t nextVertex = 0;
+  MeshDescriptor mesh;
+  mesh.indices.resize(static_cast<Eigen::Index>(nCorners / 3), 3);
+  for (std::size_t i = 0; i < nCorners; ++i) {
+    auto &vertex = order[shardOffsets[cornerShard[i]] + cornerVertex[i]];
+    if (vertex == kUnused) vertex = nextVertex++;
+    mesh.indices(static_cast<Eigen::Index>(i / 3),
+                 static_cast<Eigen::Index>(i % 3)) = vertex;
+  }
+
+  mesh.vertices.resize(static_cast<Eigen::Index>(nVertices), 3);
+  runTasks(taskCount(kShards, 1), [&](std::size_t task) {
+    auto const nShardTasks = taskCount(kShards, 1);
+    for (auto shard = kShards * task / nShardTasks;
+         shard < kShards * (task + 1) / nShardTasks; ++shard) {
+      for (std::size_t i = 0; i < shardVertices[shard].size(); ++i) {
+        auto const row =
+            static_cast<Eigen::Index>(order[shardOffsets[shard] + i]);
+        auto const corner = cornerAt(shardVertices[shard][i]);
+        mesh.vertices.row(row) << corner[0], corner[1], corner[2];
+      }
+    }
+  });
+  return mesh;
+}
+
+MeshDescriptor loadSTL(MappedFile const &file) {
+  // Binary files start with an 80 byte header and the triangle count, each
+  // triangle takes 50 bytes. ASCII files start with "solid", but so do some
+  // binary files, so the size is checked first.
+  std::size_t constexpr kHeaderSize = 84;
+  std::size_t constexpr kTriangleSize = 50;
+  std::size_t nTriangles = 0;
+  if (file.size() >= kHeaderSize)
+    nTriangles = load<std::uint32_t>(file.begin() + 80, isBigEndianHost());
+  bool const isAscii =
+      file.size() >= 5 && std::memcmp(file.begin(), "solid", 5) == 0 &&
+      file.size() != kHeaderSize + nTriangles * kTriangleSize;
+
+  if (!isAscii) {
+    if (file.size() < kHeaderSize ||
+        file.size() < kHeaderSize + nTriangles * kTriangleSize)
+      throw std::runtime_error("STL file is truncated");
+
+    // The corners are read straight from the mapped file
+    auto const swapBytes = isBigEndianHost();
+    return mergeCorners(3 * nTriangles, [&](std::size_t i) {
+      // skip the normal
+      auto const p = file.begin() + kHeaderSize + i / 3 * kTriangleSize + 12 +
+                     i % 3 * 12;
+      return Corner{{load<float>(p, swapBytes), load<float>(p + 4, swapBytes),
+                     load<float>(p + 8, swapBytes)}};
+    });
+  }
+
+  // Only the vertex lines matter. Count them per chunk first, so that each
+  // chunk knows the index of its first corner and all chunks decode into one
+  // array.
+  auto const chunks = splitLines(file.begin(), file.end());
+  std::vector<std::size_t> firstCorner(chunks.size() + 1, 0);
+  runTasks(chunks.size(), [&](std::size_t c) {
+    Tokenizer tokenizer(chunks[c].first, chunks[c].second);
+    for (; !tokenizer.atEnd(); tokenizer.nextLine())
+      if (tokenizer.consume("vertex")) ++firstCorner[c + 1];
+  });
+  std::partial_sum(firstCorner.begin(), firstCorner.end(),
+                   firstCorner.begin());
+  if (firstCorner.back() % 3 != 0)
+    throw std::runtime_error("Malformed STL file");
+
+  std::vector<Corner> corners(firstCorner.back());
+  std::atomic<bool> malformed{false};
+  runTasks(chunks.size(), [&](std::size_t c) {
+    auto next = firstCorner[c];
+    Tokenizer tokenizer(chunks[c].first, chunks[c].second);
+    for (; !tokenizer.atEnd(); tokenizer.nextLine()) {
+      if (!tokenizer.consume("vertex")) continue;
+      auto &corner = corners[next++];
+      if (!tokenizer.parseFloat(corner[0]) ||
+          !tokenizer.parseFloat(corner[1]) ||
+          !tokenizer.parseFloat(corner[2])) {
+        malformed = true;
+        return;
+      }
+    }
+  });
+  if (malformed) throw std::runtime_error("Malformed STL file");
+
+  return mergeCorners(corners.size(),
+                      [&corners](std::size_t i) { return corners[i]; });
+}
+
+} // namespace
+
+MeshDescriptor loadMesh(std::string const &filename) {
+  auto const dot = filename.find_last_of('.');
+  auto extension =
+      dot == std::string::npos ? std::string() : filename.substr(dot + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](char c) {
+                   return c >= 'A' && c <= 'Z'
+                              ? static_cast<char>(c - 'A' + 'a')
+                              : c;
+                 });
+
+  MappedFile const file(filename);
+  if (extension == "ply") return loadPLY(file);
+  if (extension == "stl") return loadSTL(file);
+  if (extension == "obj") return loadOBJ(file);
+  throw std::runtime_error("Unsupported mesh format: " + filename);
+}
+
+} // namespace VolViz
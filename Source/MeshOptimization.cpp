@@ -0,0 +1,371 @@
+#include "MeshOptimization.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace VolViz {
+namespace Private_ {
+
+namespace {
+
+using Indices = SimplifiedMesh::Indices;
+using Vertices = SimplifiedMesh::Vertices;
+
+/// Size of the LRU cache modelled by the vertex cache optimization
+std::size_t constexpr kCacheSize = 32;
+/// Size of the FIFO cache used to determine the overdraw clusters
+std::size_t constexpr kClusterCacheSize = 16;
+
+float constexpr kCacheDecayPower = 1.5f;
+float constexpr kLastTriangleScore = 0.75f;
+float constexpr kValenceBoostScale = 2.0f;
+float constexpr kValenceBoostPower = 0.5f;
+std::size_t constexpr kMaxValence = 32;
+
+/// Precomputed vertex scores of Forsyth's algorithm
+class ScoreTable {
+public:
+  ScoreTable() {
+    for (std::size_t i = 0; i < kCacheSize; ++i) {
+      if (i < 3) {
+        // The vertices of the last triangle get a fixed score, to avoid
+        // favouring the same triangle again
+        cache_[i] = kLastTriangleScore;
+      } else {
+        auto const scaler = 1.f / static_cast<float>(kCacheSize - 3);
+        cache_[i] = std::pow(1.f - static_cast<float>(i - 3) * scaler,
+                             kCacheDecayPower);
+      }
+    }
+    valence_[0] = 0.f;
+    for (std::size_t i = 1; i < kMaxValence; ++i) {
+      valence_[i] =
+          kValenceBoostScale *
+          std::pow(static_cast<float>(i), -kValenceBoostPower);
+    }
+  }
+
+  /// Score of a vertex given its position in the cache (kCacheSize if not
+  /// cached) and the number of triangles that still use it
+  inline float operator()(std::size_t cachePosition,
+                          std::uint32_t remainingTriangles) const noexcept {
+    if (remainingTriangles == 0) return -1.f;
+
+    auto score = cachePosition < kCacheSize ? cache_[cachePosition] : 0.f;
+    return score + valence_[std::min<std::size_t>(remainingTriangles,
+                                                  kMaxValence - 1)];
+  }
+
+private:
+  std::array<float, kCacheSize> cache_;
+  std::array<float, kMaxValence> valence_;
+};
+
+/// Simulation of a FIFO post transform cache
+class FifoCache {
+public:
+  FifoCache(std::size_t nVertices, std::size_t size)
+      : timestamps_(nVertices, 0),
+        timestamp_(static_cast<std::uint32_t>(size) + 1),
+        size_(static_cast<std::uint32_t>(size)) {}
+
+  /// Returns the number of cache misses caused by the given triangle
+  inline unsigned int triangle(Indices const &indices,
+                               Eigen::Index row) noexcept {
+    return vertex(indices(row, 0)) + vertex(indices(row, 1)) +
+           vertex(indices(row, 2));
+  }
+
+  /// Invalidates all entries
+  inline void reset() noexcept { timestamp_ += size_ + 1; }
+
+private:
+  inline unsigned int vertex(std::uint32_t v) noexcept {
+    if (timestamp_ - timestamps_[v] > size_) {
+      timestamps_[v] = timestamp_++;
+      return 1;
+    }
+    return 0;
+  }
+
+  std::vector<std::uint32_t> timestamps_;
+  std::uint32_t timestamp_;
+  std::uint32_t size_;
+};
+
+/// Splits the triangles into clusters, such that the ACMR of each cluster is
+/// at most threshold times the ACMR of the surrounding hard cluster.
+/// @return the index of the first triangle of each cluster
+std::vector<Eigen::Index> clusterBoundaries(Indices const &indices,
+                                            std::size_t nVertices,
+                                            float threshold) {
+  auto const nTriangles = indices.rows();
+  FifoCache cache(nVertices, kClusterCacheSize);
+
+  // Hard boundaries are located where the vertex cache optimization had to
+  // start over, i.e. all vertices of a triangle miss the cache
+  std::vector<Eigen::Index> hard;
+  for (Eigen::Index i = 0; i < nTriangles; ++i) {
+    if (cache.triangle(indices, i) == 3) hard.push_back(i);
+  }
+  hard.push_back(nTriangles);
+
+  std::vector<Eigen::Index> soft;
+  for (std::size_t c = 0; c + 1 < hard.size(); ++c) {
+    auto const start = hard[c], end = hard[c + 1];
+
+    cache.reset();
+    unsigned int clusterMisses = 0;
+    for (auto i = start; i < end; ++i)
+      clusterMisses += cache.triangle(indices, i);
+    auto const clusterThreshold = threshold *
+                                  static_cast<float>(clusterMisses) /
+                                  static_cast<float>(end - start);
+
+    soft.push_back(start);
+    cache.reset();
+    unsigned int misses = 0;
+    unsigned int triangles = 0;
+    for (auto i = start; i < end; ++i) {
+      misses += cache.triangle(indices, i);
+      ++triangles;
+
+      // the ACMR goal is reached, start a new cluster with the next triangle
+      if (static_cast<float>(misses) / static_cast<float>(triangles) <=
+              clusterThreshold &&
+          i + 1 < end) {
+        soft.push_back(i + 1);
+        cache.reset();
+        misses = 0;
+        triangles = 0;
+      }
+    }
+  }
+
+  return soft;
+}
+
+} // namespace
+
+float computeACMR(Indices const &indices, std::size_t nVertices,
+                  std::size_t cacheSize) {
+  if (indices.rows() == 0) return 0.f;
+
+  FifoCache cache(nVertices, cacheSize);
+  unsigned long misses = 0;
+  for (Eigen::Index i = 0; i < indices.rows(); ++i)
+    misses += cache.triangle(indices, i);
+
+  return static_cast<float>(misses) / static_cast<float>(indices.rows());
+}
+
+Indices optimizeVertexCache(Indices const &indices, std::size_t nVertices) {
+  static ScoreTable const vertexScore;
+
+  auto const nTriangles = static_cast<std::size_t>(indices.rows());
+
+  // Build vertex to triangle adjacency
+  std::vector<std::uint32_t> remaining(nVertices, 0);
+  for (Eigen::Index i = 0; i < indices.rows(); ++i) {
+    for (Eigen::Index j = 0; j < 3; ++j) {
+      Expects(indices(i, j) < nVertices);
+      ++remaining[indices(i, j)];
+    }
+  }
+  std::vector<std::size_t> offsets(nVertices + 1, 0);
+  std::partial_sum(remaining.begin(), remaining.end(), offsets.begin() + 1);
+  std::vector<std::uint32_t> adjacency(offsets.back());
+  {
+    auto fill = offsets;
+    for (Eigen::Index i = 0; i < indices.rows(); ++i) {
+      for (Eigen::Index j = 0; j < 3; ++j)
+        adjacency[fill[indices(i, j)]++] = static_cast<std::uint32_t>(i);
+    }
+  }
+
+  std::vector<float> scores(nVertices);
+  for (std::size_t v = 0; v < nVertices; ++v)
+    scores[v] = vertexScore(kCacheSize, remaining[v]);
+
+  std::vector<char> added(nTriangles, 0);
+
+  Indices result(indices.rows(), 3);
+  std::vector<std::uint32_t> cache, newCache;
+  cache.reserve(kCacheSize + 3);
+  newCache.reserve(kCacheSize + 3);
+
+  std::size_t cursor = 0;
+  auto best = nTriangles;
+  for (std::size_t out = 0; out < nTriangles; ++out) {
+    if (best == nTriangles) {
+      // Dead end, continue with the next triangle in input order
+      while (added[cursor]) ++cursor;
+      best = cursor;
+    }
+
+    auto const row = static_cast<Eigen::Index>(best);
+    auto const outRow = static_cast<Eigen::Index>(out);
+    result.row(outRow) = indices.row(row);
+    added[best] = 1;
+
+    // Remove the triangle from the adjacency of its vertices and move the
+    // vertices to the front of the cache
+    newCache.clear();
+    for (Eigen::Index j = 0; j < 3; ++j) {
+      auto const v = indices(row, j);
+      auto const first = adjacency.begin() +
+                         static_cast<std::ptrdiff_t>(offsets[v]);
+      auto const last = first + remaining[v];
+      auto const it = std::find(first, last, static_cast<std::uint32_t>(best));
+      std::iter_swap(it, last - 1);
+      --remaining[v];
+      // degenerated triangles may reference a vertex more than once
+      if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+        newCache.push_back(v);
+    }
+    auto const nNew = static_cast<std::ptrdiff_t>(newCache.size());
+    for (auto v : cache) {
+      if (std::find(newCache.begin(), newCache.begin() + nNew, v) ==
+          newCache.begin() + nNew)
+        newCache.push_back(v);
+    }
+    std::swap(cache, newCache);
+
+    // Update scores of all vertices that were in the cache. Vertices beyond
+    // the cache size drop out of the cache.
+    for (std::size_t i = 0; i < cache.size(); ++i) {
+      auto const v = cache[i];
+      scores[v] = vertexScore(std::min(i, kCacheSize), remaining[v]);
+    }
+
+    // Find the best candidate among the triangles using cached vertices
+    best = nTriangles;
+    auto bestScore = -1.f;
+    for (auto v : cache) {
+      for (std::size_t k = offsets[v]; k < offsets[v] + remaining[v]; ++k) {
+        auto const t = adjacency[k];
+        auto const r = static_cast<Eigen::Index>(t);
+        auto const score = scores[indices(r, 0)] + scores[indices(r, 1)] +
+                           scores[indices(r, 2)];
+        if (score > bestScore) {
+          bestScore = score;
+          best = t;
+        }
+      }
+    }
+    if (cache.size() > kCacheSize) cache.resize(kCacheSize);
+  }
+
+  return result;
+}
+
+Indices optimizeOverdraw(Vertices const &vertices, Indices const &indices,
+                         float threshold) {
+  auto const nVertices = static_cast<std::size_t>(vertices.rows());
+  auto const boundaries = clusterBoundaries(indices, nVertices, threshold);
+  auto const nClusters = boundaries.size();
+  if (nClusters < 2) return indices;
+
+  // Area weighted centroid and normal of each cluster
+  std::vector<Vector3f> centroids(nClusters, Vector3f::Zero());
+  std::vector<Vector3f> normals(nClusters, Vector3f::Zero());
+  std::vector<float> areas(nClusters, 0.f);
+  Vector3f meshCentroid = Vector3f::Zero();
+  auto meshArea = 0.f;
+
+  for (std::size_t c = 0; c < nClusters; ++c) {
+    auto const end = c + 1 < nClusters ? boundaries[c + 1] : indices.rows();
+    for (auto i = boundaries[c]; i < end; ++i) {
+      Vector3f const p0 = vertices.row(indices(i, 0));
+      Vector3f const p1 = vertices.row(indices(i, 1));
+      Vector3f const p2 = vertices.row(indices(i, 2));
+      Vector3f const n = (p1 - p0).cross(p2 - p0);
+      auto const area = n.norm();
+
+      centroids[c] += area * (p0 + p1 + p2) / 3.f;
+      normals[c] += n;
+      areas[c] += area;
+    }
+    meshCentroid += centroids[c];
+    meshArea += areas[c];
+    if (areas[c] > 0.f) centroids[c] /= areas[c];
+  }
+  if (meshArea > 0.f) meshCentroid /= meshArea;
+
+  // Clusters that face away from the center of the mesh are likely to occlude
+  // other clusters, so they are drawn first
+  std::vector<float> keys(nClusters);
+  for (std::size_t c = 0; c < nClusters; ++c) {
+    auto const norm = normals[c].norm();
+    keys[c] = norm > 0.f ? (centroids[c] - meshCentroid).dot(normals[c]) / norm
+                         : 0.f;
+  }
+
+  std::vector<std::size_t> order(nClusters);
+  std::iota(order.begin(), order.end(), std::size_t{0});
+  std::stable_sort(order.begin(), order.end(), [&keys](auto a, auto b) {
+    return keys[a] > keys[b];
+  });
+
+  Indices result(indices.rows(), 3);
+  Eigen::Index out = 0;
+  for (auto c : order) {
+    auto const end = c + 1 < nClusters ? boundaries[c + 1] : indices.rows();
+    auto const count = end - boundaries[c];
+    result.middleRows(out, count) = indices.middleRows(boundaries[c], count);
+    out += count;
+  }
+
+  return result;
+}
+
+std::vector<std::uint32_t> optimizeVertexFetch(Vertices &vertices,
+                                               Indices &indices) {
+  auto constexpr kUnused = std::numeric_limits<std::uint32_t>::max();
+
+  std::vector<std::uint32_t> newIndex(static_cast<std::size_t>(vertices.rows()),
+                                      kUnused);
+  std::vector<std::uint32_t> remap;
+  remap.reserve(newIndex.size());
+
+  for (Eigen::Index i = 0; i < indices.rows(); ++i) {
+    for (Eigen::Index j = 0; j < 3; ++j) {
+      auto &idx = newIndex[indices(i, j)];
+      if (idx == kUnused) {
+        idx = static_cast<std::uint32_t>(remap.size());
+        remap.push_back(indices(i, j));
+      }
+      indices(i, j) = idx;
+    }
+  }
+
+  Vertices reordered(static_cast<Eigen::Index>(remap.size()), 3);
+  for (std::size_t i = 0; i < remap.size(); ++i) {
+    reordered.row(static_cast<Eigen::Index>(i)) =
+        vertices.row(static_cast<Eigen::Index>(remap[i]));
+  }
+  vertices = std::move(reordered);
+
+  return remap;
+}
+
+void optimizeMeshForRendering(SimplifiedMesh &mesh) {
+  auto const nVertices = static_cast<std::size_t>(mesh.vertices.rows());
+
+  mesh.indices = optimizeVertexCache(mesh.indices, nVertices);
+  mesh.indices = optimizeOverdraw(mesh.vertices, mesh.indices);
+  auto remap = optimizeVertexFetch(mesh.vertices, mesh.indices);
+
+  if (mesh.sourceVertices.empty()) {
+    mesh.sourceVertices = std::move(remap);
+  } else {
+    for (auto &r : remap) r = mesh.sourceVertices[r];
+    mesh.sourceVertices = std::move(remap);
+  }
+}
+
+} // namespace Private_
+} // namespace VolViz
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "MeshSimplification.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace VolViz {
+namespace Private_ {
+
+/// Computes the average cache miss ratio (ACMR), i.e. the number of
+/// transformed vertices per triangle, simulating a FIFO post transform cache.
+///
+/// @param indices triangles of the mesh
+/// @param nVertices number of vertices of the mesh
+/// @param cacheSize number of entries of the simulated cache
+float computeACMR(SimplifiedMesh::Indices const &indices, std::size_t nVertices,
+                  std::size_t cacheSize = 16);
+
+/// Reorders the triangles to improve the post transform vertex cache hit rate
+/// using Forsyth's linear-speed vertex cache optimization.
+SimplifiedMesh::Indices
+optimizeVertexCache(SimplifiedMesh::Indices const &indices,
+                    std::size_t nVertices);
+
+/// Reorders clusters of triangles to reduce overdraw, following Sander et al.
+/// "Fast triangle reordering for vertex locality and reduced overdraw".
+/// The indices should be optimized for the vertex cache before; the clusters
+/// are chosen such that the ACMR increases by at most the given threshold.
+SimplifiedMesh::Indices
+optimizeOverdraw(SimplifiedMesh::Vertices const &vertices,
+                 SimplifiedMesh::Indices const &indices,
+                 float threshold = 1.05f);
+
+/// Reorders the vertices in the order they are first referenced by the
+/// triangles and removes unreferenced vertices. The indices are updated
+/// accordingly.
+///
+/// @return for each new vertex the index of the old vertex
+std::vector<std::uint32_t>
+optimizeVertexFetch(SimplifiedMesh::Vertices &vertices,
+                    SimplifiedMesh::Indices &indices);
+
+/// Runs all of the above optimizations on the mesh. The source vertices of
+/// the mesh are remapped, so they still refer to the original mesh.
+void optimizeMeshForRendering(SimplifiedMesh &mesh);
+
+} // namespace Private_
+} // namespace VolViz
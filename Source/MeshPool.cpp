@@ -0,0 +1,326 @@
+#include "MeshPool.h"
+#include "GL/Binding.h"
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <utility>
+
+namespace VolViz {
+namespace Private_ {
+
+namespace {
+
+/// Initial capacities of the shared buffers
+std::size_t constexpr kInitialVertices = 1 << 16;
+std::size_t constexpr kInitialIndices = 3 << 16;
+
+/// Writes data into the buffer, without touching the bindings of vertex
+/// arrays
+template <class T>
+void write(GL::Buffer const &buffer, std::size_t first,
+           std::vector<T> const &data) {
+  if (data.empty()) return;
+  auto const bufferBinding =
+      GL::binding(buffer, static_cast<GLenum>(GL_COPY_WRITE_BUFFER));
+  glBufferSubData(GL_COPY_WRITE_BUFFER,
+                  static_cast<GLintptr>(first * sizeof(T)),
+                  static_cast<GLsizeiptr>(data.size() * sizeof(T)),
+                  data.data());
+  assertGL("glBufferSubData failed");
+}
+
+} // namespace
+
+constexpr GLuint MeshPool::kDrawRecordUnit;
+constexpr std::size_t MeshPool::FreeList::npos;
+
+#pragma mark Allocation
+
+MeshPool::Allocation::Allocation(Allocation &&rhs) noexcept
+    : pool_(rhs.pool_), firstVertex_(rhs.firstVertex_),
+      numVertices_(rhs.numVertices_), firstIndex_(rhs.firstIndex_),
+      numIndices_(rhs.numIndices_) {
+  rhs.pool_ = nullptr;
+}
+
+MeshPool::Allocation &MeshPool::Allocation::
+operator=(Allocation &&rhs) noexcept {
+  using std::swap;
+  swap(pool_, rhs.pool_);
+  swap(firstVertex_, rhs.firstVertex_);
+  swap(numVertices_, rhs.numVertices_);
+  swap(firstIndex_, rhs.firstIndex_);
+  swap(numIndices_, rhs.numIndices_);
+  return *this;
+}
+
+MeshPool::Allocation::~Allocation() {
+  if (pool_ != nullptr) pool_->release(*this);
+}
+
+#pragma mark FreeList
+
+std::size_t MeshPool::FreeList::allocate(std::size_t size) {
+  if (size == 0) return 0;
+
+  auto const fit =
+      std::find_if(ranges_.begin(), ranges_.end(),
+                   [size](auto const &range) { return range.second >= size; });
+  if (fit == ranges_.end()) return npos;
+
+  auto const offset = fit->first;
+  auto const remaining = fit->second - size;
+  ranges_.erase(fit);
+  if (remaining > 0) ranges_.emplace(offset + size, remaining);
+  return offset;
+}
+
+void MeshPool::FreeList::release(std::size_t offset, std::size_t size) {
+  if (size == 0) return;
+
+  auto next = ranges_.lower_bound(offset);
+  // merge with the following range
+  if (next != ranges_.end() && offset + size == next->first) {
+    size += next->second;
+    next = ranges_.erase(next);
+  }
+  // merge with the preceding range
+  if (next != ranges_.begin()) {
+    auto const previous = std::prev(next);
+    if (previous->first + previous->second == offset) {
+      previous->second += size;
+      return;
+    }
+  }
+  ranges_.emplace_hint(next, offset, size);
+}
+
+#pragma mark MeshPool
+
+void MeshPool::init(bool supportsIndirectDraws) {
+  supportsIndirectDraws_ = supportsIndirectDraws;
+
+  GL::Buffer const empty(0);
+  vertexBuffer_ = GL::resized(empty, 0, kInitialVertices * sizeof(Vertex),
+                              GL_STATIC_DRAW);
+  scalarBuffer_ = GL::resized(empty, 0, kInitialVertices * sizeof(float),
+                              GL_STATIC_DRAW);
+  indexBuffer_ = GL::resized(empty, 0, kInitialIndices * sizeof(std::uint32_t),
+                             GL_STATIC_DRAW);
+  vertexCapacity_ = kInitialVertices;
+  indexCapacity_ = kInitialIndices;
+  freeVertices_.release(0, vertexCapacity_);
+  freeIndices_.release(0, indexCapacity_);
+
+  vertexArray_ = GL::VertexArray();
+  drawIndexBuffer_ = GL::Buffer();
+  drawRecordBuffer_ = GL::Buffer();
+  indirectBuffer_ = GL::Buffer();
+  reserveDrawIndices(1);
+
+  // A buffer texture can only be attached to a buffer that has a data store,
+  // so the buffer gets room for one record until the first draw replaces it
+  drawRecordBuffer_.upload(GL_TEXTURE_BUFFER, sizeof(DrawRecord),
+                           static_cast<DrawRecord const *>(nullptr),
+                           GL_STREAM_DRAW);
+  GL::Buffer::unbind(GL_TEXTURE_BUFFER);
+  drawRecordTexture_ = GL::Textures<1>();
+  glBindTexture(GL_TEXTURE_BUFFER, drawRecordTexture_.names[0]);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, drawRecordBuffer_.name);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  assertGL("Failed to setup mesh pool");
+}
+
+MeshPool::Allocation
+MeshPool::allocate(std::vector<Vertex> const &vertices,
+                   std::vector<std::uint32_t> const &indices) {
+  Allocation allocation;
+  allocation.pool_ = this;
+  allocation.numVertices_ = vertices.size();
+  allocation.firstVertex_ = allocateVertices(vertices.size());
+  allocation.numIndices_ = indices.size();
+  allocation.firstIndex_ = allocateIndices(indices.size());
+  Ensures(allocation.firstVertex_ <=
+          static_cast<std::size_t>(std::numeric_limits<GLint>::max()));
+
+  write(vertexBuffer_, allocation.firstVertex_, vertices);
+  write(indexBuffer_, allocation.firstIndex_, indices);
+  return allocation;
+}
+
+void MeshPool::uploadScalars(Allocation const &allocation,
+                             std::vector<float> const &scalars) {
+  Expects(allocation.pool_ == this);
+  Expects(scalars.size() == allocation.numVertices_);
+  write(scalarBuffer_, allocation.firstVertex_, scalars);
+}
+
+void MeshPool::release(Allocation &allocation) noexcept {
+  freeVertices_.release(allocation.firstVertex_, allocation.numVertices_);
+  freeIndices_.release(allocation.firstIndex_, allocation.numIndices_);
+  allocation.pool_ = nullptr;
+}
+
+std::size_t MeshPool::allocateVertices(std::size_t count) {
+  auto offset = freeVertices_.allocate(count);
+  while (offset == FreeList::npos) {
+    auto const capacity =
+        std::max(2 * vertexCapacity_, vertexCapacity_ + count);
+    vertexBuffer_ = GL::resized(vertexBuffer_, vertexCapacity_ * sizeof(Vertex),
+                                capacity * sizeof(Vertex), GL_STATIC_DRAW);
+    scalarBuffer_ = GL::resized(scalarBuffer_, vertexCapacity_ * sizeof(float),
+                                capacity * sizeof(float), GL_STATIC_DRAW);
+    freeVertices_.release(vertexCapacity_, capacity - vertexCapacity_);
+    vertexCapacity_ = capacity;
+    setupVertexArray();
+    offset = freeVertices_.allocate(count);
+  }
+  return offset;
+}
+
+std::size_t MeshPool::allocateIndices(std::size_t count) {
+  auto offset = freeIndices_.allocate(count);
+  while (offset == FreeList::npos) {
+    auto const capacity = std::max(2 * indexCapacity_, indexCapacity_ + count);
+    indexBuffer_ =
+        GL::resized(indexBuffer_, indexCapacity_ * sizeof(std::uint32_t),
+                    capacity * sizeof(std::uint32_t), GL_STATIC_DRAW);
+    freeIndices_.release(indexCapacity_, capacity - indexCapacity_);
+    indexCapacity_ = capacity;
+    setupVertexArray();
+    offset = freeIndices_.allocate(count);
+  }
+  return offset;
+}
+
+void MeshPool::setupVertexArray() {
+  auto const vaoBinding = GL::binding(vertexArray_);
+  indexBuffer_.bind(GL_ELEMENT_ARRAY_BUFFER);
+
+  vertexBuffer_.bind(GL_ARRAY_BUFFER);
+  glEnableVertexAttribArray(0);
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(
+      0, 3, GL_UNSIGNED_SHORT, true, sizeof(Vertex),
+      reinterpret_cast<void const *>(offsetof(Vertex, position)));
+  glVertexAttribPointer(
+      1, 2, GL_SHORT, true, sizeof(Vertex),
+      reinterpret_cast<void const *>(offsetof(Vertex, normal)));
+
+  scalarBuffer_.bind(GL_ARRAY_BUFFER);
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(2, 1, GL_FLOAT, false, sizeof(float), nullptr);
+
+  // without indirect draws, the index is set as generic attribute per draw
+  if (supportsIndirectDraws_) {
+    drawIndexBuffer_.bind(GL_ARRAY_BUFFER);
+    glEnableVertexAttribArray(3);
+    glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(GLuint), nullptr);
+    glVertexAttribDivisor(3, 1);
+  }
+  GL::Buffer::unbind(GL_ARRAY_BUFFER);
+  assertGL("Failed to setup vertex array");
+}
+
+void MeshPool::reserveDrawIndices(std::size_t count) {
+  if (count <= drawIndexCapacity_) return;
+
+  drawIndexCapacity_ = std::max(count, 2 * drawIndexCapacity_);
+  std::vector<GLuint> indices(drawIndexCapacity_);
+  std::iota(indices.begin(), indices.end(), 0u);
+  drawIndexBuffer_.upload(GL_ARRAY_BUFFER, indices.size() * sizeof(GLuint),
+                          indices.data(), GL_STATIC_DRAW);
+  GL::Buffer::unbind(GL_ARRAY_BUFFER);
+  setupVertexArray();
+}
+
+void MeshPool::queueDraw(Allocation const &allocation,
+                         DrawRecord const &record,
+                         std::vector<Range<std::uint32_t>> const &triangles,
+                         bool cullBackFaces) {
+  Expects(allocation.pool_ == this);
+  if (triangles.empty()) return;
+
+  auto const recordIndex = narrow_cast<GLuint>(records_.size());
+  records_.push_back(record);
+
+  auto &commands = commands_[cullBackFaces ? 1 : 0];
+  for (auto const &range : triangles) {
+    commands.push_back({3 * range.length(), 1,
+                        narrow_cast<GLuint>(allocation.firstIndex_ +
+                                            3 * range.min),
+                        allocation.baseVertex(), recordIndex});
+  }
+}
+
+void MeshPool::draw(GL::ShaderProgram &program) {
+  if (records_.empty()) return;
+
+  // The buffers are orphaned, so that writing them does not wait for the
+  // draws of the previous frame
+  drawRecordBuffer_.upload(GL_TEXTURE_BUFFER,
+                           records_.size() * sizeof(DrawRecord),
+                           records_.data(), GL_STREAM_DRAW);
+  GL::Buffer::unbind(GL_TEXTURE_BUFFER);
+  glActiveTexture(GL_TEXTURE0 + kDrawRecordUnit);
+  glBindTexture(GL_TEXTURE_BUFFER, drawRecordTexture_.names[0]);
+  glActiveTexture(GL_TEXTURE0);
+  assertGL("Failed to upload draw records");
+
+  program.use();
+  program["drawRecords"] = static_cast<GLint>(kDrawRecordUnit);
+
+  if (supportsIndirectDraws_) reserveDrawIndices(records_.size());
+  auto const vaoBinding = GL::binding(vertexArray_);
+  if (supportsIndirectDraws_) {
+    std::vector<DrawCommand> allCommands;
+    allCommands.reserve(commands_[0].size() + commands_[1].size());
+    for (auto const &commands : commands_)
+      allCommands.insert(allCommands.end(), commands.begin(), commands.end());
+
+    auto const indirectBinding = GL::binding(
+        indirectBuffer_, static_cast<GLenum>(GL_DRAW_INDIRECT_BUFFER));
+    glBufferData(GL_DRAW_INDIRECT_BUFFER,
+                 static_cast<GLsizeiptr>(allCommands.size() *
+                                         sizeof(DrawCommand)),
+                 allCommands.data(), GL_STREAM_DRAW);
+
+    std::size_t first = 0;
+    for (std::size_t cull = 0; cull < commands_.size(); ++cull) {
+      auto const count = commands_[cull].size();
+      if (count == 0) continue;
+      if (cull) glEnable(GL_CULL_FACE);
+      glMultiDrawElementsIndirect(
+          GL_TRIANGLES, GL_UNSIGNED_INT,
+          reinterpret_cast<void const *>(
+              static_cast<std::uintptr_t>(first * sizeof(DrawCommand))),
+          static_cast<GLsizei>(count), 0);
+      assertGL("glMultiDrawElementsIndirect failed");
+      if (cull) glDisable(GL_CULL_FACE);
+      first += count;
+    }
+  } else {
+    for (std::size_t cull = 0; cull < commands_.size(); ++cull) {
+      if (commands_[cull].empty()) continue;
+      if (cull) glEnable(GL_CULL_FACE);
+      for (auto const &command : commands_[cull]) {
+        glVertexAttribI1ui(3, command.baseInstance);
+        glDrawElementsBaseVertex(
+            GL_TRIANGLES, static_cast<GLsizei>(command.count),
+            GL_UNSIGNED_INT,
+            reinterpret_cast<void const *>(static_cast<std::uintptr_t>(
+                command.firstIndex * sizeof(std::uint32_t))),
+            command.baseVertex);
+      }
+      assertGL("glDrawElementsBaseVertex failed");
+      if (cull) glDisable(GL_CULL_FACE);
+    }
+  }
+
+  records_.clear();
+  for (auto &commands : commands_) commands.clear();
+}
+
+} // namespace Private_
+} // namespace VolViz
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "GL/Buffer.h"
+#include "GL/ShaderProgram.h"
+#include "GL/Textures.h"
+#include "GL/VertexArray.h"
+#include "Types.h"
+#include "UniformBlocks.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <vector>
+
+namespace VolViz {
+namespace Private_ {
+
+/// Vertices and indices of all meshes in shared buffers with a single vertex
+/// array. Meshes allocate ranges of the buffers, which grow as needed. Draws
+/// are queued during the geometry pass and submitted at once, with
+/// glMultiDrawElementsIndirect on OpenGL 4.3 and later and with a loop of
+/// glDrawElementsBaseVertex calls otherwise. The per draw data is read from a
+/// texture buffer, so both paths share the shader.
+class MeshPool {
+public:
+  /// Compact vertex format. Positions are quantized to 16 bit relative to the
+  /// bounding box of the mesh, normals are octahedral encoded into two 16 bit
+  /// signed normalized values.
+  struct Vertex {
+    std::array<std::uint16_t, 3> position;
+    std::uint16_t padding;
+    std::array<std::int16_t, 2> normal;
+  };
+  static_assert(sizeof(Vertex) == 12, "Unexpected packed vertex size");
+
+  /// Data of a queued draw, laid out as expected by the batch shader
+  struct DrawRecord {
+    ObjectUniforms object;
+    /// Dequantization parameters of the vertex positions, i.e.
+    /// position = positionOffset + positionScale * quantizedPosition
+    std::array<float, 4> positionOffset;
+    std::array<float, 4> positionScale;
+  };
+  static_assert(sizeof(DrawRecord) == 19 * 4 * sizeof(float),
+                "Unexpected draw record size");
+
+  /// Ranges of the shared buffers owned by a mesh, released on destruction.
+  /// The indices are relative to the first vertex of the allocation.
+  class Allocation {
+  public:
+    Allocation() = default;
+    Allocation(Allocation const &) = delete;
+    Allocation(Allocation &&rhs) noexcept;
+    Allocation &operator=(Allocation &&rhs) noexcept;
+    ~Allocation();
+
+    inline GLint baseVertex() const noexcept {
+      return static_cast<GLint>(firstVertex_);
+    }
+    inline std::size_t firstIndex() const noexcept { return firstIndex_; }
+    inline std::size_t numVertices() const noexcept { return numVertices_; }
+    inline std::size_t numIndices() const noexcept { return numIndices_; }
+
+  private:
+    friend class MeshPool;
+
+    MeshPool *pool_{nullptr};
+    std::size_t firstVertex_{0};
+    std::size_t numVertices_{0};
+    std::size_t firstIndex_{0};
+    std::size_t numIndices_{0};
+  };
+
+  /// Texture unit the draw records are bound to while drawing
+  static constexpr GLuint kDrawRecordUnit = 2;
+
+  /// Creates the buffers, requires a current OpenGL context
+  void init(bool supportsIndirectDraws);
+
+  inline bool supportsIndirectDraws() const noexcept {
+    return supportsIndirectDraws_;
+  }
+
+  /// Allocates ranges for the vertices and indices and uploads them
+  Allocation allocate(std::vector<Vertex> const &vertices,
+                      std::vector<std::uint32_t> const &indices);
+
+  /// Uploads a scalar for each vertex of the allocation
+  void uploadScalars(Allocation const &allocation,
+                     std::vector<float> const &scalars);
+
+  /// Vertex array of the shared buffers, with the position (0), normal (1),
+  /// scalar (2) and the draw record index (3) as attributes
+  inline GL::VertexArray const &vertexArrayObject() const noexcept {
+    return vertexArray_;
+  }
+
+  /// Queues the draw of triangle ranges of the allocation
+  void queueDraw(Allocation const &allocation, DrawRecord const &record,
+                 std::vector<Range<std::uint32_t>> const &triangles,
+                 bool cullBackFaces);
+
+  /// Draws all queued draws with the batch program and clears the queue
+  void draw(GL::ShaderProgram &program);
+
+private:
+  /// Layout of the commands read by glMultiDrawElementsIndirect
+  struct DrawCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+  };
+
+  /// First fit allocator of ranges of a buffer
+  class FreeList {
+  public:
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    /// Returns the offset of the allocated range, npos if no free range is
+    /// large enough
+    std::size_t allocate(std::size_t size);
+
+    void release(std::size_t offset, std::size_t size);
+
+  private:
+    /// Offset and size of the free ranges, adjacent ranges are merged
+    std::map<std::size_t, std::size_t> ranges_;
+  };
+
+  void release(Allocation &allocation) noexcept;
+
+  /// Allocates a range of the free list, growing the buffers until it fits
+  std::size_t allocateVertices(std::size_t count);
+  std::size_t allocateIndices(std::size_t count);
+
+  /// Points the attributes of the vertex array to the current buffers
+  void setupVertexArray();
+
+  /// Makes sure there is a draw record index for each queued record
+  void reserveDrawIndices(std::size_t count);
+
+  bool supportsIndirectDraws_{false};
+
+  GL::Buffer vertexBuffer_{0};
+  GL::Buffer scalarBuffer_{0};
+  GL::Buffer indexBuffer_{0};
+  GL::VertexArray vertexArray_{0};
+  std::size_t vertexCapacity_{0};
+  std::size_t indexCapacity_{0};
+  FreeList freeVertices_;
+  FreeList freeIndices_;
+
+  /// Contains 0, 1, 2, ... and is used as instanced attribute, such that the
+  /// base instance of an indirect draw selects its record
+  GL::Buffer drawIndexBuffer_{0};
+  std::size_t drawIndexCapacity_{0};
+
+  GL::Buffer drawRecordBuffer_{0};
+  GL::Textures<1> drawRecordTexture_{0};
+  GL::Buffer indirectBuffer_{0};
+
+  /// Queued draws, the commands are split by whether back faces are culled
+  std::vector<DrawRecord> records_;
+  std::array<std::vector<DrawCommand>, 2> commands_;
+};
+
+} // namespace Private_
+} // namespace VolViz
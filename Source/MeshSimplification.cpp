@@ -0,0 +1,341 @@
+#include "MeshSimplification.h"
+
+#include <Eigen/LU>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <queue>
+#include <tuple>
+
+namespace VolViz {
+namespace Private_ {
+
+namespace {
+
+using Vector3d = Eigen::Vector3d;
+using Triangle = std::array<std::uint32_t, 3>;
+
+/// Weight of the virtual planes that are placed perpendicular to boundary
+/// edges, to prevent the boundary from shrinking
+double constexpr kBoundaryWeight = 1000.0;
+
+/// Minimal cosine of the angle between the normal of a triangle before and
+/// after a collapse. Collapses that rotate a triangle more are rejected.
+double constexpr kMinNormalCosine = 0.2;
+
+/// Symmetric 4x4 error quadric, only the 10 unique coefficients are stored:
+/// a^2, ab, ac, ad, b^2, bc, bd, c^2, cd, d^2
+struct Quadric {
+  std::array<double, 10> q{{0, 0, 0, 0, 0, 0, 0, 0, 0, 0}};
+
+  /// Creates the quadric of the plane ax + by + cz + d = 0 scaled by weight
+  static Quadric fromPlane(Vector3d const &n, double d, double weight) {
+    Quadric Q;
+    Q.q = {{n(0) * n(0), n(0) * n(1), n(0) * n(2), n(0) * d, n(1) * n(1),
+            n(1) * n(2), n(1) * d, n(2) * n(2), n(2) * d, d * d}};
+    for (auto &c : Q.q) c *= weight;
+    return Q;
+  }
+
+  inline Quadric &operator+=(Quadric const &rhs) noexcept {
+    for (std::size_t i = 0; i < q.size(); ++i) q[i] += rhs.q[i];
+    return *this;
+  }
+
+  /// Returns the error v^T Q v for v = (p, 1)
+  inline double evaluate(Vector3d const &p) const noexcept {
+    auto const x = p(0), y = p(1), z = p(2);
+    return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z +
+           2 * q[3] * x + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y +
+           q[7] * z * z + 2 * q[8] * z + q[9];
+  }
+
+  /// Computes the position of minimal error.
+  /// @return false if the system is (nearly) singular
+  inline bool optimum(Vector3d &p) const noexcept {
+    Eigen::Matrix3d A;
+    A << q[0], q[1], q[2], q[1], q[4], q[5], q[2], q[5], q[7];
+    auto const maxCoeff = A.cwiseAbs().maxCoeff();
+    if (maxCoeff <= 0.0) return false;
+
+    auto const det = A.determinant();
+    if (std::abs(det) < 1e-9 * maxCoeff * maxCoeff * maxCoeff) return false;
+
+    p = A.inverse() * Vector3d(-q[3], -q[6], -q[8]);
+    return true;
+  }
+};
+
+/// A candidate edge collapse. The vertex remove is merged into vertex keep,
+/// which is moved to position. The stamps are used to detect outdated
+/// candidates.
+struct Collapse {
+  double cost;
+  std::uint32_t keep, remove;
+  std::uint32_t keepStamp, removeStamp;
+  Vector3d position;
+
+  inline bool operator>(Collapse const &rhs) const noexcept {
+    return cost > rhs.cost;
+  }
+};
+
+using CollapseQueue = std::priority_queue<Collapse, std::vector<Collapse>,
+                                          std::greater<Collapse>>;
+
+inline bool contains(Triangle const &t, std::uint32_t v) noexcept {
+  return t[0] == v || t[1] == v || t[2] == v;
+}
+
+inline Vector3d triangleNormal(Vector3d const &p0, Vector3d const &p1,
+                               Vector3d const &p2) noexcept {
+  return (p1 - p0).cross(p2 - p0);
+}
+
+} // namespace
+
+SimplifiedMesh simplifyMesh(SimplifiedMesh::Vertices const &vertices,
+                            SimplifiedMesh::Indices const &indices,
+                            std::size_t targetTriangles,
+                            std::function<bool()> const &shouldAbort) {
+  auto const nVertices = static_cast<std::size_t>(vertices.rows());
+  auto const nTriangles = static_cast<std::size_t>(indices.rows());
+
+  std::vector<Vector3d> positions(nVertices);
+  std::vector<Quadric> quadrics(nVertices);
+  std::vector<std::vector<std::uint32_t>> vertexTriangles(nVertices);
+  std::vector<std::uint32_t> stamps(nVertices, 0);
+  std::vector<char> vertexAlive(nVertices, 1);
+
+  std::vector<Triangle> triangles(nTriangles);
+  std::vector<char> triangleAlive(nTriangles, 1);
+  std::vector<Vector3d> triangleNormals(nTriangles);
+
+  for (std::size_t i = 0; i < nVertices; ++i)
+    positions[i] = vertices.row(static_cast<Eigen::Index>(i))
+                       .transpose()
+                       .cast<double>();
+
+  // Accumulate the face quadrics, weighted by the triangle area
+  std::size_t liveTriangles = 0;
+  for (std::size_t i = 0; i < nTriangles; ++i) {
+    auto const row = static_cast<Eigen::Index>(i);
+    auto &t = triangles[i];
+    t = {{indices(row, 0), indices(row, 1), indices(row, 2)}};
+    Expects(t[0] < nVertices && t[1] < nVertices && t[2] < nVertices);
+
+    Vector3d n =
+        triangleNormal(positions[t[0]], positions[t[1]], positions[t[2]]);
+    auto const area = n.norm();
+    if (area <= 0.0 || t[0] == t[1] || t[1] == t[2] || t[0] == t[2]) {
+      // drop degenerated triangles right away
+      triangleAlive[i] = 0;
+      continue;
+    }
+    n /= area;
+    triangleNormals[i] = n;
+
+    auto const Q = Quadric::fromPlane(n, -n.dot(positions[t[0]]), area);
+    for (auto v : t) {
+      quadrics[v] += Q;
+      vertexTriangles[v].push_back(static_cast<std::uint32_t>(i));
+    }
+    ++liveTriangles;
+  }
+
+  // Collect all edges together with an adjacent triangle
+  std::vector<std::tuple<std::uint32_t, std::uint32_t, std::uint32_t>> edges;
+  edges.reserve(3 * liveTriangles);
+  for (std::size_t i = 0; i < nTriangles; ++i) {
+    if (!triangleAlive[i]) continue;
+    auto const &t = triangles[i];
+    for (std::size_t j = 0; j < 3; ++j) {
+      auto const a = t[j], b = t[(j + 1) % 3];
+      edges.emplace_back(std::min(a, b), std::max(a, b),
+                         static_cast<std::uint32_t>(i));
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+
+  // Edges with only one adjacent triangle are boundary edges. Add a plane
+  // perpendicular to the adjacent triangle to preserve the boundary.
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> uniqueEdges;
+  uniqueEdges.reserve(edges.size() / 2 + 1);
+  for (std::size_t i = 0; i < edges.size();) {
+    auto j = i + 1;
+    while (j < edges.size() && std::get<0>(edges[j]) == std::get<0>(edges[i]) &&
+           std::get<1>(edges[j]) == std::get<1>(edges[i]))
+      ++j;
+
+    auto const a = std::get<0>(edges[i]), b = std::get<1>(edges[i]);
+    uniqueEdges.emplace_back(a, b);
+
+    if (j - i == 1) {
+      Vector3d const e = positions[b] - positions[a];
+      Vector3d n = e.cross(triangleNormals[std::get<2>(edges[i])]);
+      auto const len = n.norm();
+      if (len > 0.0) {
+        n /= len;
+        auto const Q = Quadric::fromPlane(n, -n.dot(positions[a]),
+                                          kBoundaryWeight * e.squaredNorm());
+        quadrics[a] += Q;
+        quadrics[b] += Q;
+      }
+    }
+    i = j;
+  }
+  edges.clear();
+  edges.shrink_to_fit();
+
+  auto const computeCollapse = [&](std::uint32_t a, std::uint32_t b) {
+    auto Q = quadrics[a];
+    Q += quadrics[b];
+
+    auto const &pa = positions[a];
+    auto const &pb = positions[b];
+    Vector3d const mid = (pa + pb) / 2;
+
+    Vector3d p;
+    // Fall back to the best of the end points and the midpoint if the
+    // quadric is singular or the optimum is far off the edge
+    if (!Q.optimum(p) ||
+        (p - mid).squaredNorm() > 4 * (pb - pa).squaredNorm()) {
+      p = pa;
+      for (auto const &c : {pb, mid})
+        if (Q.evaluate(c) < Q.evaluate(p)) p = c;
+    }
+
+    auto const keepA = (p - pa).squaredNorm() <= (p - pb).squaredNorm();
+    auto const keep = keepA ? a : b;
+    auto const remove = keepA ? b : a;
+    return Collapse{std::max(0.0, Q.evaluate(p)), keep, remove, stamps[keep],
+                    stamps[remove], p};
+  };
+
+  // Returns true if moving vertex v to p flips or degenerates any of its
+  // triangles, except for the ones shared with vertex other
+  auto const flips = [&](std::uint32_t v, std::uint32_t other,
+                         Vector3d const &p) {
+    for (auto tIdx : vertexTriangles[v]) {
+      if (!triangleAlive[tIdx]) continue;
+      auto const &t = triangles[tIdx];
+      if (contains(t, other)) continue;
+
+      std::array<Vector3d, 3> corners;
+      for (std::size_t j = 0; j < 3; ++j)
+        corners[j] = t[j] == v ? p : positions[t[j]];
+
+      Vector3d const n = triangleNormal(corners[0], corners[1], corners[2]);
+      auto const len = n.norm();
+      if (len <= 0.0) return true;
+      if (n.dot(triangleNormals[tIdx]) < kMinNormalCosine * len) return true;
+    }
+    return false;
+  };
+
+  CollapseQueue queue;
+  for (auto const &e : uniqueEdges)
+    queue.push(computeCollapse(e.first, e.second));
+  uniqueEdges.clear();
+  uniqueEdges.shrink_to_fit();
+
+  std::vector<std::uint32_t> neighbours;
+  std::size_t iteration = 0;
+
+  while (liveTriangles > targetTriangles && !queue.empty()) {
+    if ((++iteration & 0xfff) == 0 && shouldAbort && shouldAbort()) return {};
+
+    auto const c = queue.top();
+    queue.pop();
+
+    // skip outdated candidates
+    if (!vertexAlive[c.keep] || !vertexAlive[c.remove]) continue;
+    if (stamps[c.keep] != c.keepStamp || stamps[c.remove] != c.removeStamp)
+      continue;
+
+    if (flips(c.keep, c.remove, c.position) ||
+        flips(c.remove, c.keep, c.position))
+      continue;
+
+    // perform the collapse
+    positions[c.keep] = c.position;
+    quadrics[c.keep] += quadrics[c.remove];
+    vertexAlive[c.remove] = 0;
+    ++stamps[c.keep];
+
+    auto &keepTriangles = vertexTriangles[c.keep];
+    for (auto tIdx : vertexTriangles[c.remove]) {
+      if (!triangleAlive[tIdx]) continue;
+      auto &t = triangles[tIdx];
+      if (contains(t, c.keep)) {
+        triangleAlive[tIdx] = 0;
+        --liveTriangles;
+        continue;
+      }
+      for (auto &v : t)
+        if (v == c.remove) v = c.keep;
+      keepTriangles.push_back(tIdx);
+    }
+    vertexTriangles[c.remove].clear();
+    vertexTriangles[c.remove].shrink_to_fit();
+
+    keepTriangles.erase(std::remove_if(keepTriangles.begin(),
+                                       keepTriangles.end(),
+                                       [&](auto tIdx) {
+                                         return !triangleAlive[tIdx];
+                                       }),
+                        keepTriangles.end());
+
+    // update the normals of the modified triangles and collect the new
+    // neighbourhood of the kept vertex
+    neighbours.clear();
+    for (auto tIdx : keepTriangles) {
+      auto const &t = triangles[tIdx];
+      triangleNormals[tIdx] =
+          triangleNormal(positions[t[0]], positions[t[1]], positions[t[2]])
+              .normalized();
+      for (auto v : t)
+        if (v != c.keep) neighbours.push_back(v);
+    }
+    std::sort(neighbours.begin(), neighbours.end());
+    neighbours.erase(std::unique(neighbours.begin(), neighbours.end()),
+                     neighbours.end());
+
+    for (auto n : neighbours) queue.push(computeCollapse(c.keep, n));
+  }
+
+  // Compact the remaining vertices and triangles
+  auto constexpr kInvalid = ~std::uint32_t{0};
+  std::vector<std::uint32_t> remap(nVertices, kInvalid);
+
+  SimplifiedMesh result;
+  result.indices.resize(static_cast<Eigen::Index>(liveTriangles), 3);
+  result.sourceVertices.reserve(nVertices);
+
+  Eigen::Index row = 0;
+  for (std::size_t i = 0; i < nTriangles; ++i) {
+    if (!triangleAlive[i]) continue;
+    for (std::size_t j = 0; j < 3; ++j) {
+      auto const v = triangles[i][j];
+      if (remap[v] == kInvalid) {
+        remap[v] = static_cast<std::uint32_t>(result.sourceVertices.size());
+        result.sourceVertices.push_back(v);
+      }
+      result.indices(row, static_cast<Eigen::Index>(j)) = remap[v];
+    }
+    ++row;
+  }
+
+  result.vertices.resize(
+      static_cast<Eigen::Index>(result.sourceVertices.size()), 3);
+  for (std::size_t i = 0; i < result.sourceVertices.size(); ++i) {
+    result.vertices.row(static_cast<Eigen::Index>(i)) =
+        positions[result.sourceVertices[i]].transpose().cast<float>();
+  }
+
+  return result;
+}
+
+} // namespace Private_
+} // namespace VolViz
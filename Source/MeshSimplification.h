@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Types.h"
+
+#include <Eigen/Core>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace VolViz {
+namespace Private_ {
+
+/// Result of a mesh simplification
+struct SimplifiedMesh {
+  using Vertices = Eigen::Matrix<float, Eigen::Dynamic, 3>;
+  using Indices = Eigen::Matrix<std::uint32_t, Eigen::Dynamic, 3>;
+
+  Vertices vertices;
+  Indices indices;
+
+  /// For each vertex of the simplified mesh the index of the vertex of the
+  /// source mesh it originates from. Can be used to transfer per vertex
+  /// attributes from the source mesh to the simplified mesh.
+  std::vector<std::uint32_t> sourceVertices;
+};
+
+/// Simplifies a triangle mesh using quadric error metric based edge
+/// collapses (Garland & Heckbert).
+///
+/// @param vertices vertex positions of the source mesh
+/// @param indices triangles of the source mesh
+/// @param targetTriangles the number of triangles the simplified mesh should
+/// have. The result may have more triangles if no further collapse is
+/// possible without flipping triangles.
+/// @param shouldAbort optional predicate that is polled regularly. If it
+/// returns true, the simplification is stopped and an empty mesh is returned.
+/// @note This function does not access any OpenGL resources and is therefore
+/// safe to be called from any thread.
+SimplifiedMesh simplifyMesh(SimplifiedMesh::Vertices const &vertices,
+                            SimplifiedMesh::Indices const &indices,
+                            std::size_t targetTriangles,
+                            std::function<bool()> const &shouldAbort = {});
+
+} // namespace Private_
+} // namespace VolViz
@@ -0,0 +1,226 @@
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <numeric>
+
+namespace VolViz {
+namespace Private_ {
+
+namespace {
+
+/// Number of meshlets culled at once, which keeps the temporary distances in
+/// the cache
+Eigen::Index constexpr kMeshletsPerBlock = 1024;
+
+/// Minimal cosine between the normal cone axis and the triangle normals for
+/// back face culling. Meshlets with a wider cone are never culled.
+float constexpr kMinConeCosine = 0.1f;
+
+using Visibility = Eigen::Array<bool, 1, Eigen::Dynamic>;
+
+/// Computes the visibility of the meshlets in [first, first + count)
+Visibility cullRange(Meshlets const &meshlets, Frustum const &frustum,
+                     Position const &viewerPosition, bool cullBackFaces,
+                     Eigen::Index first, Eigen::Index count) {
+  auto const centers = meshlets.spheres.block(0, first, 3, count);
+  auto const radii = meshlets.spheres.row(3).segment(first, count);
+
+  // signed distance of the spheres to the planes, offset by the radii
+  Eigen::Matrix<float, 6, Eigen::Dynamic> distances =
+      frustum.planes.leftCols<3>() * centers;
+  distances.colwise() += frustum.planes.col(3);
+  distances.rowwise() += radii;
+
+  Visibility visible = (distances.array() >= 0.f).colwise().all();
+
+  if (cullBackFaces) {
+    auto const axes = meshlets.cones.block(0, first, 3, count);
+    auto const cutoffs = meshlets.cones.row(3).segment(first, count).array();
+
+    Eigen::Matrix<float, 3, Eigen::Dynamic> const toCenter =
+        centers.colwise() - viewerPosition;
+    auto const projected =
+        axes.cwiseProduct(toCenter).colwise().sum().array();
+    auto const distance = toCenter.colwise().norm().array();
+
+    visible = visible && (projected < cutoffs * distance + radii.array());
+  }
+
+  return visible;
+}
+
+} // namespace
+
+Meshlets buildMeshlets(SimplifiedMesh::Vertices const &vertices,
+                       SimplifiedMesh::Indices &indices,
+                       std::size_t maxTriangles) {
+  Expects(maxTriangles > 0);
+
+  auto const nVertices = static_cast<std::size_t>(vertices.rows());
+  auto const nTriangles = static_cast<std::size_t>(indices.rows());
+
+  // vertex to triangle adjacency
+  std::vector<std::size_t> offsets(nVertices + 1, 0);
+  for (Eigen::Index i = 0; i < indices.rows(); ++i) {
+    for (Eigen::Index j = 0; j < 3; ++j) {
+      Expects(indices(i, j) < nVertices);
+      ++offsets[indices(i, j) + 1];
+    }
+  }
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  std::vector<std::uint32_t> adjacency(offsets.back());
+  {
+    auto fill = offsets;
+    for (Eigen::Index i = 0; i < indices.rows(); ++i) {
+      for (Eigen::Index j = 0; j < 3; ++j)
+        adjacency[fill[indices(i, j)]++] = static_cast<std::uint32_t>(i);
+    }
+  }
+
+  // Grow each meshlet from the first unassigned triangle by breadth first
+  // search over the triangles that share a vertex
+  auto constexpr kUnassigned = std::numeric_limits<std::uint32_t>::max();
+  std::vector<std::uint32_t> meshletOf(nTriangles, kUnassigned);
+  std::vector<std::uint32_t> sizes;
+  std::deque<std::uint32_t> candidates;
+
+  for (std::size_t seed = 0; seed < nTriangles; ++seed) {
+    if (meshletOf[seed] != kUnassigned) continue;
+
+    auto const meshlet = static_cast<std::uint32_t>(sizes.size());
+    std::uint32_t size = 0;
+    candidates.clear();
+    candidates.push_back(static_cast<std::uint32_t>(seed));
+
+    while (!candidates.empty() && size < maxTriangles) {
+      auto const t = candidates.front();
+      candidates.pop_front();
+      if (meshletOf[t] != kUnassigned) continue;
+
+      meshletOf[t] = meshlet;
+      ++size;
+
+      for (Eigen::Index j = 0; j < 3; ++j) {
+        auto const v = indices(static_cast<Eigen::Index>(t), j);
+        for (auto k = offsets[v]; k < offsets[v + 1]; ++k) {
+          if (meshletOf[adjacency[k]] == kUnassigned)
+            candidates.push_back(adjacency[k]);
+        }
+      }
+    }
+    sizes.push_back(size);
+  }
+
+  auto const nMeshlets = sizes.size();
+  Meshlets meshlets;
+  meshlets.firstTriangle.resize(nMeshlets + 1, 0);
+  std::partial_sum(sizes.begin(), sizes.end(),
+                   meshlets.firstTriangle.begin() + 1);
+
+  // Reorder the triangles by meshlet, keeping their relative order
+  SimplifiedMesh::Indices reordered(indices.rows(), 3);
+  {
+    auto fill = meshlets.firstTriangle;
+    for (std::size_t t = 0; t < nTriangles; ++t) {
+      reordered.row(static_cast<Eigen::Index>(fill[meshletOf[t]]++)) =
+          indices.row(static_cast<Eigen::Index>(t));
+    }
+  }
+  indices = std::move(reordered);
+
+  // Compute bounding spheres and normal cones
+  auto const nCols = static_cast<Eigen::Index>(nMeshlets);
+  meshlets.spheres.resize(4, nCols);
+  meshlets.cones.resize(4, nCols);
+
+  std::vector<Vector3f> normals;
+  for (Eigen::Index m = 0; m < nCols; ++m) {
+    auto const first = static_cast<Eigen::Index>(
+        meshlets.firstTriangle[static_cast<std::size_t>(m)]);
+    auto const last = static_cast<Eigen::Index>(
+        meshlets.firstTriangle[static_cast<std::size_t>(m) + 1]);
+
+    Position min = Position::Constant(std::numeric_limits<float>::max());
+    Position max = Position::Constant(std::numeric_limits<float>::lowest());
+    normals.clear();
+    Vector3f axis = Vector3f::Zero();
+    for (auto i = first; i < last; ++i) {
+      for (Eigen::Index j = 0; j < 3; ++j) {
+        Position const p = vertices.row(indices(i, j));
+        min = min.cwiseMin(p);
+        max = max.cwiseMax(p);
+      }
+      Position const p0 = vertices.row(indices(i, 0));
+      Position const p1 = vertices.row(indices(i, 1));
+      Position const p2 = vertices.row(indices(i, 2));
+      Vector3f const n = (p1 - p0).cross(p2 - p0);
+      auto const length = n.norm();
+      if (length <= 0.f) continue;
+      normals.push_back(n / length);
+      axis += normals.back();
+    }
+
+    Position const center = (min + max) / 2;
+    auto radius = 0.f;
+    for (auto i = first; i < last; ++i) {
+      for (Eigen::Index j = 0; j < 3; ++j) {
+        Position const p = vertices.row(indices(i, j));
+        radius = std::max(radius, (p - center).squaredNorm());
+      }
+    }
+    meshlets.spheres.col(m) << center, std::sqrt(radius);
+
+    // The meshlet is back facing if the angle between the view direction and
+    // the axis is smaller than 90 degrees minus the opening angle of the cone
+    auto cutoff = 2.f;
+    auto const axisLength = axis.norm();
+    if (axisLength > 0.f) {
+      axis /= axisLength;
+      auto minCosine = 1.f;
+      for (auto const &n : normals)
+        minCosine = std::min(minCosine, n.dot(axis));
+      if (minCosine >= kMinConeCosine)
+        cutoff = std::sqrt(1.f - minCosine * minCosine);
+    }
+    meshlets.cones.col(m) << axis, cutoff;
+  }
+
+  return meshlets;
+}
+
+std::vector<Range<std::uint32_t>>
+cullMeshlets(Meshlets const &meshlets, Frustum const &frustum,
+             Position const &viewerPosition, bool cullBackFaces) {
+  auto const nMeshlets = static_cast<Eigen::Index>(meshlets.size());
+
+  // The tests are vectorized over the meshlets, which is fast enough to run
+  // on the render thread, even for the largest meshes
+  Visibility visible(nMeshlets);
+  for (Eigen::Index first = 0; first < nMeshlets; first += kMeshletsPerBlock) {
+    auto const count = std::min(kMeshletsPerBlock, nMeshlets - first);
+    visible.segment(first, count) = cullRange(
+        meshlets, frustum, viewerPosition, cullBackFaces, first, count);
+  }
+
+  // merge adjacent visible meshlets
+  std::vector<Range<std::uint32_t>> ranges;
+  for (Eigen::Index m = 0; m < nMeshlets; ++m) {
+    if (!visible(m)) continue;
+
+    auto const i = static_cast<std::size_t>(m);
+    auto const first = meshlets.firstTriangle[i];
+    auto const last = meshlets.firstTriangle[i + 1];
+    if (!ranges.empty() && ranges.back().max == first)
+      ranges.back().max = last;
+    else
+      ranges.push_back({first, last});
+  }
+
+  return ranges;
+}
+
+} // namespace Private_
+} // namespace VolViz
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Frustum.h"
+#include "MeshSimplification.h"
+#include "Types.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace VolViz {
+namespace Private_ {
+
+/// Small clusters of spatially coherent triangles, stored contiguously in the
+/// index buffer, that can be culled individually.
+///
+/// The bounds are stored as structure of arrays, such that culling can be
+/// vectorized.
+struct Meshlets {
+  /// Bounding sphere of each meshlet: center in the first three rows, radius
+  /// in the last row
+  Eigen::Matrix<float, 4, Eigen::Dynamic> spheres;
+
+  /// Normal cone of each meshlet: axis in the first three rows, cutoff in the
+  /// last row. A cutoff > 1 means the meshlet can never be back facing.
+  Eigen::Matrix<float, 4, Eigen::Dynamic> cones;
+
+  /// Index of the first triangle of each meshlet, has one more element than
+  /// there are meshlets
+  std::vector<std::uint32_t> firstTriangle;
+
+  inline std::size_t size() const noexcept {
+    return static_cast<std::size_t>(spheres.cols());
+  }
+
+  inline bool empty() const noexcept { return size() == 0; }
+};
+
+/// Splits the mesh into meshlets of at most maxTriangles triangles. The
+/// triangles are reordered such that each meshlet is a contiguous range. The
+/// relative order of the triangles within a meshlet is retained, so a vertex
+/// cache optimized order is mostly preserved.
+Meshlets buildMeshlets(SimplifiedMesh::Vertices const &vertices,
+                       SimplifiedMesh::Indices &indices,
+                       std::size_t maxTriangles = 128);
+
+/// Culls the meshlets against the view frustum and, if requested, culls back
+/// facing meshlets using their normal cones. The meshlets are tested in
+/// blocks, vectorized over the meshlets of a block.
+///
+/// @param frustum the view frustum in model space
+/// @param viewerPosition the position of the camera in model space
+/// @param cullBackFaces if set, meshlets are culled by their normal cones
+/// @return the ranges of visible triangles [min, max). Adjacent visible
+/// meshlets are merged into a single range.
+std::vector<Range<std::uint32_t>>
+cullMeshlets(Meshlets const &meshlets, Frustum const &frustum,
+             Position const &viewerPosition, bool cullBackFaces);
+
+} // namespace Private_
+} // namespace VolViz
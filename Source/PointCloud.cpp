@@ -0,0 +1,261 @@
+#include "PointCloud.h"
+#include "Frustum.h"
+#include "Quantization.h"
+#include "VisualizerImpl.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <limits>
+#include <utility>
+
+namespace VolViz {
+namespace Private_ {
+
+namespace {
+
+/// Spreads the lower 21 bits of v, such that there are two zero bits between
+/// each of them
+inline std::uint64_t expandBits(std::uint64_t v) noexcept {
+  v &= 0x1fffff;
+  v = (v | v << 32) & 0x1f00000000ffff;
+  v = (v | v << 16) & 0x1f0000ff0000ff;
+  v = (v | v << 8) & 0x100f00f00f00f00f;
+  v = (v | v << 4) & 0x10c30c30c30c30c3;
+  v = (v | v << 2) & 0x1249249249249249;
+  return v;
+}
+
+inline std::uint64_t
+mortonCode(std::array<std::uint16_t, 3> const &p) noexcept {
+  return expandBits(p[0]) | (expandBits(p[1]) << 1) | (expandBits(p[2]) << 2);
+}
+
+} // namespace
+
+PointCloud::PointCloud(PointCloudDescriptor const &descriptor,
+                       VisualizerImpl &visualizer)
+    : Geometry(descriptor, visualizer) {
+  scale = descriptor.scale;
+  updateQueue_.enqueue(descriptor);
+}
+
+PointCloud::~PointCloud() {
+  // results of running jobs are not needed anymore, queued jobs return right
+  // away
+  ++generation_;
+  for (auto &job : jobs_) job.wait();
+}
+
+void PointCloud::doInit() {
+  GL::Buffer vertexBuffer;
+  GL::VertexArray vao;
+  auto const vaoBinding = binding(vao);
+  vertexBuffer.bind(GL_ARRAY_BUFFER);
+  vao.enableVertexAttribArray(0);
+  vao.enableVertexAttribArray(1);
+  vao.enableVertexAttribArray(2);
+  glVertexAttribPointer(
+      0, 3, GL_UNSIGNED_SHORT, true, sizeof(PackedPoint),
+      reinterpret_cast<void const *>(offsetof(PackedPoint, position)));
+  glVertexAttribPointer(
+      1, 4, GL_UNSIGNED_BYTE, true, sizeof(PackedPoint),
+      reinterpret_cast<void const *>(offsetof(PackedPoint, color)));
+  glVertexAttribIPointer(
+      2, 1, GL_UNSIGNED_INT, sizeof(PackedPoint),
+      reinterpret_cast<void const *>(offsetof(PackedPoint, id)));
+  assertGL("Failed to setup vertex array");
+
+  vertexBuffer_ = std::move(vertexBuffer);
+  vertexArrayObject_ = std::move(vao);
+
+  doUpdate();
+}
+
+void PointCloud::doRender(std::uint32_t, bool) {
+  if (chunks_.empty()) return;
+
+  auto const &cameraClient = visualizer_.cameraClient();
+  Length const rScale = visualizer_.cachedScale;
+
+  auto const projMat = cameraClient.projectionMatrix();
+  auto const destScale = static_cast<float>(scale / rScale);
+  Matrix4 const modelViewProjectionMat =
+      cameraClient.viewProjectionMatrix(rScale) * modelMatrix(rScale);
+
+  // Collect the visible chunks, adjacent chunks are merged
+  auto const frustum = Frustum::fromMatrix(modelViewProjectionMat);
+  drawFirsts_.clear();
+  drawCounts_.clear();
+  for (auto const &chunk : chunks_) {
+    if (!frustum.intersectsBox(chunk.min, chunk.max)) continue;
+
+    if (!drawFirsts_.empty() &&
+        drawFirsts_.back() + drawCounts_.back() == chunk.first) {
+      drawCounts_.back() += chunk.count;
+    } else {
+      drawFirsts_.push_back(chunk.first);
+      drawCounts_.push_back(chunk.count);
+    }
+  }
+  if (drawFirsts_.empty()) return;
+
+  // Projected diameter of a point in pixels, times its clip space w
+  auto const pointSizeScale =
+      radius_ * destScale * projMat(1, 1) * visualizer_.renderSize()(1);
+
+  auto &shaders = visualizer_.shaders();
+  shaders[Program::PointCloud].use();
+  shaders[Program::PointCloud]["positionOffset"] = positionOffset_;
+  shaders[Program::PointCloud]["positionScale"] = positionScale_;
+  shaders[Program::PointCloud]["pointSizeScale"] = pointSizeScale;
+  assertGL("Setting uniforms failed");
+
+  auto const vaoBinding = GL::binding(vertexArrayObject_);
+  glEnable(GL_PROGRAM_POINT_SIZE);
+  glMultiDrawArrays(GL_POINTS, drawFirsts_.data(), drawCounts_.data(),
+                    static_cast<GLsizei>(drawFirsts_.size()));
+  assertGL("glMultiDrawArrays failed");
+  glDisable(GL_PROGRAM_POINT_SIZE);
+}
+
+void PointCloud::doUpdate() {
+  // Only the most recent update matters
+  PointCloudDescriptor descriptor;
+  bool updated = false;
+  while (updateQueue_.try_dequeue(descriptor)) updated = true;
+
+  if (updated) {
+    scale = descriptor.scale;
+    color = descriptor.color;
+    preparePoints(std::move(descriptor));
+  }
+
+  uploadPoints();
+
+  // forget about finished jobs
+  using namespace std::chrono_literals;
+  jobs_.erase(std::remove_if(jobs_.begin(), jobs_.end(),
+                             [](auto const &job) {
+                               return job.wait_for(0s) ==
+                                      std::future_status::ready;
+                             }),
+              jobs_.end());
+}
+
+void PointCloud::preparePoints(PointCloudDescriptor &&descriptor) {
+  Expects(descriptor.pointsPerChunk > 0);
+  Expects(descriptor.colors.rows() == 0 ||
+          descriptor.colors.rows() == descriptor.positions.rows());
+  Expects(static_cast<std::size_t>(descriptor.positions.rows()) <=
+          std::numeric_limits<GLint>::max());
+
+  auto job = [ this, generation = ++generation_,
+               d = std::move(descriptor) ]() {
+    if (generation_ != generation) return;
+    auto const n = static_cast<std::size_t>(d.positions.rows());
+
+    PreparedPoints prepared;
+    prepared.generation = generation;
+    prepared.radius = d.radius;
+    auto const box = QuantizationBox::of(d.positions);
+    prepared.positionOffset = box.offset;
+    prepared.positionScale = box.scale;
+
+    // Quantize the positions and sort the points by their Morton code
+    std::vector<std::array<std::uint16_t, 3>> quantized(n);
+    std::vector<std::pair<std::uint64_t, std::uint32_t>> order(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      auto const row = static_cast<Eigen::Index>(i);
+      quantized[i] = box.toUnorm16(d.positions.row(row).transpose());
+      order[i] = {mortonCode(quantized[i]), static_cast<std::uint32_t>(i)};
+    }
+    std::sort(order.begin(), order.end());
+    if (generation_ != generation) return;
+
+    // Pack the points and split them into chunks
+    prepared.points.resize(n);
+    for (std::size_t first = 0; first < n; first += d.pointsPerChunk) {
+      auto const last = std::min(n, first + d.pointsPerChunk);
+
+      Chunk chunk;
+      chunk.min = Position::Constant(std::numeric_limits<float>::max());
+      chunk.max = Position::Constant(std::numeric_limits<float>::lowest());
+      chunk.first = static_cast<GLint>(first);
+      chunk.count = static_cast<GLsizei>(last - first);
+
+      for (auto i = first; i < last; ++i) {
+        auto const id = order[i].second;
+        auto const row = static_cast<Eigen::Index>(id);
+        Position const p = d.positions.row(row).transpose();
+        chunk.min = chunk.min.cwiseMin(p);
+        chunk.max = chunk.max.cwiseMax(p);
+
+        Color const c = d.colors.rows() > 0
+                            ? Color(d.colors.row(row).transpose())
+                            : d.color;
+        auto &point = prepared.points[i];
+        point.position = quantized[id];
+        point.padding = 0;
+        point.color = {{toUnorm8(c(0)), toUnorm8(c(1)), toUnorm8(c(2)), 255}};
+        point.id = id;
+      }
+      prepared.chunks.push_back(chunk);
+    }
+
+    preparedQueue_.enqueue(std::move(prepared));
+    visualizer_.markSceneChanged();
+  };
+
+  jobs_.push_back(WorkerPool::shared().submit(std::move(job)));
+}
+
+void PointCloud::uploadPoints() {
+  PreparedPoints prepared;
+  bool found = false;
+  while (preparedQueue_.try_dequeue(prepared)) {
+    if (prepared.generation == generation_) {
+      found = true;
+      break;
+    }
+  }
+  if (!found) return;
+
+  auto const vertexBinding =
+      GL::binding(vertexBuffer_, static_cast<GLenum>(GL_ARRAY_BUFFER));
+  glBufferData(GL_ARRAY_BUFFER,
+               static_cast<GLsizeiptr>(prepared.points.size() *
+                                       sizeof(PackedPoint)),
+               prepared.points.data(), GL_STATIC_DRAW);
+  assertGL("glBufferData failed");
+
+  chunks_ = std::move(prepared.chunks);
+  positionOffset_ = prepared.positionOffset;
+  positionScale_ = prepared.positionScale;
+  radius_ = prepared.radius;
+
+  Box bounds;
+  for (auto const &chunk : chunks_) {
+    bounds.extend(chunk.min - Position::Constant(radius_));
+    bounds.extend(chunk.max + Position::Constant(radius_));
+  }
+  setModelBounds(bounds);
+}
+
+void PointCloud::doEnqueueUpdate(GeometryDescriptor const &descriptor) {
+  updateQueue_.enqueue(dynamic_cast<PointCloudDescriptor const &>(descriptor));
+}
+
+void PointCloud::doEnqueueUpdate(GeometryDescriptor &&descriptor) {
+  updateQueue_.enqueue(
+      std::move(dynamic_cast<PointCloudDescriptor &&>(descriptor)));
+}
+
+Geometry::RenderState PointCloud::doRenderState() const {
+  return {visualizer_.shaders()[Program::PointCloud].id(),
+          vertexArrayObject_.name};
+}
+
+} // namespace Private_
+} // namespace VolViz
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "GL/Buffer.h"
+#include "GL/VertexArray.h"
+#include "Geometry.h"
+#include "Types.h"
+
+#include <concurrentqueue.h>
+
+#include <array>
+#include <atomic>
+#include <future>
+#include <vector>
+
+namespace VolViz {
+namespace Private_ {
+
+/// A large set of points, rendered as sphere impostors into the G-buffer.
+///
+/// The points are sorted in Morton order by a background job and split into
+/// chunks of spatially close points. Each chunk is culled against the view
+/// frustum, the visible chunks are drawn with a single glMultiDrawArrays call.
+class PointCloud : public Geometry {
+public:
+  PointCloud(PointCloudDescriptor const &descriptor,
+             VisualizerImpl &visualizer);
+
+  virtual ~PointCloud();
+
+protected:
+  virtual void doInit() override;
+
+  virtual void doRender(std::uint32_t index, bool selected) override;
+
+  virtual void doUpdate() override;
+
+  virtual void doEnqueueUpdate(GeometryDescriptor const &descriptor) override;
+  virtual void doEnqueueUpdate(GeometryDescriptor &&descriptor) override;
+
+  virtual RenderState doRenderState() const override;
+
+private:
+  using UpdateQueue = moodycamel::ConcurrentQueue<PointCloudDescriptor>;
+
+  /// Compact vertex format: position quantized to 16 bit relative to the
+  /// bounding box, RGBA8 color and the index of the point in the descriptor
+  struct PackedPoint {
+    std::array<std::uint16_t, 3> position;
+    std::uint16_t padding;
+    std::array<std::uint8_t, 4> color;
+    std::uint32_t id;
+  };
+  static_assert(sizeof(PackedPoint) == 16, "Unexpected packed point size");
+
+  /// A range of points with its bounding box in model coordinates
+  struct Chunk {
+    Position min, max;
+    GLint first;
+    GLsizei count;
+  };
+
+  /// Sorted and packed points, generated by a background job
+  struct PreparedPoints {
+    std::uint32_t generation;
+    std::vector<PackedPoint> points;
+    std::vector<Chunk> chunks;
+    Position positionOffset, positionScale;
+    Scale radius;
+  };
+  using PreparedQueue = moodycamel::ConcurrentQueue<PreparedPoints>;
+
+  /// Starts a background job that sorts and packs the points
+  void preparePoints(PointCloudDescriptor &&descriptor);
+
+  /// Uploads the most recent prepared points
+  void uploadPoints();
+
+  UpdateQueue updateQueue_;
+  PreparedQueue preparedQueue_;
+
+  GL::Buffer vertexBuffer_{0};
+  GL::VertexArray vertexArrayObject_{0};
+
+  std::vector<Chunk> chunks_;
+  Position positionOffset_{Position::Zero()};
+  Position positionScale_{Position::Ones()};
+  Scale radius_{0.5f};
+
+  /// Draw ranges of the visible chunks, reused every frame
+  std::vector<GLint> drawFirsts_;
+  std::vector<GLsizei> drawCounts_;
+
+  /// Incremented on every update, used to discard outdated results
+  std::atomic<std::uint32_t> generation_{0};
+
+  /// Queued and running background jobs, the destructor waits for them
+  std::vector<std::future<void>> jobs_;
+};
+
+} // namespace Private_
+} // namespace VolViz
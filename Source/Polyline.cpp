@@ -0,0 +1,190 @@
+#include "Polyline.h"
+#include "VisualizerImpl.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace VolViz {
+namespace Private_ {
+
+constexpr std::uint32_t Polyline::kRestartIndex;
+
+Polyline::Polyline(PolylineDescriptor const &descriptor,
+                   VisualizerImpl &visualizer)
+    : Geometry(descriptor, visualizer) {
+  scale = descriptor.scale;
+  updateQueue_.enqueue(descriptor);
+}
+
+void Polyline::doInit() {
+  vertexBuffer_ = GL::Buffer();
+  indexBuffer_ = GL::Buffer();
+  vertexArrayObject_ = GL::VertexArray();
+  setupVertexArray();
+
+  doUpdate();
+}
+
+void Polyline::setupVertexArray() {
+  auto &vao = vertexArrayObject_;
+  auto const vaoBinding = binding(vao);
+  indexBuffer_.bind(GL_ELEMENT_ARRAY_BUFFER);
+
+  vertexBuffer_.bind(GL_ARRAY_BUFFER);
+  vao.enableVertexAttribArray(0);
+  vao.enableVertexAttribArray(1);
+  vao.enableVertexAttribArray(2);
+  glVertexAttribPointer(
+      0, 3, GL_FLOAT, false, sizeof(LineVertex),
+      reinterpret_cast<void const *>(offsetof(LineVertex, position)));
+  glVertexAttribPointer(
+      1, 1, GL_FLOAT, false, sizeof(LineVertex),
+      reinterpret_cast<void const *>(offsetof(LineVertex, scalar)));
+  glVertexAttribIPointer(
+      2, 1, GL_UNSIGNED_INT, sizeof(LineVertex),
+      reinterpret_cast<void const *>(offsetof(LineVertex, line)));
+  assertGL("Failed to setup vertex array");
+}
+
+void Polyline::doRender(std::uint32_t, bool) {
+  if (nIndices_ == 0) return;
+
+  auto &shaders = visualizer_.shaders();
+  shaders[Program::Polyline].use();
+  shaders[Program::Polyline]["lineWidth"] = width_;
+  shaders[Program::Polyline]["useScalars"] = static_cast<GLint>(useScalars_);
+  shaders[Program::Polyline]["scalarRange"] =
+      Eigen::Vector2f(scalarRange_.min, scalarRange_.max);
+  shaders[Program::Polyline]["minColor"] = minColor_;
+  shaders[Program::Polyline]["maxColor"] = maxColor_;
+  assertGL("Setting uniforms failed");
+
+  auto const vaoBinding = GL::binding(vertexArrayObject_);
+  glEnable(GL_PRIMITIVE_RESTART);
+  glPrimitiveRestartIndex(kRestartIndex);
+  glDrawElements(GL_LINE_STRIP, static_cast<GLsizei>(nIndices_),
+                 GL_UNSIGNED_INT, nullptr);
+  assertGL("glDrawElements failed");
+  glDisable(GL_PRIMITIVE_RESTART);
+}
+
+void Polyline::doUpdate() {
+  // Appended lines build on each other, so all updates are applied
+  PolylineDescriptor descriptor;
+  while (updateQueue_.try_dequeue(descriptor)) uploadLines(descriptor);
+}
+
+bool Polyline::reserve(GL::Buffer &buffer, std::size_t &capacity,
+                       std::size_t used, std::size_t required) {
+  if (required <= capacity) return false;
+
+  auto const newCapacity = std::max(required, 2 * capacity);
+  buffer = GL::resized(buffer, used, newCapacity, GL_DYNAMIC_DRAW);
+  capacity = newCapacity;
+  return true;
+}
+
+void Polyline::uploadLines(PolylineDescriptor const &descriptor) {
+  auto const n = static_cast<std::size_t>(descriptor.vertices.rows());
+  auto const hasScalars = descriptor.scalars.rows() > 0;
+  Expects(std::accumulate(descriptor.lineLengths.begin(),
+                          descriptor.lineLengths.end(), std::size_t{0}) == n);
+  Expects(!hasScalars ||
+          static_cast<std::size_t>(descriptor.scalars.rows()) == n);
+
+  bool const append = descriptor.append && nIndices_ > 0;
+  if (!append) {
+    scale = descriptor.scale;
+    color = descriptor.color;
+    useScalars_ = hasScalars;
+    scalarRange_ = descriptor.scalarRange;
+    minColor_ = descriptor.minColor;
+    maxColor_ = descriptor.maxColor;
+    width_ = descriptor.width;
+    nVertices_ = nIndices_ = nLines_ = 0;
+  }
+  Expects(!useScalars_ || hasScalars);
+
+  auto const firstVertex = nVertices_;
+  auto const nLines = descriptor.lineLengths.size();
+  Expects(firstVertex + n < kRestartIndex);
+
+  // Each line is terminated by the restart index
+  std::vector<LineVertex> vertices(n);
+  std::vector<std::uint32_t> indices;
+  indices.reserve(n + nLines);
+  Box bounds = append ? modelBounds() : Box();
+  std::size_t v = 0;
+  for (std::size_t l = 0; l < nLines; ++l) {
+    auto const lineIndex = static_cast<std::uint32_t>(nLines_ + l);
+    for (std::uint32_t i = 0; i < descriptor.lineLengths[l]; ++i, ++v) {
+      auto const row = static_cast<Eigen::Index>(v);
+      vertices[v].position = {{descriptor.vertices(row, 0),
+                               descriptor.vertices(row, 1),
+                               descriptor.vertices(row, 2)}};
+      bounds.extend(descriptor.vertices.row(row).transpose());
+      vertices[v].scalar = hasScalars ? descriptor.scalars(row) : 0.f;
+      vertices[v].line = lineIndex;
+      indices.push_back(static_cast<std::uint32_t>(firstVertex + v));
+    }
+    indices.push_back(kRestartIndex);
+  }
+
+  auto const vertexBytes = sizeof(LineVertex);
+  auto const indexBytes = sizeof(std::uint32_t);
+  auto const grownVertices =
+      reserve(vertexBuffer_, vertexCapacity_, nVertices_ * vertexBytes,
+              (nVertices_ + n) * vertexBytes);
+  auto const grownIndices =
+      reserve(indexBuffer_, indexCapacity_, nIndices_ * indexBytes,
+              (nIndices_ + indices.size()) * indexBytes);
+  if (grownVertices || grownIndices) setupVertexArray();
+
+  if (!vertices.empty()) {
+    auto const vertexBinding =
+        GL::binding(vertexBuffer_, static_cast<GLenum>(GL_ARRAY_BUFFER));
+    glBufferSubData(GL_ARRAY_BUFFER,
+                    static_cast<GLintptr>(nVertices_ * vertexBytes),
+                    static_cast<GLsizeiptr>(n * vertexBytes), vertices.data());
+    assertGL("glBufferSubData failed");
+  }
+  if (!indices.empty()) {
+    // The element array binding is part of the vertex array state
+    auto const vaoBinding = GL::binding(vertexArrayObject_);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER,
+                    static_cast<GLintptr>(nIndices_ * indexBytes),
+                    static_cast<GLsizeiptr>(indices.size() * indexBytes),
+                    indices.data());
+    assertGL("glBufferSubData failed");
+  }
+
+  nVertices_ += n;
+  nIndices_ += indices.size();
+  nLines_ += nLines;
+  setModelBounds(bounds);
+}
+
+void Polyline::doEnqueueUpdate(GeometryDescriptor const &descriptor) {
+  updateQueue_.enqueue(dynamic_cast<PolylineDescriptor const &>(descriptor));
+}
+
+void Polyline::doEnqueueUpdate(GeometryDescriptor &&descriptor) {
+  updateQueue_.enqueue(
+      std::move(dynamic_cast<PolylineDescriptor &&>(descriptor)));
+}
+
+Geometry::Material Polyline::doMaterial(bool) const {
+  // only the selected line is highlighted, by the fragment shader
+  return {color, 10.f};
+}
+
+Geometry::RenderState Polyline::doRenderState() const {
+  return {visualizer_.shaders()[Program::Polyline].id(),
+          vertexArrayObject_.name};
+}
+
+} // namespace Private_
+} // namespace VolViz
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "GL/Buffer.h"
+#include "GL/VertexArray.h"
+#include "Geometry.h"
+#include "Types.h"
+
+#include <concurrentqueue.h>
+
+#include <array>
+
+namespace VolViz {
+namespace Private_ {
+
+/// Many polylines stored in a single vertex and index buffer. The lines are
+/// drawn as one GL_LINE_STRIP with primitive restart, a geometry shader
+/// expands each segment to a quad of constant width on screen.
+///
+/// Appended lines are written behind the existing ones, the buffers grow by
+/// doubling their capacity, so streaming many small batches stays cheap.
+class Polyline : public Geometry {
+public:
+  Polyline(PolylineDescriptor const &descriptor, VisualizerImpl &visualizer);
+
+protected:
+  virtual void doInit() override;
+
+  virtual void doRender(std::uint32_t index, bool selected) override;
+
+  virtual void doUpdate() override;
+
+  virtual void doEnqueueUpdate(GeometryDescriptor const &descriptor) override;
+  virtual void doEnqueueUpdate(GeometryDescriptor &&descriptor) override;
+
+  virtual RenderState doRenderState() const override;
+
+  virtual Material doMaterial(bool selected) const override;
+
+private:
+  using UpdateQueue = moodycamel::ConcurrentQueue<PolylineDescriptor>;
+
+  /// Vertex format: position, scalar and the index of the line
+  struct LineVertex {
+    std::array<float, 3> position;
+    float scalar;
+    std::uint32_t line;
+  };
+  static_assert(sizeof(LineVertex) == 20, "Unexpected line vertex size");
+
+  /// Separates the lines within the index buffer
+  static constexpr std::uint32_t kRestartIndex = 0xffffffff;
+
+  /// Uploads the lines of the descriptor, either replacing all lines or
+  /// appending them
+  void uploadLines(PolylineDescriptor const &descriptor);
+
+  /// Makes sure the buffer can hold at least required bytes, keeping the
+  /// first used bytes. Returns true, if the buffer was reallocated.
+  static bool reserve(GL::Buffer &buffer, std::size_t &capacity,
+                      std::size_t used, std::size_t required);
+
+  /// Binds the buffers to the vertex array object
+  void setupVertexArray();
+
+  UpdateQueue updateQueue_;
+
+  GL::Buffer vertexBuffer_{0};
+  GL::Buffer indexBuffer_{0};
+  GL::VertexArray vertexArrayObject_{0};
+
+  /// Capacity of the buffers in bytes
+  std::size_t vertexCapacity_{0};
+  std::size_t indexCapacity_{0};
+
+  std::size_t nVertices_{0};
+  std::size_t nIndices_{0};
+  std::size_t nLines_{0};
+
+  bool useScalars_{false};
+  Range<float> scalarRange_{0.f, 1.f};
+  Color minColor_{Colors::Blue()};
+  Color maxColor_{Colors::Red()};
+  float width_{2.f};
+};
+
+} // namespace Private_
+} // namespace VolViz
@@ -0,0 +1,73 @@
+#include "QualityController.h"
+
+namespace VolViz {
+namespace Private_ {
+
+namespace {
+
+/// Element of the Halton sequence with the given base, in [0, 1)
+float halton(std::size_t index, std::size_t base) noexcept {
+  float result = 0.f;
+  float fraction = 1.f;
+  while (index > 0) {
+    fraction /= static_cast<float>(base);
+    result += fraction * static_cast<float>(index % base);
+    index /= base;
+  }
+  return result;
+}
+
+} // namespace
+
+constexpr std::size_t QualityController::kSamples;
+constexpr std::array<QualityController::Level, 3> QualityController::kLevels;
+
+void QualityController::beginFrame(bool enabled, bool changed,
+                                   bool interacting,
+                                   Clock::time_point now) noexcept {
+  enabled_ = enabled;
+  if (!enabled_) {
+    level_ = kLevels.size() - 1;
+    sample_ = 0;
+    return;
+  }
+
+  if (interacting) {
+    lastInteraction_ = now;
+    level_ = 0;
+    sample_ = 0;
+  } else if (changed) {
+    // Other changes keep the level, but invalidate the accumulated image
+    sample_ = 0;
+  } else if (level_ + 1 < kLevels.size()) {
+    ++level_;
+  } else if (sample_ + 1 < kSamples) {
+    ++sample_;
+  }
+}
+
+bool QualityController::refining() const noexcept {
+  return enabled_ && (level_ + 1 < kLevels.size() || sample_ + 1 < kSamples);
+}
+
+float QualityController::resolutionScale() const noexcept {
+  return kLevels[level_].resolutionScale;
+}
+
+std::size_t QualityController::levelOfDetailBias() const noexcept {
+  return kLevels[level_].levelOfDetailBias;
+}
+
+bool QualityController::accumulates() const noexcept {
+  return enabled_ && level_ + 1 == kLevels.size();
+}
+
+Eigen::Vector2f QualityController::sampleOffset() const noexcept {
+  // The first sample is at the pixel centers, like frames that are not
+  // accumulated
+  if (sample_ == 0) return Eigen::Vector2f::Zero();
+  return Eigen::Vector2f(halton(sample_, 2) - 0.5f, halton(sample_, 3) - 0.5f);
+}
+
+} // namespace Private_
+} // namespace VolViz
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <Eigen/Core>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+namespace VolViz {
+namespace Private_ {
+
+/// Lowers the render quality while the user moves the camera or a geometry
+/// and refines it progressively once the interaction stopped.
+///
+/// While interacting, frames are rendered at the lowest quality level, i.e.
+/// at a lower resolution and with coarser meshes. Once there was no
+/// interaction for the refinement delay, each frame raises the level until
+/// the full quality is reached. At full quality, frames with sub pixel
+/// offsets are accumulated, which smoothes the edges.
+class QualityController {
+public:
+  using Clock = std::chrono::steady_clock;
+  using Duration = std::chrono::duration<double>;
+
+  /// Number of frames accumulated at full quality
+  static constexpr std::size_t kSamples = 8;
+
+  /// Starts a rendered frame
+  /// @param enabled if false, frames are always rendered at full quality
+  /// without accumulation
+  /// @param changed whether the scene changed since the last frame, otherwise
+  /// the frame refines the quality
+  /// @param interacting whether the change was caused by an interaction
+  void beginFrame(bool enabled, bool changed, bool interacting,
+                  Clock::time_point now) noexcept;
+
+  /// Starts the accumulation over, e.g. since the render size changed
+  inline void restartAccumulation() noexcept { sample_ = 0; }
+
+  /// Returns true if further frames would refine the quality
+  bool refining() const noexcept;
+
+  /// Returns the time the next refining frame is due
+  inline Clock::time_point refinementTime(Duration delay) const noexcept {
+    return lastInteraction_ +
+           std::chrono::duration_cast<Clock::duration>(delay);
+  }
+
+  /// Scale of the render resolution relative to the window size
+  float resolutionScale() const noexcept;
+
+  /// Number of levels of detail meshes are rendered coarser
+  std::size_t levelOfDetailBias() const noexcept;
+
+  /// Returns true if the frame is accumulated with the previous frames
+  bool accumulates() const noexcept;
+
+  /// Index of the accumulated frame, 0 replaces the accumulated image
+  inline std::size_t sample() const noexcept { return sample_; }
+
+  /// Offset of the frame's samples from the pixel centers, in pixels
+  Eigen::Vector2f sampleOffset() const noexcept;
+
+private:
+  /// Quality levels from the lowest to the full quality
+  struct Level {
+    float resolutionScale;
+    std::size_t levelOfDetailBias;
+  };
+  static constexpr std::array<Level, 3> kLevels{
+      {{0.5f, 2}, {0.75f, 1}, {1.f, 0}}};
+
+  bool enabled_{true};
+  std::size_t level_{kLevels.size() - 1};
+  std::size_t sample_{0};
+  Clock::time_point lastInteraction_{};
+};
+
+} // namespace Private_
+} // namespace VolViz
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Types.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+namespace VolViz {
+namespace Private_ {
+
+/// Converts a value in [0, 1] to an 8 bit normalized integer
+inline std::uint8_t toUnorm8(float x) noexcept {
+  return static_cast<std::uint8_t>(std::min(std::max(x, 0.f), 1.f) * 255.f +
+                                   0.5f);
+}
+
+/// Dequantization parameters of positions that are quantized relative to
+/// their bounding box, i.e. position = offset + scale * quantizedPosition
+struct QuantizationBox {
+  Position offset{Position::Zero()};
+  Position scale{Position::Ones()};
+
+  /// Returns the bounding box of the positions, one per row
+  template <class Derived>
+  static QuantizationBox of(Eigen::MatrixBase<Derived> const &positions) {
+    QuantizationBox box;
+    if (positions.rows() == 0) return box;
+
+    box.offset = positions.colwise().minCoeff().transpose();
+    box.scale = positions.colwise().maxCoeff().transpose() - box.offset;
+    // prevent division by zero for flat geometry
+    box.scale = (box.scale.array() > 0.f).select(box.scale, Position::Ones());
+    return box;
+  }
+
+  /// Quantizes a position inside the box to 16 bit normalized integers
+  inline std::array<std::uint16_t, 3>
+  toUnorm16(Position const &p) const noexcept {
+    auto constexpr kMaxUnsigned = 65535.f;
+    Position const q = ((p - offset).cwiseQuotient(scale) * kMaxUnsigned)
+                           .array()
+                           .round()
+                           .max(0.f)
+                           .min(kMaxUnsigned);
+    return {{static_cast<std::uint16_t>(q(0)),
+             static_cast<std::uint16_t>(q(1)),
+             static_cast<std::uint16_t>(q(2))}};
+  }
+};
+
+/// Converts a vector in [-1, 1]^2 to 16 bit signed normalized integers
+inline std::array<std::int16_t, 2>
+toSnorm16(Eigen::Vector2f const &x) noexcept {
+  auto constexpr kMaxSigned = 32767.f;
+  Eigen::Vector2f const q =
+      (x * kMaxSigned).array().round().max(-kMaxSigned).min(kMaxSigned);
+  return {{static_cast<std::int16_t>(q(0)), static_cast<std::int16_t>(q(1))}};
+}
+
+} // namespace Private_
+} // namespace VolViz
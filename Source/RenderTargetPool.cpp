@@ -0,0 +1,44 @@
+#include "RenderTargetPool.h"
+
+#include <cmath>
+
+namespace VolViz {
+namespace Private_ {
+
+namespace {
+
+/// The targets are reallocated to release memory, once they are larger than
+/// this factor times the area needed
+constexpr float kMaxAreaRatio = 2.f;
+
+} // namespace
+
+constexpr float RenderTargetPool::kStep;
+constexpr RenderTargetPool::Clock::duration RenderTargetPool::kDebounceTime;
+
+void RenderTargetPool::resize(Size const &size,
+                              Clock::time_point now) noexcept {
+  Size const newSize = size.cwiseMax(1.f);
+  if (newSize == size_) return;
+  size_ = newSize;
+  lastResize_ = now;
+}
+
+bool RenderTargetPool::needsAllocation(Clock::time_point now) const noexcept {
+  if (allocatedSize_.isZero()) return true;
+  return pending() && now >= settleTime();
+}
+
+RenderTargetPool::Size RenderTargetPool::capacity() const noexcept {
+  return (size_ / kStep).array().ceil() * kStep;
+}
+
+bool RenderTargetPool::pending() const noexcept {
+  if (allocatedSize_.isZero()) return false;
+  bool const fits = (allocatedSize_.array() >= size_.array()).all();
+  auto const area = capacity().prod();
+  return !fits || allocatedSize_.prod() > kMaxAreaRatio * area;
+}
+
+} // namespace Private_
+} // namespace VolViz
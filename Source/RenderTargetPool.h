@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Eigen/Core>
+
+#include <chrono>
+
+namespace VolViz {
+namespace Private_ {
+
+/// Decides the size the render targets are allocated with.
+///
+/// The targets are over-allocated in steps, so that they are kept while the
+/// window grows by a few pixels. They are also kept when the window shrinks,
+/// the scene is then rendered to a part of them, which is selected with the
+/// viewport and the scissor rectangle. While the window is resized, the
+/// targets are only reallocated once the size did not change for the
+/// debounce time. Meanwhile, larger windows are rendered at the resolution
+/// of the allocated targets and upscaled.
+class RenderTargetPool {
+public:
+  using Clock = std::chrono::steady_clock;
+  using Size = Eigen::Vector2f;
+
+  /// The allocated width and height are multiples of this step in pixels
+  static constexpr float kStep = 128.f;
+
+  /// Time the size has to stay unchanged before the targets are reallocated
+  static constexpr Clock::duration kDebounceTime =
+      std::chrono::milliseconds(150);
+
+  /// Sets the size the render targets are needed with
+  void resize(Size const &size, Clock::time_point now) noexcept;
+
+  /// Returns true if the targets have to be allocated with capacity(). The
+  /// first allocation is immediate, reallocations wait for the size to
+  /// settle.
+  bool needsAllocation(Clock::time_point now) const noexcept;
+
+  /// Marks the targets as allocated with capacity()
+  inline void allocated() noexcept { allocatedSize_ = capacity(); }
+
+  /// Size to allocate the targets with for the current size
+  Size capacity() const noexcept;
+
+  /// Size the targets are currently allocated with
+  inline Size const &allocatedSize() const noexcept { return allocatedSize_; }
+
+  /// Returns true if the targets are to be reallocated once the size settled
+  bool pending() const noexcept;
+
+  /// Time the deferred reallocation is due
+  inline Clock::time_point settleTime() const noexcept {
+    return lastResize_ + kDebounceTime;
+  }
+
+private:
+  Size size_{Size::Ones()};
+  Size allocatedSize_{Size::Zero()};
+  Clock::time_point lastResize_{};
+};
+
+} // namespace Private_
+} // namespace VolViz
@@ -0,0 +1,58 @@
+#include "ResolutionController.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace VolViz {
+namespace Private_ {
+
+namespace {
+
+/// Weight of the latest frame in the smoothed GPU time
+constexpr double kSmoothingWeight = 0.25;
+
+/// The scale is increased only if the GPU time is below this fraction of
+/// the target, which keeps it from oscillating around the target
+constexpr double kHeadroom = 0.85;
+
+/// Fraction of the distance to the estimated scale covered per update
+constexpr float kApproachRate = 0.5f;
+
+/// The scale is a multiple of this step, small changes are not worth
+/// rendering another frame
+constexpr float kScaleStep = 1.f / 32.f;
+
+} // namespace
+
+constexpr float ResolutionController::kMinScale;
+
+bool ResolutionController::update(Duration gpuFrameTime,
+                                  Duration targetFrameTime) noexcept {
+  auto const previousScale = scale_;
+
+  if (targetFrameTime.count() <= 0.0 || gpuFrameTime.count() <= 0.0) {
+    scale_ = 1.f;
+    gpuFrameTime_ = gpuFrameTime;
+    return scale_ != previousScale;
+  }
+
+  if (gpuFrameTime_.count() <= 0.0)
+    gpuFrameTime_ = gpuFrameTime;
+  else
+    gpuFrameTime_ += kSmoothingWeight * (gpuFrameTime - gpuFrameTime_);
+
+  auto const ratio = targetFrameTime / gpuFrameTime_;
+  if (ratio >= 1.0 && ratio * kHeadroom <= 1.0) return false;
+
+  auto const estimate = static_cast<float>(
+      scale_ * std::sqrt(ratio >= 1.0 ? ratio * kHeadroom : ratio));
+  auto scale = scale_ + kApproachRate * (estimate - scale_);
+  scale = std::round(scale / kScaleStep) * kScaleStep;
+  // a frame over the target always lowers the scale
+  if (ratio < 1.0 && scale >= scale_) scale = scale_ - kScaleStep;
+  scale_ = std::min(1.f, std::max(kMinScale, scale));
+  return scale_ != previousScale;
+}
+
+} // namespace Private_
+} // namespace VolViz
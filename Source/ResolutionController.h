@@ -0,0 +1,39 @@
+#pragma once
+
+#include <chrono>
+
+namespace VolViz {
+namespace Private_ {
+
+/// Adjusts the scale of the render resolution, such that the GPU time of a
+/// frame stays below a target frame time.
+///
+/// The GPU time is roughly proportional to the number of rendered pixels,
+/// i.e. to the square of the scale. The measured times lag a few frames
+/// behind, so the scale only approaches the estimated scale gradually and
+/// is kept while the time is slightly below the target.
+class ResolutionController {
+public:
+  using Duration = std::chrono::duration<double>;
+
+  /// Smallest scale of the render resolution
+  static constexpr float kMinScale = 0.5f;
+
+  /// Updates the scale with the GPU time of a frame
+  /// @param targetFrameTime a non positive time disables the scaling
+  /// @return true if the scale changed
+  bool update(Duration gpuFrameTime, Duration targetFrameTime) noexcept;
+
+  /// Scale of the render resolution relative to the window size
+  inline float scale() const noexcept { return scale_; }
+
+  /// Smoothed GPU time of the frames
+  inline Duration gpuFrameTime() const noexcept { return gpuFrameTime_; }
+
+private:
+  float scale_{1.f};
+  Duration gpuFrameTime_{0};
+};
+
+} // namespace Private_
+} // namespace VolViz
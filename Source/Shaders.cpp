@@ -1,22 +1,30 @@
 #include "Shaders.h"
 #include "GL/Shaders.h"
+#include "UniformBlocks.h"
 
 namespace VolViz {
 namespace Private_ {
 
-GL::ShaderProgram &Shaders::operator[](std::string name) {
-  auto search = shaders_.find(name);
-  Expects(search != shaders_.end());
+GL::ShaderProgram &Shaders::operator[](std::string const &name) {
+  auto search = names_.find(name);
+  Expects(search != names_.end());
 
-  return search->second;
+  return (*this)[search->second];
+}
+
+void Shaders::add(Program program, std::string name,
+                  GL::ShaderProgram &&shader) {
+  Expects(static_cast<std::size_t>(program) == programs_.size());
+  programs_.push_back(std::move(shader));
+  names_.emplace(std::move(name), program);
 }
 
 void Shaders::init() {
-  Expects(shaders_.empty());
+  Expects(programs_.empty());
+  programs_.reserve(static_cast<std::size_t>(Program::Count));
 
   // Quad shader
-  shaders_.emplace(
-      "quad",
+  add(Program::Quad, "quad",
       std::move(
           GL::ShaderProgram()
               .attachShader(
@@ -28,8 +36,7 @@ void Shaders::init() {
               .link()));
 
   // HDR quad shader
-  shaders_.emplace(
-      "hdrQuad",
+  add(Program::HdrQuad, "hdrQuad",
       std::move(
           GL::ShaderProgram()
               .attachShader(
@@ -41,8 +48,7 @@ void Shaders::init() {
               .link()));
 
   // Normal quad shader
-  shaders_.emplace(
-      "normalQuad",
+  add(Program::NormalQuad, "normalQuad",
       std::move(GL::ShaderProgram()
                     .attachShader(GL::Shader(GL_VERTEX_SHADER,
                                              GL::Shaders::nullVertShaderSrc))
@@ -51,11 +57,12 @@ void Shaders::init() {
                     .attachShader(GL::Shader(
                         GL_FRAGMENT_SHADER,
                         GL::Shaders::normalVisualizationFragShaderSrc))
+                    .attachShader(GL::Shader(GL_FRAGMENT_SHADER,
+                                             GL::Shaders::gBufferFragShaderSrc))
                     .link()));
 
   // Depth quad shader
-  shaders_.emplace(
-      "depthQuad",
+  add(Program::DepthQuad, "depthQuad",
       std::move(GL::ShaderProgram()
                     .attachShader(GL::Shader(GL_VERTEX_SHADER,
                                              GL::Shaders::nullVertShaderSrc))
@@ -67,8 +74,7 @@ void Shaders::init() {
                     .link()));
 
   // specular quad shader
-  shaders_.emplace(
-      "specularQuad",
+  add(Program::SpecularQuad, "specularQuad",
       std::move(GL::ShaderProgram()
                     .attachShader(GL::Shader(GL_VERTEX_SHADER,
                                              GL::Shaders::nullVertShaderSrc))
@@ -77,37 +83,12 @@ void Shaders::init() {
                     .attachShader(GL::Shader(
                         GL_FRAGMENT_SHADER,
                         GL::Shaders::specularVisualizationFragShaderSrc))
+                    .attachShader(GL::Shader(GL_FRAGMENT_SHADER,
+                                             GL::Shaders::gBufferFragShaderSrc))
                     .link()));
 
-  // Ambient pass shader
-  shaders_.emplace(
-      "ambientPass",
-      std::move(
-          GL::ShaderProgram()
-              .attachShader(
-                  GL::Shader(GL_VERTEX_SHADER, GL::Shaders::nullVertShaderSrc))
-              .attachShader(GL::Shader(GL_GEOMETRY_SHADER,
-                                       GL::Shaders::quadGeomShaderSrc))
-              .attachShader(GL::Shader(GL_FRAGMENT_SHADER,
-                                       GL::Shaders::ambientPassFragShaderSrc))
-              .link()));
-
-  // Diffuse lighting pass
-  shaders_.emplace(
-      "diffuseLightingPass",
-      std::move(GL::ShaderProgram()
-                    .attachShader(GL::Shader(GL_VERTEX_SHADER,
-                                             GL::Shaders::nullVertShaderSrc))
-                    .attachShader(GL::Shader(GL_GEOMETRY_SHADER,
-                                             GL::Shaders::quadGeomShaderSrc))
-                    .attachShader(GL::Shader(
-                        GL_FRAGMENT_SHADER,
-                        GL::Shaders::diffuseLightingPassFragShaderSrc))
-                    .link()));
-
-  // Specular lighting pass
-  shaders_.emplace(
-      "specularLightingPass",
+  // Lighting pass shader, applies all lights at once
+  add(Program::LightingPass, "lightingPass",
       std::move(GL::ShaderProgram()
                     .attachShader(GL::Shader(GL_VERTEX_SHADER,
                                              GL::Shaders::nullVertShaderSrc))
@@ -115,23 +96,25 @@ void Shaders::init() {
                                              GL::Shaders::quadGeomShaderSrc))
                     .attachShader(GL::Shader(
                         GL_FRAGMENT_SHADER,
-                        GL::Shaders::specularLightingPassFragShaderSrc))
+                        GL::Shaders::lightingPassFragShaderSrc))
+                    .attachShader(GL::Shader(GL_FRAGMENT_SHADER,
+                                             GL::Shaders::gBufferFragShaderSrc))
                     .link()));
 
   // Geometry stage shader
-  shaders_.emplace(
-      "geometryStage",
+  add(Program::GeometryStage, "geometryStage",
       std::move(GL::ShaderProgram()
                     .attachShader(GL::Shader(
                         GL_VERTEX_SHADER, GL::Shaders::deferredVertexShaderSrc))
                     .attachShader(GL::Shader(
                         GL_FRAGMENT_SHADER,
-                        GL::Shaders::deferredPassthroughFragShaderSrc))
+                        GL::Shaders::deferredColormapFragShaderSrc))
+                    .attachShader(GL::Shader(GL_FRAGMENT_SHADER,
+                                             GL::Shaders::gBufferFragShaderSrc))
                     .link()));
 
   // Grid shader
-  shaders_.emplace(
-      "grid",
+  add(Program::Grid, "grid",
       std::move(
           GL::ShaderProgram()
               .attachShader(
@@ -143,8 +126,7 @@ void Shaders::init() {
               .link()));
 
   // Plane shader
-  shaders_.emplace(
-      "plane",
+  add(Program::Plane, "plane",
       std::move(GL::ShaderProgram()
                     .attachShader(GL::Shader(GL_VERTEX_SHADER,
                                              GL::Shaders::nullVertShaderSrc))
@@ -153,11 +135,12 @@ void Shaders::init() {
                     .attachShader(GL::Shader(
                         GL_FRAGMENT_SHADER,
                         GL::Shaders::deferredPassthroughFragShaderSrc))
+                    .attachShader(GL::Shader(GL_FRAGMENT_SHADER,
+                                             GL::Shaders::gBufferFragShaderSrc))
                     .link()));
 
   // Cube shader
-  shaders_.emplace(
-      "cube",
+  add(Program::Cube, "cube",
       std::move(GL::ShaderProgram()
                     .attachShader(GL::Shader(GL_VERTEX_SHADER,
                                              GL::Shaders::nullVertShaderSrc))
@@ -166,11 +149,50 @@ void Shaders::init() {
                     .attachShader(GL::Shader(
                         GL_FRAGMENT_SHADER,
                         GL::Shaders::deferredPassthroughFragShaderSrc))
+                    .attachShader(GL::Shader(GL_FRAGMENT_SHADER,
+                                             GL::Shaders::gBufferFragShaderSrc))
+                    .link()));
+
+  // Instanced cubes shader
+  add(Program::InstancedCubes, "instancedCubes",
+      std::move(GL::ShaderProgram()
+                    .attachShader(GL::Shader(
+                        GL_VERTEX_SHADER,
+                        GL::Shaders::instancedCubeVertShaderSrc))
+                    .attachShader(GL::Shader(
+                        GL_FRAGMENT_SHADER,
+                        GL::Shaders::deferredPassthroughFragShaderSrc))
+                    .attachShader(GL::Shader(GL_FRAGMENT_SHADER,
+                                             GL::Shaders::gBufferFragShaderSrc))
+                    .link()));
+
+  // Point cloud shader
+  add(Program::PointCloud, "pointCloud",
+      std::move(GL::ShaderProgram()
+                    .attachShader(GL::Shader(
+                        GL_VERTEX_SHADER, GL::Shaders::pointCloudVertShaderSrc))
+                    .attachShader(GL::Shader(
+                        GL_FRAGMENT_SHADER,
+                        GL::Shaders::pointCloudFragShaderSrc))
+                    .attachShader(GL::Shader(GL_FRAGMENT_SHADER,
+                                             GL::Shaders::gBufferFragShaderSrc))
+                    .link()));
+
+  // Polyline shader
+  add(Program::Polyline, "polyline",
+      std::move(GL::ShaderProgram()
+                    .attachShader(GL::Shader(
+                        GL_VERTEX_SHADER, GL::Shaders::polylineVertShaderSrc))
+                    .attachShader(GL::Shader(
+                        GL_GEOMETRY_SHADER, GL::Shaders::polylineGeomShaderSrc))
+                    .attachShader(GL::Shader(
+                        GL_FRAGMENT_SHADER, GL::Shaders::polylineFragShaderSrc))
+                    .attachShader(GL::Shader(GL_FRAGMENT_SHADER,
+                                             GL::Shaders::gBufferFragShaderSrc))
                     .link()));
 
   // BBox shader
-  shaders_.emplace(
-      "bbox",
+  add(Program::BBox, "bbox",
       std::move(
           GL::ShaderProgram()
               .attachShader(
@@ -182,8 +204,7 @@ void Shaders::init() {
               .link()));
 
   // Selection index visualization shader
-  shaders_.emplace(
-      "selectionIndexVisualization",
+  add(Program::SelectionIndexVisualization, "selectionIndexVisualization",
       std::move(GL::ShaderProgram()
                     .attachShader(GL::Shader(GL_VERTEX_SHADER,
                                              GL::Shaders::nullVertShaderSrc))
@@ -195,8 +216,7 @@ void Shaders::init() {
                     .link()));
 
   // Point shader
-  shaders_.emplace(
-      "point",
+  add(Program::Point, "point",
       std::move(
           GL::ShaderProgram()
               .attachShader(
@@ -204,6 +224,32 @@ void Shaders::init() {
               .attachShader(GL::Shader(GL_FRAGMENT_SHADER,
                                        GL::Shaders::passThroughFragShaderSrc))
               .link()));
+
+  // Batched mesh shader
+  add(Program::MeshBatch, "meshBatch",
+      std::move(GL::ShaderProgram()
+                    .attachShader(GL::Shader(
+                        GL_VERTEX_SHADER,
+                        GL::Shaders::deferredBatchVertexShaderSrc))
+                    .attachShader(GL::Shader(
+                        GL_FRAGMENT_SHADER,
+                        GL::Shaders::deferredBatchFragShaderSrc))
+                    .attachShader(GL::Shader(GL_FRAGMENT_SHADER,
+                                             GL::Shaders::gBufferFragShaderSrc))
+                    .link()));
+
+  Ensures(programs_.size() == static_cast<std::size_t>(Program::Count));
+
+  // Shared uniforms of the geometry shaders
+  for (auto &program : programs_) {
+    program
+        .bindUniformBlock("FrameUniforms",
+                          static_cast<GLuint>(UniformBlock::Frame))
+        .bindUniformBlock("ObjectUniforms",
+                          static_cast<GLuint>(UniformBlock::Object))
+        .bindUniformBlock("LightUniforms",
+                          static_cast<GLuint>(UniformBlock::Lights));
+  }
 }
 
 } // namespace Private_
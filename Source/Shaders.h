@@ -3,7 +3,10 @@
 #include "GL/ShaderProgram.h"
 #include "Types.h"
 
+#include <cstddef>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace VolViz {
 namespace Private_ {
@@ -12,17 +15,47 @@ namespace GL {
 class ShaderProgram;
 } // namespace GL
 
+/// Shader programs used by the visualizer
+enum class Program : std::size_t {
+  Quad,
+  HdrQuad,
+  NormalQuad,
+  DepthQuad,
+  SpecularQuad,
+  LightingPass,
+  GeometryStage,
+  Grid,
+  Plane,
+  Cube,
+  InstancedCubes,
+  PointCloud,
+  Polyline,
+  BBox,
+  SelectionIndexVisualization,
+  Point,
+  MeshBatch,
+  Count
+};
+
 class Shaders {
 public:
-  GL::ShaderProgram &operator[](std::string name);
+  inline GL::ShaderProgram &operator[](Program program) {
+    Expects(static_cast<std::size_t>(program) < programs_.size());
+    return programs_[static_cast<std::size_t>(program)];
+  }
+
+  /// Looks up a program by its name, meant for debugging
+  GL::ShaderProgram &operator[](std::string const &name);
 
   /// Compiles and links all shaders. Must be called once
   void init();
 
 private:
-  using ShaderProgramTable = std::unordered_map<std::string, GL::ShaderProgram>;
+  /// Adds the next program, programs must be added in the order of Program
+  void add(Program program, std::string name, GL::ShaderProgram &&shader);
 
-  ShaderProgramTable shaders_;
+  std::vector<GL::ShaderProgram> programs_;
+  std::unordered_map<std::string, Program> names_;
 };
 
 } // namespace Private_
@@ -2,34 +2,73 @@ R"(
 
 #version 410 core
 
-uniform mat4 modelViewProjectionMatrix;
-uniform mat3 inverseModelViewMatrix;
-uniform mat4 textureTransformMatrix;
-uniform vec3 color;
-uniform float shininess;
+// uniforms shared by all geometries of a frame
+layout(std140) uniform FrameUniforms {
+  mat4 viewMatrix;
+  mat4 projectionMatrix;
+  mat4 viewProjectionMatrix;
+  mat4 textureTransformMatrix;
+  vec2 volumeRange;
+  vec2 viewportSize;
+  bool volumeIsGray;
+  uint selectedInstance;
+};
 
-layout(location = 0) in vec4 positionIn;
-layout(location = 1) in vec3 normalIn;
+// uniforms of the rendered geometry
+layout(std140) uniform ObjectUniforms {
+  mat4 modelMatrix;
+  mat4 modelViewMatrix;
+  mat4 modelViewProjectionMatrix;
+  mat3 inverseModelViewMatrix;
+  vec3 color;
+  float shininess;
+  uint index;
+  bool selected;
+};
+
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+// quantized position, normalized to [0, 1] relative to the bounding box
+layout(location = 0) in vec3 positionIn;
+// octahedral encoded normal
+layout(location = 1) in vec2 normalIn;
+// scalar mapped through the colormap, only used if there are scalars
+layout(location = 2) in float scalarIn;
 
 layout(location = 0) out vec3 normal;
 layout(location = 1) out vec3 albedo;
 layout(location = 2) out float specular;
 layout(location = 3) out float gShininess;
 layout(location = 4) out vec3 texcoord;
+layout(location = 5) flat out uint instance;
+layout(location = 6) out float scalar;
 
+vec2 signNotZero(vec2 v) {
+  return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec3 decodeOctahedral(vec2 e) {
+  vec3 v = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+  if (v.z < 0.0) v.xy = (1.0 - abs(v.yx)) * signNotZero(v.xy);
+  return normalize(v);
+}
 
 void main() {
-  gl_Position = modelViewProjectionMatrix * positionIn;
+  vec4 position = vec4(positionOffset + positionScale * positionIn, 1.0);
+  gl_Position = modelViewProjectionMatrix * position;
   // Convert normal to view space
   // normal = normalize(transpose(inverseModelViewMatrix) * normalIn);
-  normal = normalize(inverseModelViewMatrix * normalIn);
+  normal = normalize(inverseModelViewMatrix * decodeOctahedral(normalIn));
   // set fixed colors for now
   albedo = color;
   specular = 1.0;
 
   gShininess = shininess;
+  instance = 0u;
+  scalar = scalarIn;
 
-  texcoord = (textureTransformMatrix * positionIn).xyz;
+  texcoord = (textureTransformMatrix * modelMatrix * position).xyz;
 }
 
 )"
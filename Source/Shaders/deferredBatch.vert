@@ -0,0 +1,80 @@
+R"(
+
+#version 410 core
+
+// uniforms shared by all geometries of a frame
+layout(std140) uniform FrameUniforms {
+  mat4 viewMatrix;
+  mat4 projectionMatrix;
+  mat4 viewProjectionMatrix;
+  mat4 textureTransformMatrix;
+  vec2 volumeRange;
+  vec2 viewportSize;
+  bool volumeIsGray;
+  uint selectedInstance;
+};
+
+// Records of the queued draws, see MeshPool::DrawRecord. Each record is 19
+// texels: model, model view and model view projection matrix, the columns of
+// the normal matrix, color and shininess, index and selected flag, and the
+// dequantization offset and scale.
+uniform samplerBuffer drawRecords;
+
+// quantized position, normalized to [0, 1] relative to the bounding box
+layout(location = 0) in vec3 positionIn;
+// octahedral encoded normal
+layout(location = 1) in vec2 normalIn;
+// record of the draw, per instance attribute selected by the base instance
+layout(location = 3) in uint drawIndex;
+
+layout(location = 0) out vec3 normal;
+layout(location = 1) out vec3 albedo;
+layout(location = 2) out float specular;
+layout(location = 3) out float gShininess;
+layout(location = 4) out vec3 texcoord;
+layout(location = 5) flat out uint instance;
+layout(location = 6) flat out uint objectIndex;
+
+vec2 signNotZero(vec2 v) {
+  return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec3 decodeOctahedral(vec2 e) {
+  vec3 v = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+  if (v.z < 0.0) v.xy = (1.0 - abs(v.yx)) * signNotZero(v.xy);
+  return normalize(v);
+}
+
+mat4 fetchMatrix(int texel) {
+  return mat4(texelFetch(drawRecords, texel),
+              texelFetch(drawRecords, texel + 1),
+              texelFetch(drawRecords, texel + 2),
+              texelFetch(drawRecords, texel + 3));
+}
+
+void main() {
+  int record = int(drawIndex) * 19;
+  mat4 modelMatrix = fetchMatrix(record);
+  mat4 modelViewProjectionMatrix = fetchMatrix(record + 8);
+  mat3 normalMatrix = mat3(texelFetch(drawRecords, record + 12).xyz,
+                           texelFetch(drawRecords, record + 13).xyz,
+                           texelFetch(drawRecords, record + 14).xyz);
+  vec4 colorAndShininess = texelFetch(drawRecords, record + 15);
+  vec4 indexAndSelected = texelFetch(drawRecords, record + 16);
+  vec3 positionOffset = texelFetch(drawRecords, record + 17).xyz;
+  vec3 positionScale = texelFetch(drawRecords, record + 18).xyz;
+
+  vec4 position = vec4(positionOffset + positionScale * positionIn, 1.0);
+  gl_Position = modelViewProjectionMatrix * position;
+  normal = normalize(normalMatrix * decodeOctahedral(normalIn));
+  albedo = colorAndShininess.rgb;
+  specular = 1.0;
+
+  gShininess = colorAndShininess.a;
+  instance = 0u;
+  objectIndex = floatBitsToUint(indexAndSelected.x);
+
+  texcoord = (textureTransformMatrix * modelMatrix * position).xyz;
+}
+
+)"
@@ -2,37 +2,66 @@ R"(
 
 #version 410 core
 
+// uniforms shared by all geometries of a frame
+layout(std140) uniform FrameUniforms {
+  mat4 viewMatrix;
+  mat4 projectionMatrix;
+  mat4 viewProjectionMatrix;
+  mat4 textureTransformMatrix;
+  vec2 volumeRange;
+  vec2 viewportSize;
+  bool volumeIsGray;
+  uint selectedInstance;
+};
+
+// uniforms of the rendered geometry
+layout(std140) uniform ObjectUniforms {
+  mat4 modelMatrix;
+  mat4 modelViewMatrix;
+  mat4 modelViewProjectionMatrix;
+  mat3 inverseModelViewMatrix;
+  vec3 color;
+  float shininess;
+  uint index;
+  bool selected;
+};
+
 uniform sampler3D volume;
-uniform uint index;
-uniform bool isGray;
-uniform vec2 range;
 
 layout(location = 0) in vec3 normal;
 layout(location = 1) in vec3 albedo;
 layout(location = 2) in float specular;
 layout(location = 3) in float gShininess;
 layout(location = 4) in vec3 texcoord;
+layout(location = 5) flat in uint instance;
 
-layout(location = 0) out vec4 gNormalAndSpecular;
+layout(location = 0) out vec2 gNormal;
 layout(location = 1) out vec4 gAlbedo;
-layout(location = 2) out uint gIndex;
+layout(location = 2) out uvec2 gIndex;
+layout(location = 3) out vec2 gMaterial;
+
+// see gBuffer.frag
+vec2 encodeNormal(vec3 normal);
+vec2 encodeMaterial(float specular, float shininess);
 
 void main() {
   vec3 volColor;
-  if (isGray) {
+  if (volumeIsGray) {
     // If texture is gray scale, use a window/level approach to scale the range
     // down to [0, 1]
     float intensity = texture(volume, texcoord).r;
-    volColor =
-      vec3(clamp((intensity - range.x) / (range.y - range.x), 0.0, 1.0));
+    float windowed =
+      (intensity - volumeRange.x) / (volumeRange.y - volumeRange.x);
+    volColor = vec3(clamp(windowed, 0.0, 1.0));
   } else {
     // If texture is colored, the colors can be used directly
     volColor = texture(volume, texcoord).rgb;
   }
 
-  gNormalAndSpecular = vec4(normalize(normal).xy, specular, gShininess);
+  gNormal = encodeNormal(normalize(normal));
+  gMaterial = encodeMaterial(specular, gShininess);
   gAlbedo = vec4(albedo * volColor, 1.0);
-  gIndex = index;
+  gIndex = uvec2(index, instance);
 }
 
 )"
@@ -0,0 +1,37 @@
+R"(
+
+#version 410 core
+
+// Encoding of the G-buffer, shared by the geometry and the lighting shaders.
+// The normals are mapped to an octahedron and stored in two channels, which
+// keeps their precision in RG16_SNORM textures. The shininess is stored
+// logarithmically in [0, 1], so that eight bits suffice.
+
+// Logarithm of the largest shininess that can be stored
+const float maxShininessExponent = 11.0;
+
+vec2 signNotZero(vec2 v) {
+  return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 encodeNormal(vec3 normal) {
+  vec3 n = normal / (abs(normal.x) + abs(normal.y) + abs(normal.z));
+  return n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signNotZero(n.xy);
+}
+
+vec3 decodeNormal(vec2 encoded) {
+  vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+  if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * signNotZero(n.xy);
+  return normalize(n);
+}
+
+vec2 encodeMaterial(float specular, float shininess) {
+  float exponent = log2(max(shininess, 1.0)) / maxShininessExponent;
+  return vec2(clamp(specular, 0.0, 1.0), clamp(exponent, 0.0, 1.0));
+}
+
+float decodeShininess(float encoded) {
+  return exp2(encoded * maxShininessExponent);
+}
+
+)"
@@ -2,13 +2,32 @@ R"(
 #version 410 core
 
 uniform sampler2D tex;
+// Part of the texture containing the rendered image
+uniform vec2 texcoordScale;
+// Strength of the sharpening applied when upscaling, 0 disables it
+uniform float sharpness;
 in vec2 texcoord;
 
 layout(location = 0) out vec4 color;
 
+vec4 tonemapped(vec2 uv) {
+  // Clamp to the rendered image, bilinear filtering would blend in the
+  // texels next to it
+  vec2 halfTexel = 0.5 / vec2(textureSize(tex, 0));
+  vec4 colorIn = texture(tex, clamp(uv, halfTexel, texcoordScale - halfTexel));
+  return colorIn / (colorIn + 1.0);
+}
+
 void main() {
-  vec4 colorIn = texture(tex, texcoord);
-  color = colorIn / (colorIn + 1.0);
+  color = tonemapped(texcoord);
+  if (sharpness > 0.0) {
+    vec2 texel = 1.0 / vec2(textureSize(tex, 0));
+    vec4 neighbors = tonemapped(texcoord + vec2(texel.x, 0.0)) +
+                     tonemapped(texcoord - vec2(texel.x, 0.0)) +
+                     tonemapped(texcoord + vec2(0.0, texel.y)) +
+                     tonemapped(texcoord - vec2(0.0, texel.y));
+    color = clamp(color + sharpness * (color - 0.25 * neighbors), 0.0, 1.0);
+  }
 }
 
 )"
@@ -0,0 +1,58 @@
+R"(
+
+#version 410 core
+
+// uniforms shared by all geometries of a frame
+layout(std140) uniform FrameUniforms {
+  mat4 viewMatrix;
+  mat4 projectionMatrix;
+  mat4 viewProjectionMatrix;
+  mat4 textureTransformMatrix;
+  vec2 volumeRange;
+  vec2 viewportSize;
+  bool volumeIsGray;
+  uint selectedInstance;
+};
+
+// uniforms of the rendered geometry
+layout(std140) uniform ObjectUniforms {
+  mat4 modelMatrix;
+  mat4 modelViewMatrix;
+  mat4 modelViewProjectionMatrix;
+  mat3 inverseModelViewMatrix;
+  vec3 color;
+  float shininess;
+  uint index;
+  bool selected;
+};
+
+// vertex of the unit cube [-1, 1]^3
+layout(location = 0) in vec3 positionIn;
+layout(location = 1) in vec3 normalIn;
+// per instance data: center and radius, color
+layout(location = 2) in vec4 centerAndRadius;
+layout(location = 3) in vec4 instanceColor;
+
+layout(location = 0) out vec3 normal;
+layout(location = 1) out vec3 albedo;
+layout(location = 2) out float specular;
+layout(location = 3) out float gShininess;
+layout(location = 4) out vec3 texcoord;
+layout(location = 5) flat out uint instance;
+
+void main() {
+  vec4 position =
+    vec4(centerAndRadius.xyz + centerAndRadius.w * positionIn, 1.0);
+  gl_Position = modelViewProjectionMatrix * position;
+  normal = normalize(inverseModelViewMatrix * normalIn);
+
+  bool isSelected = selected && uint(gl_InstanceID) == selectedInstance;
+  albedo = isSelected ? 1.5 * instanceColor.rgb : instanceColor.rgb;
+  specular = 1.0;
+  gShininess = shininess;
+  instance = uint(gl_InstanceID);
+
+  texcoord = (textureTransformMatrix * modelMatrix * position).xyz;
+}
+
+)"
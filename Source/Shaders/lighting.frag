@@ -4,48 +4,119 @@ R"(
 
 layout(location = 0) in vec2 texcoord;
 
-uniform sampler2D normalAndSpecularTex;
-uniform sampler2D depthTex;
+uniform sampler2D normalTex;
+uniform sampler2D materialTex;
 uniform sampler2D albedoTex;
+uniform sampler2D indexTex;
+uniform sampler2D depthTex;
+
+// First light index and number of lights of each screen tile
+uniform usamplerBuffer lightTiles;
+// Indices of the lights of the tiles
+uniform usamplerBuffer lightIndices;
+
+// Scale of the texture coordinates to the rendered part, see quad.geom
+uniform vec2 texcoordScale;
 
 layout(location = 0) out vec4 color;
 
-uniform vec4 lightPosition;
-uniform vec3 lightColor;
+// A light in view space, see LightUniforms::Entry
+struct LightSource {
+  vec4 position;
+  vec4 color;
+  vec4 spot;
+};
+
+// Has to match LightUniforms and LightUniforms::kMaxLights
+layout(std140) uniform LightUniforms {
+  mat4 inverseProjectionMatrix;
+  vec3 ambientColor;
+  uint directionalLightCount;
+  vec2 depthRange;
+  uint tileCountX;
+  uint tileSize;
+  LightSource lights[256];
+};
+
+// see gBuffer.frag
+vec3 decodeNormal(vec2 encoded);
+float decodeShininess(float encoded);
+
+// Width of the soft edge of a spot light's cone, in cosine of the angle
+const float spotEdge = 0.05;
+
+// Diffuse and specular lighting with the given direction to the light
+vec3 shade(vec3 lightDirection, vec3 lightColor, vec3 normal, vec3 specular,
+           float shininess, float isForeGround) {
+  float lightDotNormal = dot(lightDirection, normal);
+  vec3 reflectedRayDirection = reflect(-lightDirection, normal);
+
+  // since all vectors are in view space, the view direction is just along the
+  // -z axis. Therefore dot(reflectedRayDirection, -viewDirection) is just
+  // reflectedRayDirection.z
+  vec3 diffuseColor = lightColor * min(isForeGround, max(0.0, lightDotNormal));
+  vec3 specularColor =
+      lightColor * specular *
+      min(isForeGround, pow(max(0.0, reflectedRayDirection.z), shininess));
+  return diffuseColor + specularColor;
+}
 
 void main() {
   // Read values from textures
-  vec4 normalAndSpecular = texture(normalAndSpecularTex, texcoord);
-  vec2 normalUV = normalAndSpecular.xy;
-  vec3 normal = vec3(normalUV, sqrt(1.0 - dot(normalUV, normalUV)));
-  float depth = texture(depthTex, texcoord).r;
+  vec3 normal = decodeNormal(texture(normalTex, texcoord).xy);
+  vec2 material = texture(materialTex, texcoord).rg;
   vec3 albedo = texture(albedoTex, texcoord).rgb;
-  
-  vec3 specular = vec3(normalAndSpecular.z);
-  float shininess = normalAndSpecular.w;
-  // compute 3D position
-  // use texcoord as transformed view space coordinates
-  vec3 position = vec3(texcoord.x * 2.0 - 1.0, texcoord.y * 2 - 1.0, depth);
-  
-  // compute light direction. If the 4th component of lightPosition is 0,
-  // the light is located infinitely away
-  vec3 lightDirection;
-  if (lightPosition.w < 0.1) {
-    lightDirection = normalize(lightPosition.xyz);
-  } else {
-    lightDirection = normalize(lightPosition.xyz - position);
+  vec4 idx = texture(indexTex, texcoord).rgba;
+  float depth = texture(depthTex, texcoord).r;
+  float isForeGround = max(1.0, idx.r + idx.g + idx.b + idx.a);
+
+  vec3 specular = vec3(material.x);
+  float shininess = decodeShininess(material.y);
+
+  // all lights are accumulated in a single pass, so the G-buffer is only
+  // read once
+  vec3 lighting = ambientColor;
+  for (uint i = 0u; i < directionalLightCount; ++i) {
+    lighting += shade(lights[i].position.xyz, lights[i].color.rgb, normal,
+                      specular, shininess, isForeGround);
   }
 
-  vec3 directionToCamera = vec3(0.0, 0.0, 1.0);
-  float lightDotNormal = dot(lightDirection, normal);
-//   vec3 reflectedRayDirection = 2 * lightDotNormal * normal - lightDirection;
-  vec3 reflectedRayDirection = reflect(-lightDirection, normal);
+  // the depth is cleared to 0, i.e. the background is infinitely far away
+  // and not lit by point and spot lights
+  if (depth > 0.0) {
+    // reconstruct the view space position from the depth
+    vec2 ndc = 2.0 * texcoord / texcoordScale - 1.0;
+    vec4 clip = vec4(ndc, mix(depthRange.y, depthRange.x, depth), 1.0);
+    vec4 viewPosition = inverseProjectionMatrix * clip;
+    vec3 position = viewPosition.xyz / viewPosition.w;
 
-  vec3 diffuseColor = albedo * max(0.0, lightDotNormal);
-  vec3 specularColor =
-     specular * pow(max(0.0, reflectedRayDirection.z), shininess);
+    // only the lights assigned to the pixel's tile can reach it
+    uvec2 tileCoord = uvec2(gl_FragCoord.xy) / tileSize;
+    uvec2 tile = texelFetch(lightTiles,
+                            int(tileCoord.y * tileCountX + tileCoord.x)).rg;
+    for (uint i = 0u; i < tile.y; ++i) {
+      LightSource light = lights[texelFetch(lightIndices,
+                                            int(tile.x + i)).r];
+
+      vec3 toLight = light.position.xyz - position;
+      float range = light.color.w;
+      float distance = length(toLight);
+      if (distance >= range) continue;
+      vec3 lightDirection = toLight / max(distance, 1e-6);
+
+      // the light fades out smoothly towards its range
+      float ratio = distance / range;
+      float attenuation = (1.0 - ratio * ratio) * (1.0 - ratio * ratio);
+      float cosAngle = dot(-lightDirection, light.spot.xyz);
+      attenuation *=
+          smoothstep(light.spot.w, light.spot.w + spotEdge, cosAngle);
+
+      lighting += shade(lightDirection, attenuation * light.color.rgb, normal,
+                        specular, shininess, isForeGround);
+    }
+  }
 
-  color.rgb = lightColor * (diffuseColor + specularColor);
+  color = vec4(albedo * (1.0 - isForeGround + lighting), 1.0);
 }
 
 )"
@@ -6,10 +6,11 @@ in vec2 texcoord;
 
 layout(location = 0) out vec4 color;
 
+// see gBuffer.frag
+vec3 decodeNormal(vec2 encoded);
+
 void main() {
-  vec2 normalUV = texture(tex, texcoord).xy;
-  float z = sqrt(1.0 - dot(normalUV, normalUV));
-  vec3 normal = vec3(normalUV, z);
+  vec3 normal = decodeNormal(texture(tex, texcoord).xy);
 
   color.rgb = (1.0 + normal) / 2.0;
 }
@@ -0,0 +1,73 @@
+R"(
+
+#version 410 core
+
+// uniforms shared by all geometries of a frame
+layout(std140) uniform FrameUniforms {
+  mat4 viewMatrix;
+  mat4 projectionMatrix;
+  mat4 viewProjectionMatrix;
+  mat4 textureTransformMatrix;
+  vec2 volumeRange;
+  vec2 viewportSize;
+  bool volumeIsGray;
+  uint selectedInstance;
+};
+
+// uniforms of the rendered geometry
+layout(std140) uniform ObjectUniforms {
+  mat4 modelMatrix;
+  mat4 modelViewMatrix;
+  mat4 modelViewProjectionMatrix;
+  mat3 inverseModelViewMatrix;
+  vec3 color;
+  float shininess;
+  uint index;
+  bool selected;
+};
+
+uniform sampler3D volume;
+
+layout(location = 1) in vec3 albedo;
+layout(location = 2) in float specular;
+layout(location = 3) in float gShininess;
+layout(location = 4) in vec3 texcoord;
+layout(location = 5) flat in uint instance;
+
+layout(location = 0) out vec2 gNormal;
+layout(location = 1) out vec4 gAlbedo;
+layout(location = 2) out uvec2 gIndex;
+layout(location = 3) out vec2 gMaterial;
+
+// see gBuffer.frag
+vec2 encodeNormal(vec3 normal);
+vec2 encodeMaterial(float specular, float shininess);
+
+void main() {
+  // Render each point as a sphere impostor. The normal is computed in view
+  // space from the position within the point sprite.
+  vec2 xy = vec2(2.0, -2.0) * gl_PointCoord + vec2(-1.0, 1.0);
+  float r2 = dot(xy, xy);
+  if (r2 > 1.0) discard;
+  vec3 normal = vec3(xy, sqrt(1.0 - r2));
+
+  vec3 volColor;
+  if (volumeIsGray) {
+    // If texture is gray scale, use a window/level approach to scale the range
+    // down to [0, 1]
+    float intensity = texture(volume, texcoord).r;
+    float windowed =
+      (intensity - volumeRange.x) / (volumeRange.y - volumeRange.x);
+    volColor = vec3(clamp(windowed, 0.0, 1.0));
+  } else {
+    // If texture is colored, the colors can be used directly
+    volColor = texture(volume, texcoord).rgb;
+  }
+
+  gNormal = encodeNormal(normal);
+  gMaterial = encodeMaterial(specular, gShininess);
+  gAlbedo = vec4(albedo * volColor, 1.0);
+  gIndex = uvec2(index, instance);
+}
+
+)"
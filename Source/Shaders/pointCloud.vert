@@ -0,0 +1,60 @@
+R"(
+
+#version 410 core
+
+// uniforms shared by all geometries of a frame
+layout(std140) uniform FrameUniforms {
+  mat4 viewMatrix;
+  mat4 projectionMatrix;
+  mat4 viewProjectionMatrix;
+  mat4 textureTransformMatrix;
+  vec2 volumeRange;
+  vec2 viewportSize;
+  bool volumeIsGray;
+  uint selectedInstance;
+};
+
+// uniforms of the rendered geometry
+layout(std140) uniform ObjectUniforms {
+  mat4 modelMatrix;
+  mat4 modelViewMatrix;
+  mat4 modelViewProjectionMatrix;
+  mat3 inverseModelViewMatrix;
+  vec3 color;
+  float shininess;
+  uint index;
+  bool selected;
+};
+
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+uniform float pointSizeScale;
+
+// quantized position, normalized to [0, 1] relative to the bounding box
+layout(location = 0) in vec3 positionIn;
+layout(location = 1) in vec4 colorIn;
+// index of the point in the point cloud descriptor
+layout(location = 2) in uint idIn;
+
+layout(location = 1) out vec3 albedo;
+layout(location = 2) out float specular;
+layout(location = 3) out float gShininess;
+layout(location = 4) out vec3 texcoord;
+layout(location = 5) flat out uint instance;
+
+void main() {
+  vec4 position = vec4(positionOffset + positionScale * positionIn, 1.0);
+  gl_Position = modelViewProjectionMatrix * position;
+  // size attenuation: the point covers the projected diameter of its sphere
+  gl_PointSize = max(1.0, pointSizeScale / gl_Position.w);
+
+  bool isSelected = selected && idIn == selectedInstance;
+  albedo = isSelected ? 1.5 * colorIn.rgb : colorIn.rgb;
+  specular = 1.0;
+  gShininess = shininess;
+  instance = idIn;
+
+  texcoord = (textureTransformMatrix * modelMatrix * position).xyz;
+}
+
+)"
@@ -0,0 +1,83 @@
+R"(
+
+#version 410 core
+
+// uniforms shared by all geometries of a frame
+layout(std140) uniform FrameUniforms {
+  mat4 viewMatrix;
+  mat4 projectionMatrix;
+  mat4 viewProjectionMatrix;
+  mat4 textureTransformMatrix;
+  vec2 volumeRange;
+  vec2 viewportSize;
+  bool volumeIsGray;
+  uint selectedInstance;
+};
+
+// uniforms of the rendered geometry
+layout(std140) uniform ObjectUniforms {
+  mat4 modelMatrix;
+  mat4 modelViewMatrix;
+  mat4 modelViewProjectionMatrix;
+  mat3 inverseModelViewMatrix;
+  vec3 color;
+  float shininess;
+  uint index;
+  bool selected;
+};
+
+uniform sampler3D volume;
+
+uniform bool useScalars;
+uniform vec2 scalarRange;
+uniform vec3 minColor;
+uniform vec3 maxColor;
+
+layout(location = 0) in vec3 side;
+layout(location = 1) in vec3 toCamera;
+layout(location = 2) in float across;
+layout(location = 3) in float scalar;
+layout(location = 4) in vec3 texcoord;
+layout(location = 5) flat in uint instance;
+
+layout(location = 0) out vec2 gNormal;
+layout(location = 1) out vec4 gAlbedo;
+layout(location = 2) out uvec2 gIndex;
+layout(location = 3) out vec2 gMaterial;
+
+// see gBuffer.frag
+vec2 encodeNormal(vec3 normal);
+vec2 encodeMaterial(float specular, float shininess);
+
+void main() {
+  float a = clamp(across, -1.0, 1.0);
+  vec3 normal = normalize(a * side + sqrt(1.0 - a * a) * toCamera);
+
+  vec3 albedo = color;
+  if (useScalars) {
+    float s = clamp((scalar - scalarRange.x) / (scalarRange.y - scalarRange.x),
+                    0.0, 1.0);
+    albedo = mix(minColor, maxColor, s);
+  }
+  if (selected && instance == selectedInstance) albedo *= 1.5;
+
+  vec3 volColor;
+  if (volumeIsGray) {
+    // If texture is gray scale, use a window/level approach to scale the range
+    // down to [0, 1]
+    float intensity = texture(volume, texcoord).r;
+    float windowed =
+      (intensity - volumeRange.x) / (volumeRange.y - volumeRange.x);
+    volColor = vec3(clamp(windowed, 0.0, 1.0));
+  } else {
+    // If texture is colored, the colors can be used directly
+    volColor = texture(volume, texcoord).rgb;
+  }
+
+  gNormal = encodeNormal(normal);
+  gMaterial = encodeMaterial(1.0, shininess);
+  gAlbedo = vec4(albedo * volColor, 1.0);
+  gIndex = uvec2(index, instance);
+}
+
+)"
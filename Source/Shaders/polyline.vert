@@ -0,0 +1,49 @@
+R"(
+
+#version 410 core
+
+// uniforms shared by all geometries of a frame
+layout(std140) uniform FrameUniforms {
+  mat4 viewMatrix;
+  mat4 projectionMatrix;
+  mat4 viewProjectionMatrix;
+  mat4 textureTransformMatrix;
+  vec2 volumeRange;
+  vec2 viewportSize;
+  bool volumeIsGray;
+  uint selectedInstance;
+};
+
+// uniforms of the rendered geometry
+layout(std140) uniform ObjectUniforms {
+  mat4 modelMatrix;
+  mat4 modelViewMatrix;
+  mat4 modelViewProjectionMatrix;
+  mat3 inverseModelViewMatrix;
+  vec3 color;
+  float shininess;
+  uint index;
+  bool selected;
+};
+
+layout(location = 0) in vec3 positionIn;
+layout(location = 1) in float scalarIn;
+layout(location = 2) in uint lineIn;
+
+out VertexData {
+  vec3 viewPosition;
+  vec3 texcoord;
+  float scalar;
+  flat uint line;
+} vertexOut;
+
+void main() {
+  vec4 position = vec4(positionIn, 1.0);
+  gl_Position = modelViewProjectionMatrix * position;
+  vertexOut.viewPosition = (modelViewMatrix * position).xyz;
+  vertexOut.texcoord = (textureTransformMatrix * modelMatrix * position).xyz;
+  vertexOut.scalar = scalarIn;
+  vertexOut.line = lineIn;
+}
+
+)"
@@ -6,10 +6,13 @@ in vec2 texcoord;
 
 layout(location = 0) out vec4 color;
 
+// see gBuffer.frag
+float decodeShininess(float encoded);
+
 void main() {
-  vec2 specComponents = texture(tex, texcoord).ba;
-  float specularity = specComponents.x;
-  float shininess = specComponents.y;
+  vec2 material = texture(tex, texcoord).rg;
+  float specularity = material.x;
+  float shininess = decodeShininess(material.y);
 
   color.b = specularity;
   color.r = shininess / (shininess + 1.0);
@@ -0,0 +1,197 @@
+// Bounds the error of the compact G-buffer profile.
+//
+// The encoding functions mirror Shaders/gBuffer.frag, the quantization
+// functions mirror the conversions of OpenGL to the RG16_SNORM, RG8 and
+// R11G11B10F formats. Each value is encoded once, then stored in the full
+// and in the compact profile and decoded again. The decoded values of both
+// profiles must agree within the tolerances below.
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+double constexpr kPi = 3.14159265358979323846;
+
+/// Largest angle between the normals of both profiles, in radians
+float constexpr kMaxNormalError = 1e-4f;
+/// Largest difference of the specularity
+float constexpr kMaxSpecularError = 0.5f / 255.f + 1e-5f;
+/// Largest relative difference of the shininess
+float constexpr kMaxShininessError = 0.016f;
+/// Largest relative difference of the red and green channels of the image,
+/// which have six mantissa bits. The blue channel has five.
+float constexpr kMaxRedGreenError = 1.f / 64.f;
+float constexpr kMaxBlueError = 1.f / 32.f;
+
+// gBuffer.frag
+
+float constexpr maxShininessExponent = 11.f;
+
+Eigen::Vector2f signNotZero(Eigen::Vector2f const &v) {
+  return {v.x() >= 0.f ? 1.f : -1.f, v.y() >= 0.f ? 1.f : -1.f};
+}
+
+Eigen::Vector2f encodeNormal(Eigen::Vector3f const &normal) {
+  Eigen::Vector3f const n = normal / normal.cwiseAbs().sum();
+  if (n.z() >= 0.f) return n.head<2>();
+  Eigen::Vector2f const yx(n.y(), n.x());
+  return (Eigen::Vector2f::Ones() - yx.cwiseAbs())
+      .cwiseProduct(signNotZero(n.head<2>()));
+}
+
+Eigen::Vector3f decodeNormal(Eigen::Vector2f const &encoded) {
+  Eigen::Vector3f n(encoded.x(), encoded.y(),
+                    1.f - std::abs(encoded.x()) - std::abs(encoded.y()));
+  if (n.z() < 0.f) {
+    Eigen::Vector2f const yx(n.y(), n.x());
+    n.head<2>() = (Eigen::Vector2f::Ones() - yx.cwiseAbs())
+                      .cwiseProduct(signNotZero(n.head<2>()));
+  }
+  return n.normalized();
+}
+
+Eigen::Vector2f encodeMaterial(float specular, float shininess) {
+  float const exponent =
+      std::log2(std::max(shininess, 1.f)) / maxShininessExponent;
+  return {std::min(std::max(specular, 0.f), 1.f),
+          std::min(std::max(exponent, 0.f), 1.f)};
+}
+
+float decodeShininess(float encoded) {
+  return std::exp2(encoded * maxShininessExponent);
+}
+
+// Conversions of OpenGL
+
+/// Stores a value in a signed normalized integer with the given bits and
+/// reads it back
+float throughSnorm(float x, int bits) {
+  auto const scale = static_cast<float>((1 << (bits - 1)) - 1);
+  auto const q = std::round(std::min(std::max(x, -1.f), 1.f) * scale);
+  return std::max(q / scale, -1.f);
+}
+
+/// Stores a value in an unsigned normalized integer with the given bits and
+/// reads it back
+float throughUnorm(float x, int bits) {
+  auto const scale = static_cast<float>((1 << bits) - 1);
+  return std::round(std::min(std::max(x, 0.f), 1.f) * scale) / scale;
+}
+
+/// Stores a value in an unsigned float with a five bit exponent and the
+/// given mantissa bits and reads it back. The mantissa is truncated, which
+/// OpenGL permits and which is worse than rounding.
+float throughUnsignedFloat(float x, int mantissaBits) {
+  if (!(x > 0.f)) return 0.f;
+  std::uint32_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  auto const exponent = static_cast<int>((bits >> 23) & 0xff) - 127;
+  if (exponent < -14) return 0.f; // denormals are flushed in this test
+  auto const maxValue = std::ldexp(2.f - std::ldexp(1.f, -mantissaBits), 15);
+  if (x >= maxValue) return maxValue;
+  bits &= ~((1u << (23 - mantissaBits)) - 1u);
+  float y;
+  std::memcpy(&y, &bits, sizeof(y));
+  return y;
+}
+
+int failures = 0;
+
+void check(bool condition, char const *what, float error, float tolerance) {
+  if (condition) return;
+  ++failures;
+  std::printf("%s: error %g exceeds %g\n", what, static_cast<double>(error),
+              static_cast<double>(tolerance));
+}
+
+void testNormals() {
+  // Fibonacci sphere, plus the axes and the diagonals, which lie on the
+  // edges of the octahedron
+  int constexpr kSamples = 200000;
+  float maxError = 0.f;
+  auto const testNormal = [&maxError](Eigen::Vector3f const &normal) {
+    Eigen::Vector2f const encoded = encodeNormal(normal.normalized());
+    Eigen::Vector2f const compact(throughSnorm(encoded.x(), 16),
+                                  throughSnorm(encoded.y(), 16));
+    auto const full = decodeNormal(encoded);
+    auto const reduced = decodeNormal(compact);
+    auto const angle =
+        std::atan2(full.cross(reduced).norm(), full.dot(reduced));
+    maxError = std::max(maxError, angle);
+  };
+
+  auto const goldenAngle = static_cast<float>(kPi * (3. - std::sqrt(5.)));
+  for (int i = 0; i < kSamples; ++i) {
+    auto const z = 1.f - 2.f * (static_cast<float>(i) + 0.5f) /
+                   static_cast<float>(kSamples);
+    auto const r = std::sqrt(1.f - z * z);
+    auto const phi = goldenAngle * static_cast<float>(i);
+    testNormal({r * std::cos(phi), r * std::sin(phi), z});
+  }
+  for (int x = -1; x <= 1; ++x) {
+    for (int y = -1; y <= 1; ++y) {
+      for (int z = -1; z <= 1; ++z) {
+        if (x != 0 || y != 0 || z != 0)
+          testNormal(Eigen::Vector3f(static_cast<float>(x),
+                                     static_cast<float>(y),
+                                     static_cast<float>(z)));
+      }
+    }
+  }
+  check(maxError <= kMaxNormalError, "Normal", maxError, kMaxNormalError);
+}
+
+void testMaterial() {
+  float maxSpecularError = 0.f;
+  float maxShininessError = 0.f;
+  for (int i = 0; i <= 1000; ++i) {
+    auto const specular = static_cast<float>(i) / 1000.f;
+    auto const shininess = std::exp2(maxShininessExponent * specular);
+    Eigen::Vector2f const encoded = encodeMaterial(specular, shininess);
+
+    auto const reducedSpecular = throughUnorm(encoded.x(), 8);
+    maxSpecularError =
+        std::max(maxSpecularError, std::abs(reducedSpecular - encoded.x()));
+
+    auto const full = decodeShininess(encoded.y());
+    auto const reduced = decodeShininess(throughUnorm(encoded.y(), 8));
+    maxShininessError =
+        std::max(maxShininessError, std::abs(reduced - full) / full);
+  }
+  check(maxSpecularError <= kMaxSpecularError, "Specularity",
+        maxSpecularError, kMaxSpecularError);
+  check(maxShininessError <= kMaxShininessError, "Shininess",
+        maxShininessError, kMaxShininessError);
+}
+
+void testImage() {
+  // lit colors from dark to strongly overexposed
+  float maxRedGreenError = 0.f;
+  float maxBlueError = 0.f;
+  for (float x = 1e-3f; x < 1e4f; x *= 1.001f) {
+    maxRedGreenError = std::max(
+        maxRedGreenError, std::abs(throughUnsignedFloat(x, 6) - x) / x);
+    maxBlueError =
+        std::max(maxBlueError, std::abs(throughUnsignedFloat(x, 5) - x) / x);
+  }
+  check(maxRedGreenError <= kMaxRedGreenError, "Image red and green",
+        maxRedGreenError, kMaxRedGreenError);
+  check(maxBlueError <= kMaxBlueError, "Image blue", maxBlueError,
+        kMaxBlueError);
+}
+
+} // namespace
+
+int main() {
+  testNormals();
+  testMaterial();
+  testImage();
+  return failures == 0 ? 0 : 1;
+}
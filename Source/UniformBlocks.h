@@ -0,0 +1,95 @@
+#pragma once
+
+#include "GL/GLdefs.h"
+#include "Types.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace VolViz {
+namespace Private_ {
+
+/// Binding points of the uniform blocks shared by the shaders
+enum class UniformBlock : GLuint { Frame = 0, Object = 1, Lights = 2 };
+
+/// Matrix without alignment requirements, to be used in the blocks below
+using UniformMatrix4 = Eigen::Matrix<float, 4, 4, Eigen::DontAlign>;
+
+/// Uniforms that are the same for all geometries of a frame. Laid out like
+/// the FrameUniforms block of the shaders (std140).
+struct FrameUniforms {
+  UniformMatrix4 viewMatrix;
+  UniformMatrix4 projectionMatrix;
+  UniformMatrix4 viewProjectionMatrix;
+  /// Transformation from world to volume texture coordinates
+  UniformMatrix4 textureTransformMatrix;
+  /// Window of the gray values of the volume
+  std::array<float, 2> volumeRange;
+  /// Size of the viewport in pixels
+  std::array<float, 2> viewportSize;
+  GLint volumeIsGray;
+  /// Instance of the selected geometry under the cursor
+  GLuint selectedInstance;
+  std::array<GLuint, 2> padding;
+};
+static_assert(sizeof(FrameUniforms) == 288, "Unexpected frame uniforms size");
+
+/// Uniforms of a single geometry. Laid out like the ObjectUniforms block of
+/// the shaders (std140).
+struct ObjectUniforms {
+  UniformMatrix4 modelMatrix;
+  UniformMatrix4 modelViewMatrix;
+  UniformMatrix4 modelViewProjectionMatrix;
+  /// Transforms normals from model to view coordinates, i.e. the transposed
+  /// inverse of the model view matrix. A std140 mat3 has padded columns.
+  std::array<float, 12> inverseModelViewMatrix;
+  std::array<float, 3> color;
+  float shininess;
+  /// Selection index of the geometry
+  GLuint index;
+  GLint selected;
+  std::array<GLuint, 2> padding;
+};
+static_assert(sizeof(ObjectUniforms) == 272,
+              "Unexpected object uniforms size");
+
+/// Lights applied by the lighting pass. Laid out like the LightUniforms block
+/// of the shaders (std140).
+struct LightUniforms {
+  /// Maximal number of lights, the size of the array in the shader
+  static constexpr std::size_t kMaxLights = 256;
+
+  /// A light in view space
+  struct Entry {
+    /// Normalized direction to a directional light or position of a point or
+    /// spot light, w is unused
+    std::array<float, 4> position;
+    /// Color of the light, w is the range of a point or spot light
+    std::array<float, 4> color;
+    /// Direction of the cone of a spot light, w is the cosine of its cutoff
+    /// angle, which is below -1 for point lights
+    std::array<float, 4> spot;
+  };
+
+  /// Transforms from clip to view space, used to reconstruct the positions of
+  /// the pixels
+  UniformMatrix4 inverseProjectionMatrix;
+  /// Sum of the ambient contributions of all lights
+  std::array<float, 3> ambientColor;
+  /// Number of directional lights. They are stored first and applied to all
+  /// pixels, the other lights are assigned to screen tiles.
+  GLuint directionalLightCount;
+  /// Near and far value of the normalized device depth, see DepthRange
+  std::array<float, 2> depthRange;
+  /// Number of tiles in x direction
+  GLuint tileCountX;
+  /// Width and height of a tile in pixels
+  GLuint tileSize;
+  std::array<Entry, kMaxLights> lights;
+};
+static_assert(sizeof(LightUniforms) == 96 + 48 * LightUniforms::kMaxLights,
+              "Unexpected light uniforms size");
+
+} // namespace Private_
+} // namespace VolViz
@@ -1,4 +1,5 @@
 #include "Visualizer.h"
+#include "FrameScheduler.h"
 #include "GeometryDescriptor.h"
 #include "VisualizerImpl.h"
 
@@ -14,15 +15,14 @@ namespace VolViz {
 
 Visualizer::Visualizer()
     : impl_(std::make_unique<Private_::VisualizerImpl>(this)) {
-  scale.afterAction = [this](auto const &) {
-    impl_->cachedScale.markAsDirty();
-  };
+  observeProperties();
 }
 
 Visualizer::~Visualizer() = default;
 
 Visualizer::Visualizer(Visualizer &&rhs) : impl_(std::move(rhs.impl_)) {
   impl_->visualizer_ = this;
+  observeProperties();
 }
 
 Visualizer &Visualizer::operator=(Visualizer &&rhs) {
@@ -32,6 +32,33 @@ Visualizer &Visualizer::operator=(Visualizer &&rhs) {
   return *this;
 }
 
+void Visualizer::observeProperties() {
+  // Every change requests a new frame, which also wakes up a render loop
+  // waiting for events
+  scale.afterAction = [this](auto const &) {
+    impl_->cachedScale.markAsDirty();
+    impl_->markSceneChanged();
+  };
+  backgroundColor.afterAction = [this](auto const &) {
+    impl_->cachedBackgroundColor.markAsDirty();
+    impl_->markSceneChanged();
+  };
+  showGrid.afterAction = [this](auto const &) { impl_->markSceneChanged(); };
+  targetFrameTime.afterAction = [this](auto const &) {
+    impl_->markSceneChanged();
+  };
+  showVolumeBoundingBox.afterAction = [this](auto const &) {
+    impl_->markSceneChanged();
+  };
+  progressiveRefinement.afterAction = [this](auto const &) {
+    impl_->markSceneChanged();
+  };
+  compactGBuffer.afterAction = [this](auto const &) {
+    impl_->markSceneChanged();
+  };
+  camera.afterChange = [this]() { impl_->markSceneChanged(); };
+}
+
 void Visualizer::start() { impl_->start(); }
 
 void Visualizer::enableMultithreading() noexcept {
@@ -56,22 +83,31 @@ void Visualizer::renderOneFrameAndWaitForEvents() {
   impl_->renderOneFrame(true);
 }
 
-void Visualizer::renderAtFPS(double fps) {
-  using Clock = std::chrono::steady_clock;
-  using namespace std::chrono_literals;
-
-  auto const frameDuration = 1.0 / fps * 1s;
+void Visualizer::renderAtFPS(double fps, bool lowLatency) {
+  // The swap interval is 1, so the swap waits for the refresh of the display
+  auto const refreshRate = impl_->glfw_.refreshRate();
+  auto const refreshInterval = Private_::FrameScheduler::Duration(
+      refreshRate > 0 ? 1.0 / refreshRate : 0.0);
+  Private_::FrameScheduler scheduler(fps, refreshInterval, lowLatency);
 
   while (*this) {
-    auto const t0 = Clock::now();
+    scheduler.waitForFrame();
+
+    // The events are otherwise processed after the frame, which delays the
+    // input by up to a frame
+    if (lowLatency) impl_->processEvents(false);
 
+    auto const renderedFrames = renderStatistics().renderedFrames;
     renderOneFrame();
 
-    auto const t1 = Clock::now();
-    auto const deltaT = t1 - t0;
+    auto statistics = renderStatistics();
+    scheduler.frameFinished(statistics.renderedFrames != renderedFrames);
 
-    if (deltaT < frameDuration)
-      std::this_thread::sleep_for(frameDuration - deltaT);
+    auto const &timing = scheduler.statistics();
+    statistics.frameInterval = timing.frameInterval;
+    statistics.frameIntervalJitter = timing.frameIntervalJitter;
+    statistics.missedFrames = timing.missedFrames;
+    impl_->renderStatistics_ = statistics;
   }
 }
 
@@ -98,6 +134,19 @@ void Visualizer::addLight(LightName name, Light const &light) {
   impl_->addLight(name, light);
 }
 
+Visualizer::PickResult
+Visualizer::pick(Position2 const &windowPosition) const {
+  return impl_->pick(windowPosition);
+}
+
+Visualizer::Selection Visualizer::selection() const {
+  return impl_->selection();
+}
+
+Visualizer::RenderStatistics Visualizer::renderStatistics() const {
+  return impl_->renderStatistics();
+}
+
 template <class Descriptor, typename>
 void Visualizer::addGeometry(GeometryName name, Descriptor const &geom) {
   impl_->addGeometry(name, geom);
@@ -112,6 +161,14 @@ template void Visualizer::addGeometry<CubeDescriptor>(GeometryName name,
 template void Visualizer::addGeometry<MeshDescriptor>(GeometryName name,
                                                       MeshDescriptor const &);
 
+template void Visualizer::addGeometry<InstancedCubesDescriptor>(
+    GeometryName name, InstancedCubesDescriptor const &);
+
+template void Visualizer::addGeometry<PointCloudDescriptor>(
+    GeometryName name, PointCloudDescriptor const &);
+template void Visualizer::addGeometry<PolylineDescriptor>(
+    GeometryName name, PolylineDescriptor const &);
+
 template <class Descriptor, typename>
 bool Visualizer::updateGeometry(GeometryName name, Descriptor &&geom) {
   return impl_->updateGeometry(name, std::forward<Descriptor>(geom));
@@ -140,4 +197,24 @@ template bool Visualizer::updateGeometry<MeshDescriptor &&>(GeometryName name,
 template bool Visualizer::updateGeometry<MeshDescriptor &>(GeometryName name,
                                                            MeshDescriptor &);
 
+template bool Visualizer::updateGeometry<InstancedCubesDescriptor const &>(
+    GeometryName name, InstancedCubesDescriptor const &);
+template bool Visualizer::updateGeometry<InstancedCubesDescriptor &&>(
+    GeometryName name, InstancedCubesDescriptor &&);
+template bool Visualizer::updateGeometry<InstancedCubesDescriptor &>(
+    GeometryName name, InstancedCubesDescriptor &);
+
+template bool Visualizer::updateGeometry<PointCloudDescriptor const &>(
+    GeometryName name, PointCloudDescriptor const &);
+template bool Visualizer::updateGeometry<PointCloudDescriptor &&>(
+    GeometryName name, PointCloudDescriptor &&);
+template bool Visualizer::updateGeometry<PointCloudDescriptor &>(
+    GeometryName name, PointCloudDescriptor &);
+template bool Visualizer::updateGeometry<PolylineDescriptor const &>(
+    GeometryName name, PolylineDescriptor const &);
+template bool Visualizer::updateGeometry<PolylineDescriptor &&>(
+    GeometryName name, PolylineDescriptor &&);
+template bool Visualizer::updateGeometry<PolylineDescriptor &>(
+    GeometryName name, PolylineDescriptor &);
+
 } // namespace VolViz
@@ -1,12 +1,18 @@
 #include "VisualizerImpl.h"
+#include "Frustum.h"
+#include "UniformBlocks.h"
 
 #include "Visualizer.h"
 
 #include <Eigen/Core>
 
 #include <algorithm>
+#include <cstddef>
+#include <cstring>
 #include <iostream>
+#include <limits>
 #include <mutex>
+#include <tuple>
 
 namespace VolViz {
 
@@ -18,6 +24,13 @@ namespace VolViz {
 
 namespace Private_ {
 
+namespace {
+
+/// Sharpening of the final image at the lowest render scale
+constexpr float kMaxUpscalingSharpness = 0.5f;
+
+} // namespace
+
 #pragma mark Constructor
 VisualizerImpl::VisualizerImpl(Visualizer *vis)
     : visualizer_(vis), geomFactory_(*this) {
@@ -38,8 +51,12 @@ VisualizerImpl::VisualizerImpl(Visualizer *vis)
   //   std::cout << "\t" << e << std::endl;
 
   shaders_.init();
+  renderTargets_.resize(framebufferSize(), RenderTargetPool::Clock::now());
   setupFBOs();
+  setupSingleVertexData();
   setupSelectionBuffers();
+  setupUniformBuffers();
+  meshPool_.init(major > 4 || (major == 4 && minor >= 3));
 
   // Check if glClipControl is available
   if (major > 4 || (major == 4 && minor >= 5) ||
@@ -60,24 +77,35 @@ VisualizerImpl::VisualizerImpl(Visualizer *vis)
 
   glfw_.keyInputHandler = [this](int k, int s, int a, int m) {
     handleKeyInput(k, s, a, m);
+    markSceneChanged();
   };
 
   glfw_.windowResizeCallback = [this](auto, auto) {
-    this->setupFBOs(); // this is used explicitly here because gcc complains
-                       // otherwise, although it's perectly standard conformant
-    glViewport(0, 0, static_cast<GLsizei>(glfw_.width()),
-               static_cast<GLsizei>(glfw_.height()));
+    // this is used explicitly here because gcc complains otherwise,
+    // although it's perectly standard conformant
     float const FOV =
         static_cast<float>(glfw_.width()) / static_cast<float>(glfw_.height());
     this->camera().verticalFieldOfView = static_cast<double>(FOV);
+    this->markSceneChanged();
   };
 
+  glfw_.framebufferResizeCallback = [this](auto, auto) {
+    // The render targets are reallocated by the render loop once the size
+    // settled
+    this->renderTargets_.resize(this->framebufferSize(),
+                                RenderTargetPool::Clock::now());
+    this->markSceneChanged();
+  };
+
+  glfw_.windowRefreshCallback = [this]() { markSceneChanged(); };
+
   glfw_.scrollWheelInputHandler = [this](double, double y) {
     Length const scale = cachedScale;
     PhysicalPosition pos = camera().position;
     pos(2) -= 2 * narrow_cast<float>(y) * scale;
 
     camera().position = pos;
+    markInteraction();
   };
 
   glfw_.mouseButtonCallback = [this](int button, int action, int) {
@@ -99,6 +127,7 @@ VisualizerImpl::VisualizerImpl(Visualizer *vis)
           moveState_ = MoveState::None;
         break;
     }
+    markSceneChanged();
   };
 
   glfw_.mouseMoveCallback = [this](double x, double y) {
@@ -127,6 +156,7 @@ VisualizerImpl::VisualizerImpl(Visualizer *vis)
                    Eigen::AngleAxisf(static_cast<float>(angle), axis))
                    .inverse();
           camera().orientation = o.normalized();
+          markInteraction();
         }
         break;
       }
@@ -138,6 +168,9 @@ VisualizerImpl::VisualizerImpl(Visualizer *vis)
 
     lastMouseDelta_ = pos - lastMousePos_;
     lastMousePos_ = pos;
+
+    // the cursor only matters while rotating, dragging or selecting
+    if (moveState_ != MoveState::None || inSelectionMode) markSceneChanged();
   };
 }
 
@@ -146,19 +179,50 @@ VisualizerImpl::VisualizerImpl(Visualizer *vis)
 void VisualizerImpl::setupFBOs() {
 
   glfw_.makeCurrent();
-  auto const width = static_cast<GLsizei>(glfw_.width());
-  auto const height = static_cast<GLsizei>(glfw_.height());
+  auto const capacity = renderTargets_.capacity();
+  auto const width = static_cast<GLsizei>(capacity(0));
+  auto const height = static_cast<GLsizei>(capacity(1));
+
+  // The compact profile stores the normals, the material and the lit image
+  // with reduced precision, which more than halves their size
+  compactGBuffer_ = visualizer_->compactGBuffer;
+  auto const normalFormat = compactGBuffer_ ? GL_RG16_SNORM : GL_RG32F;
+  auto const materialFormat = compactGBuffer_ ? GL_RG8 : GL_RG32F;
+  auto const imageFormat = compactGBuffer_ ? GL_R11F_G11F_B10F : GL_RGBA32F;
+
+  for (auto id : {TextureID::Normals, TextureID::Material, TextureID::Albedo,
+                  TextureID::Depth, TextureID::SelectionTexture,
+                  TextureID::RenderedImage, TextureID::AccumulatedImage}) {
+    textures_.recreate(id);
+  }
+
   // set up FBO
   { // textures and FBO for the geometry stage
-    // normal and specular texture
-    glBindTexture(GL_TEXTURE_2D, textures_[TextureID::NormalsAndSpecular]);
+    // normal texture, the normals are mapped to an octahedron
+    glBindTexture(GL_TEXTURE_2D, textures_[TextureID::Normals]);
     assertGL("glBindTexture failed");
 #ifdef _WIN32
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA,
+    glTexImage2D(GL_TEXTURE_2D, 0, normalFormat, width, height, 0, GL_RG,
                  GL_FLOAT, NULL);
     assertGL("glTexImage2D failed");
 #else
-    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, width, height);
+    glTexStorage2D(GL_TEXTURE_2D, 1, normalFormat, width, height);
+    assertGL("glTexStorage2D failed");
+#endif
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    assertGL("OpenGL Error Stack not clean");
+
+    // material texture, specularity and encoded shininess
+    glBindTexture(GL_TEXTURE_2D, textures_[TextureID::Material]);
+    assertGL("glBindTexture failed");
+#ifdef _WIN32
+    glTexImage2D(GL_TEXTURE_2D, 0, materialFormat, width, height, 0, GL_RG,
+                 GL_FLOAT, NULL);
+    assertGL("glTexImage2D failed");
+#else
+    glTexStorage2D(GL_TEXTURE_2D, 1, materialFormat, width, height);
     assertGL("glTexStorage2D failed");
 #endif
 
@@ -197,11 +261,11 @@ void VisualizerImpl::setupFBOs() {
     // Selection index texture
     glBindTexture(GL_TEXTURE_2D, textures_[TextureID::SelectionTexture]);
 #ifdef _WIN32
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, width, height, 0, GL_RED_INTEGER,
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32UI, width, height, 0, GL_RG_INTEGER,
                  GL_UNSIGNED_INT, NULL);
     assertGL("glTexImage2D failed");
 #else
-    glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32UI, width, height);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RG32UI, width, height);
     assertGL("glTexStorage2D failed");
 #endif
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -212,11 +276,13 @@ void VisualizerImpl::setupFBOs() {
     GL::Framebuffer fbo;
     glBindFramebuffer(GL_FRAMEBUFFER, fbo.name);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                           textures_[TextureID::NormalsAndSpecular], 0);
+                           textures_[TextureID::Normals], 0);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D,
                            textures_[TextureID::Albedo], 0);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D,
                            textures_[TextureID::SelectionTexture], 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D,
+                           textures_[TextureID::Material], 0);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
                            textures_[TextureID::Depth], 0);
     assertGL("OpenGL Error Stack not clean");
@@ -237,80 +303,154 @@ void VisualizerImpl::setupFBOs() {
     glBindTexture(GL_TEXTURE_2D, textures_[TextureID::RenderedImage]);
     assertGL("glBindTexture failed");
 #ifdef _WIN32
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA,
+    glTexImage2D(GL_TEXTURE_2D, 0, imageFormat, width, height, 0, GL_RGBA,
                  GL_FLOAT, NULL);
     assertGL("glTexImage2D failed");
 #else
-    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, width, height);
+    glTexStorage2D(GL_TEXTURE_2D, 1, imageFormat, width, height);
     assertGL("glTexStorage2D failed");
 #endif
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    // filtered linearly, since it is upscaled if the resolution is scaled
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     assertGL("OpenGL Error Stack not clean");
 
-    // depth and stencil texture
-    glBindTexture(GL_TEXTURE_2D, textures_[TextureID::FinalDepth]);
+    // The lighting pass samples the depth of the geometry stage, so it
+    // renders to a framebuffer without depth attachment
+    GL::Framebuffer shadedFbo;
+    glBindFramebuffer(GL_FRAMEBUFFER, shadedFbo.name);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           textures_[TextureID::RenderedImage], 0);
+    assertGL("OpenGL Error Stack not clean");
+    // check FBO
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      throw std::runtime_error(
+          "Incomplete FBO: " +
+          std::to_string(glCheckFramebufferStatus(GL_FRAMEBUFFER)));
+    }
+
+    // The overlays are depth tested against the depth of the geometry stage,
+    // which is shared instead of copied. They must not write it.
+    GL::Framebuffer fbo;
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo.name);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           textures_[TextureID::RenderedImage], 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
+                           textures_[TextureID::Depth], 0);
+    assertGL("OpenGL Error Stack not clean");
+    // check FBO
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      throw std::runtime_error(
+          "Incomplete FBO: " +
+          std::to_string(glCheckFramebufferStatus(GL_FRAMEBUFFER)));
+    }
+
+    shadedFbo_ = std::move(shadedFbo);
+    finalFbo_ = std::move(fbo);
+  }
+
+  assertGL("OpenGL Error Stack not clean");
+  { // texture and fbo the frames are accumulated in
+    glBindTexture(GL_TEXTURE_2D, textures_[TextureID::AccumulatedImage]);
+    assertGL("glBindTexture failed");
 #ifdef _WIN32
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, width, height, 0,
-                 GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA,
+                 GL_FLOAT, NULL);
     assertGL("glTexImage2D failed");
 #else
-    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, width, height);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, width, height);
     assertGL("glTexStorage2D failed");
 #endif
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     assertGL("OpenGL Error Stack not clean");
 
-    // setup FBO
     GL::Framebuffer fbo;
     glBindFramebuffer(GL_FRAMEBUFFER, fbo.name);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                           textures_[TextureID::RenderedImage], 0);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
-                           textures_[TextureID::FinalDepth], 0);
+                           textures_[TextureID::AccumulatedImage], 0);
     assertGL("OpenGL Error Stack not clean");
-    // check FBO
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
       throw std::runtime_error(
           "Incomplete FBO: " +
           std::to_string(glCheckFramebufferStatus(GL_FRAMEBUFFER)));
     }
 
-    finalFbo_ = std::move(fbo);
+    accumulationFbo_ = std::move(fbo);
   }
 
+  renderTargets_.allocated();
   assertGL("OpenGL Error Stack not clean");
+}
+
+void VisualizerImpl::setupSingleVertexData() {
   // create dummy VAO for single single point rendering
-  {
-    auto vao = GL::VertexArray{};
-    vao.enableVertexAttribArray(0);
-    assertGL("OpenGL Error Stack not clean");
+  auto vao = GL::VertexArray{};
+  vao.enableVertexAttribArray(0);
+  assertGL("OpenGL Error Stack not clean");
 
-    auto const vert = Eigen::Vector3f::Zero().eval();
-    auto vb = GL::Buffer{};
-    vb.upload(GL_ARRAY_BUFFER, 3 * sizeof(float), vert.data(), GL_STATIC_DRAW);
+  auto const vert = Eigen::Vector3f::Zero().eval();
+  auto vb = GL::Buffer{};
+  vb.upload(GL_ARRAY_BUFFER, 3 * sizeof(float), vert.data(), GL_STATIC_DRAW);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, false, 0, nullptr);
-    assertGL("OpenGL Error Stack not clean");
+  glVertexAttribPointer(0, 3, GL_FLOAT, false, 0, nullptr);
+  assertGL("OpenGL Error Stack not clean");
 
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    assertGL("OpenGL Error Stack not clean");
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  assertGL("OpenGL Error Stack not clean");
 
-    singleVertexData_.vBuff = std::move(vb);
-    singleVertexData_.vao = std::move(vao);
-  }
+  singleVertexData_.vBuff = std::move(vb);
+  singleVertexData_.vao = std::move(vao);
 }
 
 void VisualizerImpl::setupSelectionBuffers() {
   for (auto &buffer : selectionBuffer_.buffers) {
-    buffer.upload(GL_PIXEL_PACK_BUFFER, sizeof(std::uint32_t) + sizeof(float),
+    buffer.upload(GL_PIXEL_PACK_BUFFER,
+                  2 * sizeof(std::uint32_t) + sizeof(float),
                   static_cast<void *>(nullptr), GL_STREAM_READ);
   }
   GL::Buffer::unbind(GL_PIXEL_PACK_BUFFER);
 }
 
+void VisualizerImpl::setupUniformBuffers() {
+  frameUniformBuffer_ = GL::Buffer();
+  frameUniformBuffer_.upload(GL_UNIFORM_BUFFER, sizeof(FrameUniforms),
+                             static_cast<FrameUniforms const *>(nullptr),
+                             GL_DYNAMIC_DRAW);
+  objectUniformBuffer_ = GL::Buffer();
+  lightUniformBuffer_ = GL::Buffer();
+  lightUniformBuffer_.upload(GL_UNIFORM_BUFFER, sizeof(LightUniforms),
+                             static_cast<LightUniforms const *>(nullptr),
+                             GL_DYNAMIC_DRAW);
+  GL::Buffer::unbind(GL_UNIFORM_BUFFER);
+
+  // Buffer textures can only be attached to buffers that have a data store,
+  // so both buffers get room for one entry until the first frame uploads the
+  // culled lights
+  lightTileBuffer_ = GL::Buffer();
+  lightTileBuffer_.upload(GL_TEXTURE_BUFFER, sizeof(LightCuller::Tile),
+                          static_cast<LightCuller::Tile const *>(nullptr),
+                          GL_STREAM_DRAW);
+  lightIndexBuffer_ = GL::Buffer();
+  lightIndexBuffer_.upload(GL_TEXTURE_BUFFER, sizeof(std::uint16_t),
+                           static_cast<std::uint16_t const *>(nullptr),
+                           GL_STREAM_DRAW);
+  GL::Buffer::unbind(GL_TEXTURE_BUFFER);
+  lightTileTextures_ = GL::Textures<2>();
+  glBindTexture(GL_TEXTURE_BUFFER, lightTileTextures_.names[0]);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, lightTileBuffer_.name);
+  glBindTexture(GL_TEXTURE_BUFFER, lightTileTextures_.names[1]);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_R16UI, lightIndexBuffer_.name);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  assertGL("Failed to setup uniform buffers");
+
+  GLint alignment = 1;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  auto const align = static_cast<std::size_t>(std::max(alignment, 1));
+  objectUniformStride_ = (sizeof(ObjectUniforms) + align - 1) / align * align;
+}
+
 #pragma mark Matrix Computation
 
 Eigen::Matrix4f VisualizerImpl::textureTransformationMatrix() const noexcept {
@@ -400,6 +540,7 @@ void VisualizerImpl::setVolume(VolumeDescriptor descriptor,
   assertGL("Failed to set texture parameters");
 
   currentVolume_ = descriptor;
+  markSceneChanged();
 }
 
 Size3f VisualizerImpl::volumeSize() const noexcept {
@@ -424,18 +565,14 @@ void VisualizerImpl::setVolume(VolumeDescriptor descriptor,
   setVolume(descriptor, as_span(ptr, size));
 }
 
-void VisualizerImpl::attachVolumeToShader(GL::ShaderProgram &shader) const {
-  shader["volume"] = static_cast<GLint>(0);
-  shader["isGray"] =
-      static_cast<GLint>(currentVolume_.type == VolumeType::GrayScale);
-  auto const &range = currentVolume_.range;
-  shader["range"] = Eigen::Vector2f(range.min, range.max);
-}
-
 void VisualizerImpl::addLight(Visualizer::LightName name, Light const &light) {
   std::lock_guard<std::mutex> lock(lightMutex_);
 
+  if (lights_.size() >= LightUniforms::kMaxLights &&
+      lights_.find(name) == lights_.end())
+    throw std::runtime_error("Too many lights");
   lights_.emplace(name, light);
+  markSceneChanged();
 }
 
 void VisualizerImpl::drawSingleVertex() const noexcept {
@@ -484,9 +621,69 @@ void VisualizerImpl::handleKeyInput(int key, int, int action, int) {
 
 #pragma mark Render Methods
 
+void VisualizerImpl::processEvents(bool block) {
+  if (!block) {
+    glfw_.pollEvents();
+    return;
+  }
+  if (!quality_.refining() && !renderTargets_.pending()) {
+    glfw_.waitEvents();
+    return;
+  }
+
+  // Wait no longer than until the next refining frame or the reallocation of
+  // the render targets is due
+  QualityController::Duration const delay = visualizer_->refinementDelay;
+  auto deadline = QualityController::Clock::time_point::max();
+  if (quality_.refining()) deadline = quality_.refinementTime(delay);
+  if (renderTargets_.pending())
+    deadline = std::min(deadline, renderTargets_.settleTime());
+  QualityController::Duration const timeout =
+      deadline - QualityController::Clock::now();
+  if (timeout.count() > 0.0)
+    glfw_.waitEvents(timeout.count());
+  else
+    glfw_.pollEvents();
+}
+
 void VisualizerImpl::renderOneFrame(bool block) {
+  // Once the window size settled, a frame reallocates the render targets
+  // and renders at the full resolution again
+  auto const now = QualityController::Clock::now();
+  bool const settled =
+      renderTargets_.pending() && renderTargets_.needsAllocation(now);
+  // An interaction always comes with a change, but it might be marked
+  // after the change was consumed
+  bool const interacting = interacting_.exchange(false);
+  bool const changed =
+      sceneChanged_.exchange(false) || interacting || settled;
+
+  // Without changes, frames are only rendered to refine the quality once
+  // the interaction stopped
+  QualityController::Duration const delay = visualizer_->refinementDelay;
+  bool const refine = !changed && quality_.refining() &&
+                      now >= quality_.refinementTime(delay);
+
+  // The previous frame stays on screen if nothing changed. Changes made
+  // while rendering mark the scene again and are shown in the next frame.
+  if (!changed && !refine) {
+    Visualizer::RenderStatistics statistics = renderStatistics_;
+    ++statistics.skippedFrames;
+    renderStatistics_ = statistics;
+    processEvents(block);
+    return;
+  }
+  quality_.beginFrame(visualizer_->progressiveRefinement, changed,
+                      interacting, now);
 
   glfw_.makeCurrent();
+  // switching the G-buffer profile reallocates the render targets as well
+  renderTargets_.resize(framebufferSize(), now);
+  if (renderTargets_.needsAllocation(now) ||
+      visualizer_->compactGBuffer != compactGBuffer_)
+    setupFBOs();
+  beginFrameTimer();
+  updateRenderSize();
 
   // Init all new geometry
   {
@@ -507,6 +704,7 @@ void VisualizerImpl::renderOneFrame(bool block) {
   assertGL("OpenGL Error stack not clear");
 
   renderGeometry();
+  updatePickScene();
 
   switch (viewState_) {
     case ViewState::Scene3D: {
@@ -528,61 +726,283 @@ void VisualizerImpl::renderOneFrame(bool block) {
   // if (!geomNameAndPos.first.empty() && viewState_ == ViewState::Scene3D)
   //     renderPoint(geomNameAndPos.second, Colors::Cyan(), 2.5f);
 
+  if (quality_.accumulates()) accumulateImage();
   renderFinalPass();
+  endFrameTimer();
 
   if (inSelectionMode && moveState_ != MoveState::Dragging) {
     auto const geomNameAndPos = getGeometryUnderCursor();
+    // The read back lags a frame behind, so render until it is up to date
+    // with the cursor and the selection is highlighted
+    if (geomNameAndPos.name != selectedGeometry_ ||
+        geomNameAndPos.instance != selectedInstance_ ||
+        selectionMousePos_ != lastMousePos_)
+      markSceneChanged();
+    selectionMousePos_ = lastMousePos_;
     selectedGeometry_ = geomNameAndPos.name;
+    selectedInstance_ = geomNameAndPos.instance;
     selectedPoint_ = geomNameAndPos.position;
   } else if (inSelectionMode && moveState_ == MoveState::Dragging) {
     dragSelectedGeometry();
   } else if (moveState_ != MoveState::Dragging) {
+    if (!selectedGeometry_.empty()) markSceneChanged();
     selectedGeometry_.clear();
+    selectedInstance_ = 0;
   }
+  selection_ = Visualizer::Selection{selectedGeometry_, selectedInstance_};
 
   glfw_.swapBuffers();
 
-  if (block)
-    glfw_.waitEvents();
-  else
-    glfw_.pollEvents();
+  processEvents(block);
+}
+
+void VisualizerImpl::beginFrameTimer() {
+  // The query of this timer was issued a few frames ago, so its result is
+  // usually available. If the GPU is further behind, the sample is dropped
+  // and the query is reused rather than waiting for it.
+  auto const query = frameTimers_.names[currentFrameTimer_];
+  GLuint available = GL_FALSE;
+  if (frameTimerPending_[currentFrameTimer_])
+    glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+  frameTimerPending_[currentFrameTimer_] = false;
+  if (available == GL_TRUE) {
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+
+    // Frames rendered at a lower quality are extrapolated to the scale of
+    // the controller, the time is proportional to the number of pixels
+    auto const scaleRatio = frameTimerScaleRatio_[currentFrameTimer_];
+    ResolutionController::Duration const target = visualizer_->targetFrameTime;
+    resolutionController_.update(
+        ResolutionController::Duration(static_cast<double>(elapsed) * 1e-9 *
+                                       scaleRatio * scaleRatio),
+        target);
+  }
+
+  glBeginQuery(GL_TIME_ELAPSED, query);
+  assertGL("Failed to begin frame timer");
+}
+
+void VisualizerImpl::endFrameTimer() {
+  glEndQuery(GL_TIME_ELAPSED);
+  frameTimerPending_[currentFrameTimer_] = true;
+  frameTimerScaleRatio_[currentFrameTimer_] =
+      static_cast<double>(resolutionController_.scale() / renderScale_);
+  currentFrameTimer_ = (currentFrameTimer_ + 1) % kFrameTimers;
+}
+
+void VisualizerImpl::updateRenderSize() {
+  auto const scale =
+      std::min(resolutionController_.scale(), quality_.resolutionScale());
+  if (scale != renderScale_) quality_.restartAccumulation();
+  renderScale_ = scale;
+
+  // Until the render targets are reallocated for a larger window, the image
+  // is rendered at their size and upscaled
+  auto const size = framebufferSize();
+  renderSize_ = (size * renderScale_)
+                    .array()
+                    .round()
+                    .max(1.f)
+                    .min(size.array().max(1.f))
+                    .min(renderTargets_.allocatedSize().array());
+
+  // Accumulated frames are offset by a fraction of a pixel, which moves the
+  // clip space by twice the fraction of the render size
+  Eigen::Vector2f const offset =
+      2.f * quality_.sampleOffset().cwiseQuotient(renderSize_);
+  Matrix4 jitter = Matrix4::Identity();
+  jitter(0, 3) = offset(0);
+  jitter(1, 3) = offset(1);
+  projectionMatrix_ = jitter * cameraClient().projectionMatrix();
+}
+
+void VisualizerImpl::accumulateImage() {
+  auto fboBinding =
+      binding(accumulationFbo_, static_cast<GLenum>(GL_DRAW_FRAMEBUFFER));
+  glDisable(GL_FRAMEBUFFER_SRGB);
+
+  // The n-th frame is blended in with a weight of 1/n, so that all frames
+  // contribute equally. The first frame replaces the accumulated image.
+  auto const weight = 1.f / static_cast<float>(quality_.sample() + 1);
+  glBlendColor(0.f, 0.f, 0.f, weight);
+  glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+  glEnable(GL_BLEND);
+  renderFullscreenQuad(TextureID::RenderedImage, shaders_[Program::Quad]);
+  glDisable(GL_BLEND);
+  assertGL("Failed to accumulate the rendered image");
 }
 
 void VisualizerImpl::renderGeometry() {
-  constexpr std::array<GLuint, 3> attachments{
-      {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2}};
+  constexpr std::array<GLuint, 4> attachments{
+      {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2,
+       GL_COLOR_ATTACHMENT3}};
 
-  constexpr std::array<GLfloat, 4> normalAndSpecularClear{{0.f, 0.f, 0.f, 0.f}};
+  constexpr std::array<GLfloat, 4> normalAndMaterialClear{{0.f, 0.f, 0.f, 0.f}};
   constexpr std::array<GLuint, 4> selectionClear{{0, 0, 0, 0}};
 
   Color const bgColor = visualizer_->backgroundColor;
   std::array<GLfloat, 4> clearColor{{bgColor(0), bgColor(1), bgColor(2), 1.f}};
 
-  // Bind FBO and set it up for MRT
+  // Bind FBO and set it up for MRT, the scene is rendered to the lower left
+  // part of the render targets
   auto fboBinding = binding(lightingFbo_, static_cast<GLenum>(GL_FRAMEBUFFER));
+  // The scissor rectangle keeps the clears from touching the rest of the
+  // render targets
+  glViewport(0, 0, static_cast<GLsizei>(renderSize_(0)),
+             static_cast<GLsizei>(renderSize_(1)));
+  glScissor(0, 0, static_cast<GLsizei>(renderSize_(0)),
+            static_cast<GLsizei>(renderSize_(1)));
+  glEnable(GL_SCISSOR_TEST);
   assertGL("Failed to bind framebuffer");
   glDrawBuffers(attachments.size(), attachments.data());
 
   glDisable(GL_FRAMEBUFFER_SRGB);
   // Clear buffers
-  glClearBufferfv(GL_COLOR, 0, normalAndSpecularClear.data());
+  glClearBufferfv(GL_COLOR, 0, normalAndMaterialClear.data());
   glClearBufferfv(GL_COLOR, 1, clearColor.data());
   glClearBufferuiv(GL_COLOR, 2, selectionClear.data());
+  glClearBufferfv(GL_COLOR, 3, normalAndMaterialClear.data());
   glClearBufferfi(GL_DEPTH_STENCIL, 0, 0.f, 0);
 
   glEnable(GL_DEPTH_TEST);
   glDepthMask(true);
   glColorMask(true, true, true, true);
 
-  // call render commands
+  // The frustum is extracted once and tested against the cached world
+  // bounds of each geometry. Culled geometries keep their index, so that
+  // the selection indices stay the same.
+  Length const scale = cachedScale;
+  auto const frustum =
+      Frustum::fromMatrix(cameraClient().viewProjectionMatrix(scale));
+
+  Visualizer::RenderStatistics statistics = renderStatistics_;
+  statistics.geometries = geometries_.size();
+  statistics.culledGeometries = 0;
+  ++statistics.renderedFrames;
+
+  // Queue the visible geometries and sort them by their state, so that
+  // program switches and uniform uploads are shared
+  renderQueue_.clear();
   std::uint32_t idx = 0;
-  for (auto const &geom : geometries_)
-    geom.second->render(++idx, geom.first == selectedGeometry_);
+  for (auto const &geom : geometries_) {
+    ++idx;
+    auto const &bounds = geom.second->worldBounds(scale);
+    if (!bounds.isEmpty() &&
+        !frustum.intersectsBox(bounds.min(), bounds.max())) {
+      ++statistics.culledGeometries;
+      continue;
+    }
+    renderQueue_.push_back({geom.second->renderState(), idx, geom.second.get(),
+                            geom.first == selectedGeometry_});
+  }
+  auto const sortKey = [](RenderQueueEntry const &entry) {
+    return std::make_tuple(entry.state.program, entry.state.vertexArray,
+                           entry.index);
+  };
+  std::sort(renderQueue_.begin(), renderQueue_.end(),
+            [&](auto const &lhs, auto const &rhs) {
+              return sortKey(lhs) < sortKey(rhs);
+            });
+
+  uploadFrameUniforms();
+  uploadObjectUniforms();
+
+  // call render commands
+  auto const objectBinding = static_cast<GLuint>(UniformBlock::Object);
+  for (std::size_t i = 0; i < renderQueue_.size(); ++i) {
+    auto const &entry = renderQueue_[i];
+    glBindBufferRange(GL_UNIFORM_BUFFER, objectBinding,
+                      objectUniformBuffer_.name,
+                      static_cast<GLintptr>(i * objectUniformStride_),
+                      sizeof(ObjectUniforms));
+    entry.geometry->render(entry.index, entry.selected);
+  }
+  // meshes only queue their draws, which are submitted at once
+  meshPool_.draw(shaders_[Program::MeshBatch]);
+  statistics.renderScale = renderScale_;
+  statistics.gpuFrameTime = resolutionController_.gpuFrameTime();
+  statistics.optimizedMeshes = optimizedMeshes_;
+  if (optimizedMeshes_ > 0) {
+    auto const n = static_cast<float>(optimizedMeshes_);
+    statistics.cacheMissRatioBefore = cacheMissRatioSums_[0] / n;
+    statistics.cacheMissRatioAfter = cacheMissRatioSums_[1] / n;
+  }
+  renderStatistics_ = statistics;
 
   // switch back to single render target
   glDrawBuffers(1, attachments.data());
 }
 
+void VisualizerImpl::uploadFrameUniforms() {
+  Length const scale = cachedScale;
+  auto const client = cameraClient();
+  auto const viewport = renderSize_;
+  auto const &range = currentVolume_.range;
+
+  FrameUniforms uniforms;
+  uniforms.viewMatrix = client.viewMatrix(scale);
+  uniforms.projectionMatrix = projectionMatrix_;
+  uniforms.viewProjectionMatrix = viewProjectionMatrix(scale);
+  uniforms.textureTransformMatrix = textureTransformationMatrix();
+  uniforms.volumeRange = {{range.min, range.max}};
+  uniforms.viewportSize = {
+      {static_cast<float>(viewport(0)), static_cast<float>(viewport(1))}};
+  uniforms.volumeIsGray =
+      static_cast<GLint>(currentVolume_.type == VolumeType::GrayScale);
+  uniforms.selectedInstance = selectedInstance_;
+  uniforms.padding = {{0, 0}};
+
+  auto const bufferBinding = GL::binding(
+      frameUniformBuffer_, static_cast<GLenum>(GL_UNIFORM_BUFFER));
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &uniforms);
+  glBindBufferBase(GL_UNIFORM_BUFFER, static_cast<GLuint>(UniformBlock::Frame),
+                   frameUniformBuffer_.name);
+  assertGL("Failed to upload frame uniforms");
+}
+
+void VisualizerImpl::uploadObjectUniforms() {
+  if (renderQueue_.empty()) return;
+
+  Length const scale = cachedScale;
+  auto const client = cameraClient();
+  Matrix4 const viewMatrix = client.viewMatrix(scale);
+
+  if (renderQueue_.size() > objectUniformCapacity_) {
+    objectUniformCapacity_ =
+        std::max(renderQueue_.size(), 2 * objectUniformCapacity_);
+  }
+  auto const size =
+      static_cast<GLsizeiptr>(objectUniformCapacity_ * objectUniformStride_);
+
+  // The buffer is orphaned, so that writing it does not wait for the draws of
+  // the previous frame
+  auto const bufferBinding = GL::binding(
+      objectUniformBuffer_, static_cast<GLenum>(GL_UNIFORM_BUFFER));
+  glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_STREAM_DRAW);
+  auto *data = static_cast<unsigned char *>(
+      glMapBufferRange(GL_UNIFORM_BUFFER, 0, size,
+                       GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+  if (data == nullptr)
+    throw std::runtime_error("Failed to map the object uniform buffer");
+
+  for (std::size_t i = 0; i < renderQueue_.size(); ++i) {
+    auto const &entry = renderQueue_[i];
+    auto const uniforms = entry.geometry->objectUniforms(
+        viewMatrix, projectionMatrix_, scale, entry.index, entry.selected);
+    std::memcpy(data + i * objectUniformStride_, &uniforms, sizeof(uniforms));
+  }
+  glUnmapBuffer(GL_UNIFORM_BUFFER);
+  assertGL("Failed to upload object uniforms");
+}
+
+void VisualizerImpl::meshOptimized(float cacheMissRatioBefore,
+                                   float cacheMissRatioAfter) noexcept {
+  ++optimizedMeshes_;
+  cacheMissRatioSums_[0] += cacheMissRatioBefore;
+  cacheMissRatioSums_[1] += cacheMissRatioAfter;
+}
+
 void VisualizerImpl::updateGeometries() {
   for (auto &geom : geometries_) geom.second->update();
 }
@@ -592,16 +1012,18 @@ void VisualizerImpl::renderGrid() {
   Length const scale = cachedScale;
   auto fboBinding = binding(finalFbo_, static_cast<GLenum>(GL_FRAMEBUFFER));
 
-  shaders_["grid"].use();
-  shaders_["grid"]["scale"] = 1.f;
-  shaders_["grid"]["viewProjectionMatrix"] =
-      cameraClient().viewProjectionMatrix(scale);
+  shaders_[Program::Grid].use();
+  shaders_[Program::Grid]["scale"] = 1.f;
+  shaders_[Program::Grid]["viewProjectionMatrix"] =
+      viewProjectionMatrix(scale);
 
   auto boundVao = binding(singleVertexData_.vao);
 
+  // the depth of the geometry stage is only tested
   glEnable(GL_DEPTH_TEST);
-  glDepthMask(GL_TRUE);
+  glDepthMask(GL_FALSE);
   glDrawArrays(GL_POINTS, 0, 1);
+  glDepthMask(GL_TRUE);
   assertGL("glDrawArrays failed");
 }
 
@@ -612,13 +1034,13 @@ void VisualizerImpl::renderPoint(Position const &position, Color const &color,
   auto fboBinding =
       binding(finalFbo_, static_cast<GLenum>(GL_DRAW_FRAMEBUFFER));
 
-  auto const viewProjMat = cameraClient().viewProjectionMatrix(scale);
+  auto const viewProjMat = viewProjectionMatrix(scale);
   PositionH projPos = viewProjMat * position.homogeneous();
 
-  shaders_["point"].use();
-  shaders_["point"]["size"] = size;
-  shaders_["point"]["position"] = projPos;
-  shaders_["point"]["pointColor"] = color;
+  shaders_[Program::Point].use();
+  shaders_[Program::Point]["size"] = size;
+  shaders_[Program::Point]["position"] = projPos;
+  shaders_[Program::Point]["pointColor"] = color;
 
   auto boundVao = binding(singleVertexData_.vao);
   glDisable(GL_DEPTH_TEST);
@@ -639,15 +1061,15 @@ void VisualizerImpl::renderLightingTextures() {
   glDisable(GL_FRAMEBUFFER_SRGB);
   glDisable(GL_DEPTH_TEST);
 
-  renderQuad(Point2::Zero(), halfWindowSize, TextureID::NormalsAndSpecular,
-             shaders_["normalQuad"]);
+  renderQuad(Point2::Zero(), halfWindowSize, TextureID::Normals,
+             shaders_[Program::NormalQuad]);
   renderQuad(Point2::Zero() + Point2(halfWindowSize(0), 0), halfWindowSize,
-             TextureID::Depth, shaders_["depthQuad"]);
+             TextureID::Depth, shaders_[Program::DepthQuad]);
   // glEnable(GL_FRAMEBUFFER_SRGB);
   renderQuad(Point2::Zero() + Point2(0, halfWindowSize(1)), halfWindowSize,
-             TextureID::Albedo, shaders_["quad"]);
+             TextureID::Albedo, shaders_[Program::Quad]);
   renderQuad(Point2::Zero() + halfWindowSize, halfWindowSize,
-             TextureID::NormalsAndSpecular, shaders_["specularQuad"]);
+             TextureID::Material, shaders_[Program::SpecularQuad]);
 }
 
 void VisualizerImpl::renderSelectionIndexTexture() {
@@ -657,19 +1079,30 @@ void VisualizerImpl::renderSelectionIndexTexture() {
   glDisable(GL_FRAMEBUFFER_SRGB);
   glDisable(GL_DEPTH_TEST);
 
-  shaders_["selectionIndexVisualization"].use();
-  shaders_["selectionIndexVisualization"]["nObjects"] =
+  shaders_[Program::SelectionIndexVisualization].use();
+  shaders_[Program::SelectionIndexVisualization]["nObjects"] =
       static_cast<std::uint32_t>(geometries_.size());
   renderFullscreenQuad(TextureID::SelectionTexture,
-                       shaders_["selectionIndexVisualization"]);
+                       shaders_[Program::SelectionIndexVisualization]);
 }
 
 void VisualizerImpl::renderFinalPass() {
   // Render FBA color attachment to screen
   GL::Framebuffer::unbind(GL_FRAMEBUFFER);
+  glDisable(GL_SCISSOR_TEST);
+  glViewport(0, 0, static_cast<GLsizei>(glfw_.framebufferWidth()),
+             static_cast<GLsizei>(glfw_.framebufferHeight()));
   // glDisable(GL_FRAMEBUFFER_SRGB);
   glEnable(GL_FRAMEBUFFER_SRGB);
-  renderFullscreenQuad(TextureID::RenderedImage, shaders_["hdrQuad"]);
+
+  // An upscaled image is sharpened, the more the lower its resolution
+  shaders_[Program::HdrQuad]["sharpness"] =
+      kMaxUpscalingSharpness *
+      std::min(1.f, (1.f - renderScale_) /
+                        (1.f - ResolutionController::kMinScale));
+  renderFullscreenQuad(quality_.accumulates() ? TextureID::AccumulatedImage
+                                              : TextureID::RenderedImage,
+                       shaders_[Program::HdrQuad]);
   // renderFullscreenQuad(TextureID::RenderedImage, quadProgram_);
   // auto readBinding =
   //     GL::binding(finalFbo_, static_cast<GLenum>(GL_READ_FRAMEBUFFER));
@@ -689,19 +1122,22 @@ void VisualizerImpl::renderBoundingBox(Position const &position,
   auto const modelMat =
       (Eigen::Translation3f(position) * orientation * size.asDiagonal())
           .matrix();
-  auto const mvpMatrix =
-      (cameraClient().viewProjectionMatrix(scale) * modelMat).eval();
+  // The overlays are jittered like the geometry, whose depth they test
+  // against
+  auto const mvpMatrix = (viewProjectionMatrix(scale) * modelMat).eval();
 
-  shaders_["bbox"].use();
-  shaders_["bbox"]["lineColor"] = color;
-  shaders_["bbox"]["modelViewProjectionMatrix"] = mvpMatrix;
+  shaders_[Program::BBox].use();
+  shaders_[Program::BBox]["lineColor"] = color;
+  shaders_[Program::BBox]["modelViewProjectionMatrix"] = mvpMatrix;
 
   // draw quad using the geometry shader
   auto boundVao = GL::binding(singleVertexData_.vao);
+  // the depth of the geometry stage is only tested
   glEnable(GL_DEPTH_TEST);
   glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-  glDepthMask(GL_TRUE);
+  glDepthMask(GL_FALSE);
   glDrawArrays(GL_POINTS, 0, 1);
+  glDepthMask(GL_TRUE);
   assertGL("glDrawArrays failed");
 }
 
@@ -727,26 +1163,25 @@ VisualizerImpl::getGeometryUnderCursor() {
       binding(lightingFbo_, static_cast<GLenum>(GL_READ_FRAMEBUFFER));
 
   auto const mousePos = lastMousePos_;
-  // convert mouse position to texture screen coordinates
-  auto const windowSize =
-      Size2(glfw_.width(), glfw_.height()).cast<double>().eval();
-  auto const pos =
-      Position2(mousePos(0) + 1.0f * static_cast<float>(windowSize(0)) / 2.0f,
-                mousePos(1) + 1.0f * static_cast<float>(windowSize(1)) / 2.0f)
-          .cast<GLint>()
-          .eval();
-
-  // Copy index and depth to selection(back) buffer
+  // convert mouse position to pixels of the rendered image
+  auto const maxPos = (renderSize_.array() - 1.f).max(0.f).eval();
+  auto const pos = ((mousePos.array() + 1.f) / 2.f * renderSize_.array())
+                       .min(maxPos)
+                       .max(0.f)
+                       .cast<GLint>()
+                       .eval();
+
+  // Copy index, instance and depth to selection(back) buffer
   auto const writeBinding = GL::binding(
       *selectionBuffer_.writeBuffer, static_cast<GLenum>(GL_PIXEL_PACK_BUFFER));
   glPixelStorei(GL_PACK_ALIGNMENT, 4);
   glReadBuffer(GL_COLOR_ATTACHMENT2);
-  glReadPixels(pos(0), pos(1), 1, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+  glReadPixels(pos(0), pos(1), 1, 1, GL_RG_INTEGER, GL_UNSIGNED_INT, nullptr);
   glReadPixels(pos(0), pos(1), 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT,
-               reinterpret_cast<void *>(sizeof(std::uint32_t)));
+               reinterpret_cast<void *>(2 * sizeof(std::uint32_t)));
   assertGL("Failed to read depth value under cursor");
 
-  // map selection (front) buffer and read index and depth value
+  // map selection (front) buffer and read index, instance and depth value
   auto const readBinding = GL::binding(
       *selectionBuffer_.readBuffer, static_cast<GLenum>(GL_PIXEL_PACK_BUFFER));
   void const *mappedMemory = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
@@ -754,9 +1189,11 @@ VisualizerImpl::getGeometryUnderCursor() {
   Expects(mappedMemory != nullptr);
 
   auto const index = *reinterpret_cast<std::uint32_t const *>(mappedMemory);
+  auto const instance =
+      *(reinterpret_cast<std::uint32_t const *>(mappedMemory) + 1);
   auto const normalizedDepth = *reinterpret_cast<float const *>(
       reinterpret_cast<std::uint8_t const *>(mappedMemory) +
-      sizeof(std::uint32_t));
+      2 * sizeof(std::uint32_t));
   glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
   selectionBuffer_.swap();
 
@@ -782,7 +1219,79 @@ VisualizerImpl::getGeometryUnderCursor() {
   auto const posInWorld =
       cameraClient().unproject(mousePos, depthInCamera, cachedScale);
 
-  return GeometryNameAndPosition{name, posInWorld, depthInCamera};
+  return GeometryNameAndPosition{name, instance, posInWorld, depthInCamera};
+}
+
+void VisualizerImpl::updatePickScene() {
+  Length const rScale = cachedScale;
+
+  auto scene = std::make_shared<PickScene>();
+  std::vector<BVH::Box> boxes;
+  for (auto const &geom : geometries_) {
+    auto triangles = geom.second->triangleBVH();
+    if (!triangles) continue;
+
+    auto &geometry = *geom.second;
+    auto const &worldBox = geometry.worldBounds(rScale);
+    if (worldBox.isEmpty()) continue;
+
+    auto const destScale = static_cast<float>(geometry.scale / rScale);
+    Eigen::Affine3f const modelToWorld =
+        Eigen::Translation3f(geometry.position) * geometry.orientation *
+        Eigen::Scaling(destScale);
+
+    boxes.push_back(worldBox);
+    scene->entries.push_back(
+        {geom.first, modelToWorld.inverse().matrix(), std::move(triangles)});
+  }
+  scene->bvh = BVH(boxes);
+  scene->inverseViewProjectionMatrix =
+      cameraClient().viewProjectionMatrix(rScale).inverse();
+  scene->windowSize = windowSize();
+
+  std::atomic_store(&pickScene_,
+                    std::shared_ptr<PickScene const>(std::move(scene)));
+}
+
+Visualizer::PickResult
+VisualizerImpl::pick(Position2 const &windowPosition) const {
+  Visualizer::PickResult result;
+  auto const scene = std::atomic_load(&pickScene_);
+  if (!scene || scene->entries.empty() ||
+      (scene->windowSize.array() <= 0.f).any())
+    return result;
+
+  // Cast a ray from the near plane through the window position. The
+  // projection uses reversed depth, i.e. the near plane is at depth 1.
+  auto const x = 2.f * windowPosition(0) / scene->windowSize(0) - 1.f;
+  auto const y = 1.f - 2.f * windowPosition(1) / scene->windowSize(1);
+  auto const unprojectAt = [&](float depth) -> Position {
+    PositionH const p =
+        scene->inverseViewProjectionMatrix * PositionH(x, y, depth, 1.f);
+    return p.head<3>() / p(3);
+  };
+  Ray ray;
+  ray.origin = unprojectAt(1.f);
+  ray.direction = unprojectAt(0.5f) - ray.origin;
+
+  auto distance = std::numeric_limits<float>::infinity();
+  scene->bvh.traverse(ray, distance, [&](std::uint32_t i, float &maxDistance) {
+    auto const &entry = scene->entries[i];
+    // Affine transformations keep the distances along the ray
+    Ray const modelRay{
+        (entry.worldToModel * ray.origin.homogeneous()).head<3>(),
+        entry.worldToModel.block<3, 3>(0, 0) * ray.direction};
+
+    TriangleBVH::Hit hit;
+    if (!entry.triangles->intersect(modelRay, maxDistance, hit)) return;
+    maxDistance = hit.distance;
+    result.geometry = entry.name;
+    result.triangle = hit.triangle;
+    result.barycentrics = hit.barycentrics;
+  });
+  if (result) result.position = ray.origin + distance * ray.direction;
+
+  return result;
 }
 
 void VisualizerImpl::dragSelectedGeometry() {
@@ -810,6 +1319,7 @@ void VisualizerImpl::dragSelectedGeometry() {
 
   selectedPoint_ += maskedMoveDelta;
   geometry.position += maskedMoveDelta;
+  if (!maskedMoveDelta.isZero()) markInteraction();
 }
 
 void VisualizerImpl::renderFullscreenQuad(TextureID texture,
@@ -833,6 +1343,7 @@ void VisualizerImpl::renderQuad(Point2 const &topLeft, Size2 const &size,
   prog.use();
   prog["topLeft"] = topLeftClipsSpace;
   prog["size"] = sizeClipSpace;
+  prog["texcoordScale"] = textureScale();
   prog["tex"] = 0;
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_2D, textures_[texture]);
@@ -848,66 +1359,28 @@ void VisualizerImpl::renderQuad(Point2 const &topLeft, Size2 const &size,
 
 void VisualizerImpl::renderLights() {
 
-  auto depthBinding =
-      GL::binding(lightingFbo_, static_cast<GLenum>(GL_READ_FRAMEBUFFER));
   auto fboBinding =
-      GL::binding(finalFbo_, static_cast<GLenum>(GL_DRAW_FRAMEBUFFER));
-
-  glClearDepth(0.f);
-  glClear(GL_DEPTH_BUFFER_BIT);
-  renderAmbientLighting();
-
-  glBlendFunc(GL_ONE, GL_ONE);
-  glEnable(GL_BLEND);
-
-  renderDiffuseLighting();
-
-  renderSpecularLighting();
-
-  glDisable(GL_BLEND);
-
-  // blit the depth attachment
-  auto const w = static_cast<GLint>(glfw_.width());
-  auto const h = static_cast<GLint>(glfw_.height());
-  glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-  assertGL("Failed to blit framebuffer");
-}
-
-void VisualizerImpl::renderAmbientLighting() {
-  std::lock_guard<std::mutex> lock(lightMutex_);
-  Color ambientColor = Color::Zero();
-
-  for (auto const &l : lights_) {
-    ambientColor += l.second.ambientFactor * l.second.color;
-  }
-
-  // Ambient pass
-  shaders_["ambientPass"].use();
-  shaders_["ambientPass"]["lightColor"] = ambientColor;
-  shaders_["ambientPass"]["indexTex"] = 1;
-
-  glActiveTexture(GL_TEXTURE1);
-  glBindTexture(GL_TEXTURE_2D, textures_[TextureID::SelectionTexture]);
-
-  renderFullscreenQuad(TextureID::Albedo, shaders_["ambientPass"]);
-}
-
-void VisualizerImpl::renderDiffuseLighting() {
-  std::lock_guard<std::mutex> lock(lightMutex_);
-
-  Length const scale = cachedScale;
-  auto const viewMat = cameraClient().viewMatrix(scale);
-
-  shaders_["diffuseLightingPass"].use();
-  shaders_["diffuseLightingPass"]["normalAndSpecularTex"] = 0;
-  shaders_["diffuseLightingPass"]["albedoTex"] = 1;
-  shaders_["diffuseLightingPass"]["indexTex"] = 2;
-  shaders_["diffuseLightingPass"]["topLeft"] = Eigen::Vector2f(-1, 1);
-  shaders_["diffuseLightingPass"]["size"] =
-      (2 * Eigen::Vector2f::Ones()).eval();
+      GL::binding(shadedFbo_, static_cast<GLenum>(GL_DRAW_FRAMEBUFFER));
+
+  uploadLightUniforms();
+
+  // A single pass applies the ambient, diffuse and specular lighting of all
+  // lights, so every texel of the G-buffer is read once
+  auto &program = shaders_[Program::LightingPass];
+  program.use();
+  program["normalTex"] = 0;
+  program["albedoTex"] = 1;
+  program["indexTex"] = 2;
+  program["depthTex"] = 3;
+  program["lightTiles"] = 4;
+  program["lightIndices"] = 5;
+  program["materialTex"] = 6;
+  program["topLeft"] = Eigen::Vector2f(-1, 1);
+  program["size"] = (2 * Eigen::Vector2f::Ones()).eval();
+  program["texcoordScale"] = textureScale();
 
   glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, textures_[TextureID::NormalsAndSpecular]);
+  glBindTexture(GL_TEXTURE_2D, textures_[TextureID::Normals]);
 
   glActiveTexture(GL_TEXTURE1);
   glBindTexture(GL_TEXTURE_2D, textures_[TextureID::Albedo]);
@@ -915,65 +1388,115 @@ void VisualizerImpl::renderDiffuseLighting() {
   glActiveTexture(GL_TEXTURE2);
   glBindTexture(GL_TEXTURE_2D, textures_[TextureID::SelectionTexture]);
 
-  auto boundVao = GL::binding(singleVertexData_.vao);
-
-  for (auto const &lightEntry : lights_) {
-    auto const &light = lightEntry.second;
+  glActiveTexture(GL_TEXTURE3);
+  glBindTexture(GL_TEXTURE_2D, textures_[TextureID::Depth]);
 
-    Expects(std::fabs(light.position(3)) < 1e-3f);
+  glActiveTexture(GL_TEXTURE4);
+  glBindTexture(GL_TEXTURE_BUFFER, lightTileTextures_.names[0]);
 
-    PositionH const lightPosition = (viewMat * light.position);
+  glActiveTexture(GL_TEXTURE5);
+  glBindTexture(GL_TEXTURE_BUFFER, lightTileTextures_.names[1]);
 
-    shaders_["diffuseLightingPass"]["lightPosition"] =
-        lightPosition.head<3>().eval();
-    shaders_["diffuseLightingPass"]["lightColor"] = light.color;
+  glActiveTexture(GL_TEXTURE6);
+  glBindTexture(GL_TEXTURE_2D, textures_[TextureID::Material]);
+  glActiveTexture(GL_TEXTURE0);
 
-    // draw quad using the geometry shader
-    glDrawArrays(GL_POINTS, 0, 1);
-    assertGL("glDrawArrays failed");
-  }
+  // draw quad using the geometry shader
+  auto boundVao = GL::binding(singleVertexData_.vao);
+  glDisable(GL_DEPTH_TEST);
+  glDrawArrays(GL_POINTS, 0, 1);
+  assertGL("glDrawArrays failed");
 }
 
-void VisualizerImpl::renderSpecularLighting() {
-  std::lock_guard<std::mutex> lock(lightMutex_);
-
+void VisualizerImpl::uploadLightUniforms() {
   Length const scale = cachedScale;
   auto const viewMat = cameraClient().viewMatrix(scale);
 
-  shaders_["specularLightingPass"].use();
-  shaders_["specularLightingPass"]["normalAndSpecularTex"] = 0;
-  shaders_["specularLightingPass"]["albedoTex"] = 1;
-  shaders_["specularLightingPass"]["indexTex"] = 2;
-  shaders_["specularLightingPass"]["topLeft"] = Eigen::Vector2f(-1, 1);
-  shaders_["specularLightingPass"]["size"] =
-      (2 * Eigen::Vector2f::Ones()).eval();
-
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, textures_[TextureID::NormalsAndSpecular]);
-
-  glActiveTexture(GL_TEXTURE1);
-  glBindTexture(GL_TEXTURE_2D, textures_[TextureID::Albedo]);
-
-  glActiveTexture(GL_TEXTURE2);
-  glBindTexture(GL_TEXTURE_2D, textures_[TextureID::SelectionTexture]);
-
-  auto boundVao = GL::binding(singleVertexData_.vao);
-
-  for (auto const &lightEntry : lights_) {
-    auto const &light = lightEntry.second;
-
-    Expects(std::fabs(light.position(3)) < 1e-3f);
-
-    PositionH const lightPosition = (viewMat * light.position);
-
-    shaders_["specularLightingPass"]["lightPosition"] =
-        lightPosition.head<3>().eval();
-    shaders_["specularLightingPass"]["lightColor"] = light.color;
-
-    // draw quad using the geometry shader
-    glDrawArrays(GL_POINTS, 0, 1);
-    assertGL("glDrawArrays failed");
+  LightUniforms uniforms;
+  lightCuller_.reset(renderSize_, projectionMatrix_);
+  Color ambientColor = Color::Zero();
+  GLuint count = 0;
+  GLuint directionalCount = 0;
+  {
+    std::lock_guard<std::mutex> lock(lightMutex_);
+    // directional lights come first, since they are applied to all pixels
+    for (auto const &lightEntry : lights_) {
+      auto const &light = lightEntry.second;
+      ambientColor += light.ambientFactor * light.color;
+      if (std::fabs(light.position(3)) >= 1e-3f) continue;
+
+      PositionH const lightPosition = (viewMat * light.position);
+      Eigen::Vector3f const direction = lightPosition.head<3>().normalized();
+
+      auto &entry = uniforms.lights[count++];
+      entry.position = {{direction(0), direction(1), direction(2), 0.f}};
+      entry.color = {{light.color(0), light.color(1), light.color(2), 0.f}};
+      entry.spot = {{0.f, 0.f, 0.f, -2.f}};
+    }
+    directionalCount = count;
+
+    for (auto const &lightEntry : lights_) {
+      auto const &light = lightEntry.second;
+      if (std::fabs(light.position(3)) < 1e-3f || light.range <= 0.f)
+        continue;
+
+      PositionH const lightPosition =
+          viewMat * (light.position / light.position(3));
+      Eigen::Vector3f const position = lightPosition.head<3>();
+      if (!lightCuller_.addLight(narrow_cast<std::uint16_t>(count), position,
+                                 light.range))
+        continue;
+
+      Eigen::Vector3f const spotDirection =
+          (viewMat.block<3, 3>(0, 0) * light.spotDirection).normalized();
+      auto const cosCutoff =
+          light.spotCutoff >= M_PI
+              ? -2.f
+              : static_cast<float>(std::cos(light.spotCutoff));
+
+      auto &entry = uniforms.lights[count++];
+      entry.position = {{position(0), position(1), position(2), 1.f}};
+      entry.color = {
+          {light.color(0), light.color(1), light.color(2), light.range}};
+      entry.spot = {
+          {spotDirection(0), spotDirection(1), spotDirection(2), cosCutoff}};
+    }
   }
+  lightCuller_.assign();
+
+  Matrix4 const inverseProjection = projectionMatrix_.inverse();
+  uniforms.inverseProjectionMatrix = inverseProjection;
+  uniforms.ambientColor = {{ambientColor(0), ambientColor(1), ambientColor(2)}};
+  uniforms.directionalLightCount = directionalCount;
+  uniforms.depthRange = {{depthRange_.near, depthRange_.far}};
+  uniforms.tileCountX = narrow_cast<GLuint>(lightCuller_.tileCount()(0));
+  uniforms.tileSize = static_cast<GLuint>(LightCuller::kTileSize);
+
+  // only the used part of the array is uploaded
+  auto const size = offsetof(LightUniforms, lights) +
+                    count * sizeof(LightUniforms::Entry);
+  auto const bufferBinding = GL::binding(
+      lightUniformBuffer_, static_cast<GLenum>(GL_UNIFORM_BUFFER));
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, static_cast<GLsizeiptr>(size),
+                  &uniforms);
+  glBindBufferBase(GL_UNIFORM_BUFFER, static_cast<GLuint>(UniformBlock::Lights),
+                   lightUniformBuffer_.name);
+
+  // The buffers are orphaned, so that writing them does not wait for the
+  // lighting pass of the previous frame. The index buffer is never empty,
+  // since buffer textures need a data store.
+  auto const &tiles = lightCuller_.tiles();
+  auto const &indices = lightCuller_.indices();
+  std::uint16_t const noIndex = 0;
+  lightTileBuffer_.upload(GL_TEXTURE_BUFFER,
+                          tiles.size() * sizeof(LightCuller::Tile),
+                          tiles.data(), GL_STREAM_DRAW);
+  lightIndexBuffer_.upload(
+      GL_TEXTURE_BUFFER,
+      std::max<std::size_t>(indices.size(), 1) * sizeof(std::uint16_t),
+      indices.empty() ? &noIndex : indices.data(), GL_STREAM_DRAW);
+  GL::Buffer::unbind(GL_TEXTURE_BUFFER);
+  assertGL("Failed to upload light uniforms");
 }
 
 } // namespace Private_
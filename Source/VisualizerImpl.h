@@ -2,13 +2,20 @@
 #define VolViz_VisualizerImpl_h
 
 #include "AtomicCache.h"
+#include "BVH.h"
 #include "GL/Binding.h"
 #include "GL/Buffer.h"
 #include "GL/Framebuffer.h"
 #include "GL/GLFW.h"
+#include "GL/Queries.h"
 #include "GL/Textures.h"
 #include "GL/VertexArray.h"
 #include "GeometryFactory.h"
+#include "LightCuller.h"
+#include "MeshPool.h"
+#include "QualityController.h"
+#include "RenderTargetPool.h"
+#include "ResolutionController.h"
 #include "Shaders.h"
 #include "Types.h"
 
@@ -19,9 +26,11 @@
 
 #include <atomic>
 #include <chrono>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 namespace VolViz {
 namespace Private_ {
@@ -59,6 +68,7 @@ public:
   inline void addGeometry(Visualizer::GeometryName name,
                           Descriptor const &descriptor) {
     geometryInitQueue_.enqueue({name, geomFactory_.create(descriptor)});
+    markSceneChanged();
   }
 
   template <class Descriptor,
@@ -80,9 +90,25 @@ public:
     }
 
     search->second->enqueueUpdate(std::forward<Descriptor>(descriptor));
+    markSceneChanged();
     return true;
   }
 
+  /// Requests the next frame to be rendered, since something that is visible
+  /// changed. Can be called from any thread, but must be called after the
+  /// change was made or enqueued. Wakes up the render thread if it waits for
+  /// events, several changes before the next frame wake it up only once.
+  inline void markSceneChanged() noexcept {
+    if (!sceneChanged_.exchange(true)) glfw_.postEmptyEvent();
+  }
+
+  /// Like markSceneChanged, for changes made by the user moving the camera
+  /// or a geometry. The quality is lowered until the interaction stopped.
+  inline void markInteraction() noexcept {
+    interacting_ = true;
+    markSceneChanged();
+  }
+
   /// Convenience method for easy camera access
   inline Camera const &camera() const noexcept { return visualizer_->camera; }
   inline Camera &camera() noexcept { return visualizer_->camera; }
@@ -91,7 +117,57 @@ public:
 
   inline Shaders &shaders() noexcept { return shaders_; }
 
-  void attachVolumeToShader(GL::ShaderProgram &shader) const;
+  /// Shared buffers of the meshes
+  inline MeshPool &meshPool() noexcept { return meshPool_; }
+
+  /// Records the ACMR of a mesh that was optimized for rendering, which is
+  /// reported by the render statistics. Must be called on the render thread.
+  void meshOptimized(float cacheMissRatioBefore,
+                     float cacheMissRatioAfter) noexcept;
+
+  /// Returns the size of the render window in pixels
+  inline Size2 windowSize() const noexcept {
+    return Size2(glfw_.width(), glfw_.height());
+  }
+
+  /// Returns the size of the window's framebuffer in pixels. It is larger
+  /// than the window size on high resolution displays.
+  inline Size2 framebufferSize() const noexcept {
+    return Size2(glfw_.framebufferWidth(), glfw_.framebufferHeight());
+  }
+
+  /// Returns the size of the rendered image in pixels. It is smaller than the
+  /// window if the resolution is scaled down to hold the target frame time.
+  inline Size2 renderSize() const noexcept { return renderSize_; }
+
+  /// Returns the projection matrix of the current frame, which is offset by
+  /// a fraction of a pixel if frames are accumulated
+  inline Matrix4 const &projectionMatrix() const noexcept {
+    return projectionMatrix_;
+  }
+
+  /// Returns the view projection matrix of the current frame, with the same
+  /// offset as the projection matrix
+  inline Matrix4 viewProjectionMatrix(Length scale) const {
+    return projectionMatrix_ * cameraClient().viewMatrix(scale);
+  }
+
+  /// Returns how many levels coarser meshes are rendered in the current frame
+  inline std::size_t levelOfDetailBias() const noexcept {
+    return quality_.levelOfDetailBias();
+  }
+
+  /// @see Visualizer::selection
+  inline Visualizer::Selection selection() const { return selection_; }
+
+  /// Finds the mesh triangle under a window position
+  /// @see Visualizer::pick
+  Visualizer::PickResult pick(Position2 const &windowPosition) const;
+
+  /// @see Visualizer::renderStatistics
+  inline Visualizer::RenderStatistics renderStatistics() const {
+    return renderStatistics_;
+  }
 
   /// Issues an OpenGL draw call with a single vertex.
   /// This comes in handy if all the geometry is created by a geometry shader
@@ -125,31 +201,69 @@ private:
   using TimePoint = std::chrono::time_point<Clock>;
   using GeometryNameAndPosition = struct {
     Visualizer::GeometryName name;
+    std::uint32_t instance;
     Position position;
     float depth;
   };
 
   /// IDs for the auxiliary textures used for the deferred rendering
   enum class TextureID : std::size_t {
-    NormalsAndSpecular = 0,
+    Normals = 0,
     Albedo = 1,
     Depth = 2,
     RenderedImage = 3,
-    FinalDepth = 4,
+    Material = 4,
     VolumeTexture = 5,
-    SelectionTexture = 6
+    SelectionTexture = 6,
+    AccumulatedImage = 7
   };
 
-  /// Setup the required textures and frabebuffer objects for rendering
+  /// Setup the required textures and frabebuffer objects for rendering, with
+  /// the capacity of the render target pool
   void setupFBOs();
 
+  /// Setup the vertex array used to draw a single point
+  void setupSingleVertexData();
+
   /// Setup selection buffers
   void setupSelectionBuffers();
 
+  /// Setup the buffers backing the uniform blocks of the geometry shaders
+  void setupUniformBuffers();
+
+  /// Writes the uniforms shared by all geometries of the frame
+  void uploadFrameUniforms();
+
+  /// Writes the object uniforms of all queued geometries at once
+  void uploadObjectUniforms();
+
+  /// Reads the GPU time of an earlier frame, adjusts the render scale and
+  /// starts measuring the current frame
+  void beginFrameTimer();
+
+  /// Stops measuring the GPU time of the current frame
+  void endFrameTimer();
+
+  /// Computes the render size and the projection matrix of the frame from
+  /// the scales of the resolution and quality controllers
+  void updateRenderSize();
+
+  /// Blends the rendered image into the image accumulated over the last
+  /// frames
+  void accumulateImage();
+
+  /// Returns the part of the render targets covered by the rendered image
+  inline Size2 textureScale() const noexcept {
+    return renderSize_.cwiseQuotient(renderTargets_.allocatedSize());
+  }
+
   /// Unprojects a point in screen coordinates and a given depth to a 3D point
   /// in world space
   Position unproject(Position2 const &screenPoint, float depth) const noexcept;
 
+  /// Processes the window events, waits for events if block is true
+  void processEvents(bool block);
+
   /// Key input handler
   void handleKeyInput(int key, int scancode, int action, int mode);
 
@@ -178,18 +292,17 @@ private:
   /// Defferred shading lighing pass
   void renderLights();
 
-  void renderAmbientLighting();
-  void renderDiffuseLighting();
-  void renderSpecularLighting();
-
-  void renderLightDiffuse(Light const &light);
-
-  void renderLightSpecular(Light const &light);
+  /// Uploads the lights to the LightUniforms block and assigns the point and
+  /// spot lights to the screen tiles
+  void uploadLightUniforms();
 
   void renderSelectionIndexTexture();
 
   GeometryNameAndPosition getGeometryUnderCursor();
 
+  /// Publishes the pickable geometries and the camera of the current frame
+  void updatePickScene();
+
   void dragSelectedGeometry();
 
   /// Renders the final image to screen
@@ -225,12 +338,26 @@ private:
       return textures_.names[static_cast<std::size_t>(id)];
     }
 
+    /// Replaces the texture by a new one, since textures with immutable
+    /// storage cannot be reallocated
+    inline void recreate(TextureID id) noexcept {
+      auto &name = textures_.names[static_cast<std::size_t>(id)];
+      glDeleteTextures(1, &name);
+      glGenTextures(1, &name);
+    }
+
   private:
-    GL::Textures<7> textures_;
+    GL::Textures<8> textures_;
   } textures_;
-  /// Frabebuffer used for the deferred shading
+  /// Whether the render targets were set up with the compact G-buffer
+  bool compactGBuffer_{false};
+  /// Frabebuffer used for the deferred shading. The lighting pass renders to
+  /// the shaded framebuffer, the overlays to the final one, which shares the
+  /// rendered image and the depth of the geometry stage.
+  GL::Framebuffer shadedFbo_{0};
   GL::Framebuffer finalFbo_{0};
   GL::Framebuffer lightingFbo_{0};
+  GL::Framebuffer accumulationFbo_{0};
 
   /// Pixel buffers used for mouse picking
   struct SelectionBuffer {
@@ -245,13 +372,106 @@ private:
     }
   } selectionBuffer_;
 
+  /// @defgroup changeGroup Scene change tracking
+  /// @{
+  /// Set whenever something visible changes, frames are skipped while it is
+  /// not set. Declared before the geometries, since their background jobs
+  /// set it until they are destroyed.
+  std::atomic<bool> sceneChanged_{true};
+  /// Set if the change was made by an interaction of the user
+  std::atomic<bool> interacting_{false};
+  /// Cursor position of the pending selection read back
+  Position2 selectionMousePos_{Position2::Zero()};
+  ///@}
+
   /// @defgroup geomGroup Geometry processing related variables
   /// @{
+  /// Declared before the geometries, so that the meshes release their
+  /// allocations before it is destroyed
+  MeshPool meshPool_;
   GeometryList geometries_;
   std::mutex geometriesMutex_;
   GeometryInitQueue geometryInitQueue_;
+
+  /// Visible geometries of the current frame, sorted by their render state
+  struct RenderQueueEntry {
+    Geometry::RenderState state;
+    /// Selection index of the geometry
+    std::uint32_t index;
+    Geometry *geometry;
+    bool selected;
+  };
+  std::vector<RenderQueueEntry> renderQueue_;
+
+  /// Buffers backing the FrameUniforms, ObjectUniforms and LightUniforms
+  /// blocks. The object uniforms of the queued geometries are stored one after
+  /// another, each geometry binds its own range.
+  GL::Buffer frameUniformBuffer_{0};
+  GL::Buffer objectUniformBuffer_{0};
+  GL::Buffer lightUniformBuffer_{0};
+  /// Light lists of the screen tiles, read by the lighting pass through
+  /// buffer textures
+  LightCuller lightCuller_;
+  GL::Buffer lightTileBuffer_{0};
+  GL::Buffer lightIndexBuffer_{0};
+  GL::Textures<2> lightTileTextures_{0};
+  /// Distance between the object uniforms of two geometries, respects the
+  /// offset alignment of uniform buffer ranges
+  std::size_t objectUniformStride_{0};
+  /// Number of geometries the object uniform buffer has room for
+  std::size_t objectUniformCapacity_{0};
+  ///@}
+
+  /// Snapshot of the pickable geometries and the camera of the last frame.
+  /// The render thread replaces it as a whole, so picking from other threads
+  /// never waits for rendering.
+  struct PickScene {
+    struct Entry {
+      Visualizer::GeometryName name;
+      /// Transformation from world to model coordinates
+      Matrix4 worldToModel;
+      std::shared_ptr<TriangleBVH const> triangles;
+    };
+    std::vector<Entry> entries;
+    /// BVH over the world space bounding boxes of the entries
+    BVH bvh;
+    Matrix4 inverseViewProjectionMatrix{Matrix4::Identity()};
+    Size2 windowSize{Size2::Zero()};
+  };
+  std::shared_ptr<PickScene const> pickScene_;
+
+  /// @defgroup resolutionGroup Dynamic resolution
+  /// @{
+  ResolutionController resolutionController_;
+  QualityController quality_;
+  /// Scale of the current frame, the smaller scale of both controllers
+  float renderScale_{1.f};
+  /// Size of the rendered image, the scene is rendered to the lower left
+  /// part of the render targets
+  Size2 renderSize_{Size2::Zero()};
+  /// Allocation policy of the render targets
+  RenderTargetPool renderTargets_;
+  Matrix4 projectionMatrix_{Matrix4::Identity()};
+  /// GPU timer queries of the last frames, their results are read a few
+  /// frames later to not wait for the GPU
+  static constexpr std::size_t kFrameTimers = 3;
+  GL::Queries<kFrameTimers> frameTimers_;
+  std::array<bool, kFrameTimers> frameTimerPending_{{false, false, false}};
+  /// Ratio of the scale of the resolution controller to the render scale of
+  /// the timed frames
+  std::array<double, kFrameTimers> frameTimerScaleRatio_{{1.0, 1.0, 1.0}};
+  std::size_t currentFrameTimer_{0};
   ///@}
 
+  /// Statistics of the last frame, written by the render thread
+  AtomicWrapper<Visualizer::RenderStatistics> renderStatistics_{
+      Visualizer::RenderStatistics{}};
+
+  /// Number of meshes optimized for rendering and the sums of their ACMR
+  /// before and after the optimization
+  std::size_t optimizedMeshes_{0};
+  std::array<float, 2> cacheMissRatioSums_{{0.f, 0.f}};
+
   /// Data representing a single vertex, required by the grid and fullscreen
   /// quad renderer
   struct SingleVertData {
@@ -267,7 +487,10 @@ private:
 
   bool inSelectionMode{false};
   Visualizer::GeometryName selectedGeometry_;
+  std::uint32_t selectedInstance_{0};
   Position selectedPoint_{Position::Zero()};
+  /// Copy of the selected geometry and instance for other threads
+  AtomicWrapper<Visualizer::Selection> selection_{Visualizer::Selection{}};
 
   /// Lights
   Lights lights_;
@@ -0,0 +1,54 @@
+#include "WorkerPool.h"
+#include "Types.h"
+
+#include <algorithm>
+
+namespace VolViz {
+namespace Private_ {
+
+WorkerPool &WorkerPool::shared() {
+  static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()));
+  return pool;
+}
+
+WorkerPool::WorkerPool(std::size_t nThreads) {
+  Expects(nThreads > 0);
+  threads_.reserve(nThreads);
+  for (std::size_t i = 0; i < nThreads; ++i)
+    threads_.emplace_back([this]() { run(); });
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    tasks_.clear();
+  }
+  condition_.notify_all();
+  for (auto &thread : threads_) thread.join();
+}
+
+void WorkerPool::enqueue(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+  condition_.notify_one();
+}
+
+void WorkerPool::run() {
+  for (;;) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+      if (stopping_) return;
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+} // namespace Private_
+} // namespace VolViz
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace VolViz {
+namespace Private_ {
+
+/// Fixed set of threads that run background jobs in the order they were
+/// submitted.
+///
+/// All geometries share one pool, so that adding many geometries at once
+/// queues their jobs instead of starting a thread per job. Tasks that are
+/// still queued when the pool is destroyed are discarded, their futures
+/// report a broken promise.
+class WorkerPool {
+public:
+  /// Pool shared by the jobs of all geometries, with one thread per hardware
+  /// thread
+  static WorkerPool &shared();
+
+  explicit WorkerPool(std::size_t nThreads);
+
+  ~WorkerPool();
+
+  WorkerPool(WorkerPool const &) = delete;
+  WorkerPool &operator=(WorkerPool const &) = delete;
+
+  /// Queues the function, the future becomes ready once it returned. Unlike
+  /// the future of std::async, it does not wait for the function when it is
+  /// destroyed.
+  template <class F> std::future<void> submit(F &&f) {
+    auto task =
+        std::make_shared<std::packaged_task<void()>>(std::forward<F>(f));
+    auto future = task->get_future();
+    enqueue([task]() { (*task)(); });
+    return future;
+  }
+
+  /// Calls both functions and returns once both returned. The first one is
+  /// queued, the second one is called by this thread. If no worker started
+  /// the first function until then, this thread calls it as well. Tasks of
+  /// the pool can thus split their work without waiting for queued tasks,
+  /// which could deadlock the pool.
+  template <class F1, class F2> void invoke(F1 &&f1, F2 &&f2) {
+    auto task =
+        std::make_shared<std::packaged_task<void()>>(std::forward<F1>(f1));
+    auto future = task->get_future();
+    auto claimed = std::make_shared<std::atomic<bool>>(false);
+    enqueue([task, claimed]() {
+      if (!claimed->exchange(true)) (*task)();
+    });
+
+    try {
+      std::forward<F2>(f2)();
+    } catch (...) {
+      // the queued function must not outlive the caller's stack frame
+      if (claimed->exchange(true)) future.wait();
+      throw;
+    }
+    if (!claimed->exchange(true)) (*task)();
+    future.get();
+  }
+
+  inline std::size_t size() const noexcept { return threads_.size(); }
+
+private:
+  void enqueue(std::function<void()> task);
+
+  /// Loop of the worker threads
+  void run();
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<std::function<void()>> tasks_;
+  bool stopping_{false};
+  std::vector<std::thread> threads_;
+};
+
+} // namespace Private_
+} // namespace VolViz
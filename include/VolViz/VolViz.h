@@ -1,6 +1,7 @@
 #ifndef VolViz_h
 #define VolViz_h
 
+#include "MeshIO.h"
 #include "Visualizer.h"
 
 #endif // VolViz_h
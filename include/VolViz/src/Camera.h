@@ -5,6 +5,8 @@
 #include "AtomicWrapper.h"
 #include "Types.h"
 
+#include <functional>
+
 namespace VolViz {
 
 namespace Private_ {
@@ -37,6 +39,9 @@ public:
   /// Aspect ratio (width / height) or horizontal FOV / vertical FOV
   Property<float> aspectRatio{4.f / 3.f};
 
+  /// Action that's called right after any of the properties was set
+  std::function<void()> afterChange;
+
   /// Returns a client object that can be used to access cached projection and
   /// view matrices, as well as methods like unprojecting.
   /// @see CameraClient
@@ -97,7 +102,10 @@ namespace Private_ {
 class VisualizerImpl;
 class AxisAlignedPlane;
 class Cube;
+class InstancedCubes;
 class Mesh;
+class PointCloud;
+class Polyline;
 
 class CameraClient {
   friend class VisualizerImpl;
@@ -107,7 +115,10 @@ class CameraClient {
   // workaround. TODO: find a better solution
   friend class AxisAlignedPlane;
   friend class Cube;
+  friend class InstancedCubes;
   friend class Mesh;
+  friend class PointCloud;
+  friend class Polyline;
 
   CameraClient(Camera const &cam) : cam_(cam) {}
 
@@ -2,6 +2,8 @@
 
 #include "Types.h"
 
+#include <vector>
+
 #pragma clang diagnostic ignored "-Wpadded"
 
 namespace VolViz {
@@ -79,6 +81,40 @@ public:
   Eigen::Matrix<float, Eigen::Dynamic, 3> vertices;
   Eigen::Matrix<std::uint32_t, Eigen::Dynamic, 3> indices;
   Length scale{1 * milli * meter};
+
+  /// If set, simplified versions of the mesh are generated in the background
+  /// and the level of detail is selected at render time depending on the
+  /// projected size of the mesh.
+  bool generateLevelsOfDetail{false};
+
+  /// Triangle count of each generated level of detail relative to the full
+  /// resolution mesh. Must be in decreasing order.
+  std::vector<float> levelOfDetailRatios{0.5f, 0.25f, 0.1f, 0.03f};
+
+  /// If set, the triangles and vertices are reordered in the background to
+  /// improve the vertex cache hit rate and to reduce overdraw. The mesh is
+  /// rendered unoptimized until the optimization is finished.
+  bool optimizeForRendering{false};
+
+  /// If set, back facing triangles are not rendered. Only use this for closed
+  /// meshes with counter-clockwise winding.
+  bool cullBackFaces{false};
+
+  /// Scalar of each vertex, e.g. a wall thickness or a simulation result. If
+  /// empty, color is used for the whole mesh, otherwise the scalars are mapped
+  /// from scalarRange through the colormap.
+  Eigen::Matrix<float, Eigen::Dynamic, 1> scalars;
+  Range<float> scalarRange{0.f, 1.f};
+  Colormap colormap{Colormaps::CoolWarm()};
+
+  /// Parts of a mesh that can be replaced separately
+  enum class Part { All, Scalars, Colormap };
+
+  /// Part of the mesh that is replaced by an update, the rest is kept. For
+  /// Scalars only scalars, scalarRange and colormap are used, and scalars must
+  /// be empty or have a row for each vertex of the mesh. For Colormap only
+  /// scalarRange and colormap are used. Neither touches the vertex positions.
+  Part update{Part::All};
 };
 
 /// A geomentry descriptor describing an axis aligned cube
@@ -99,4 +135,108 @@ public:
   Scale radius = 0.5f;
 };
 
+/// A geometry descriptor describing many axis aligned cubes, e.g. markers,
+/// that are rendered with a single draw call.
+///
+/// The color of the descriptor is used for all cubes if no per instance
+/// colors are given. When picked, the index of the cube under the cursor is
+/// recorded and the cube is highlighted.
+class InstancedCubesDescriptor : public GeometryDescriptor {
+public:
+  virtual ~InstancedCubesDescriptor();
+
+  InstancedCubesDescriptor() = default;
+  InstancedCubesDescriptor(InstancedCubesDescriptor const &) = default;
+  InstancedCubesDescriptor(InstancedCubesDescriptor &&) = default;
+
+  InstancedCubesDescriptor &
+  operator=(InstancedCubesDescriptor const &) = default;
+  InstancedCubesDescriptor &operator=(InstancedCubesDescriptor &&) = default;
+
+  /// Center of each cube, in units of scale
+  Eigen::Matrix<float, Eigen::Dynamic, 3> positions;
+  /// Radius of each cube. If empty, radius is used for all cubes.
+  Eigen::Matrix<float, Eigen::Dynamic, 1> radii;
+  /// Color of each cube. If empty, color is used for all cubes.
+  Eigen::Matrix<float, Eigen::Dynamic, 3> colors;
+
+  Length scale{1 * milli * meter};
+  Scale radius = 0.5f;
+
+  /// If set, an update only replaces the cubes [firstInstance,
+  /// firstInstance + positions.rows()), all other cubes are kept. The updated
+  /// range must not exceed the number of existing cubes. If not set, all cubes
+  /// are replaced.
+  bool partialUpdate{false};
+  std::size_t firstInstance{0};
+};
+
+/// A geometry descriptor describing a large set of points, e.g. particles or
+/// cell centroids. Each point is rendered as a small sphere.
+///
+/// The points are sorted spatially in the background and split into chunks,
+/// that are culled individually. The color of the descriptor is used for all
+/// points if no per point colors are given.
+class PointCloudDescriptor : public GeometryDescriptor {
+public:
+  virtual ~PointCloudDescriptor();
+
+  PointCloudDescriptor() = default;
+  PointCloudDescriptor(PointCloudDescriptor const &) = default;
+  PointCloudDescriptor(PointCloudDescriptor &&) = default;
+
+  PointCloudDescriptor &operator=(PointCloudDescriptor const &) = default;
+  PointCloudDescriptor &operator=(PointCloudDescriptor &&) = default;
+
+  Eigen::Matrix<float, Eigen::Dynamic, 3> positions;
+  /// Color of each point. If empty, color is used for all points.
+  Eigen::Matrix<float, Eigen::Dynamic, 3> colors;
+
+  Length scale{1 * milli * meter};
+  /// Radius of the points relative to scale
+  Scale radius = 0.5f;
+
+  /// Number of points per chunk
+  std::size_t pointsPerChunk{4096};
+};
+
+/// A geometry descriptor describing many polylines, e.g. fiber tracts or
+/// vessel centerlines. All lines are stored in a single buffer and rendered
+/// with one draw call, with a constant width in pixels.
+///
+/// When picked, the index of the line under the cursor is recorded and the
+/// line is highlighted.
+class PolylineDescriptor : public GeometryDescriptor {
+public:
+  virtual ~PolylineDescriptor();
+
+  PolylineDescriptor() = default;
+  PolylineDescriptor(PolylineDescriptor const &) = default;
+  PolylineDescriptor(PolylineDescriptor &&) = default;
+
+  PolylineDescriptor &operator=(PolylineDescriptor const &) = default;
+  PolylineDescriptor &operator=(PolylineDescriptor &&) = default;
+
+  /// Vertices of all lines, one line after the other
+  Eigen::Matrix<float, Eigen::Dynamic, 3> vertices;
+  /// Number of vertices of each line, must add up to vertices.rows()
+  std::vector<std::uint32_t> lineLengths;
+
+  /// Scalar of each vertex. If empty, color is used for all lines, otherwise
+  /// the scalars are mapped from scalarRange to [minColor, maxColor].
+  Eigen::Matrix<float, Eigen::Dynamic, 1> scalars;
+  Range<float> scalarRange{0.f, 1.f};
+  Color minColor{Colors::Blue()};
+  Color maxColor{Colors::Red()};
+
+  Length scale{1 * milli * meter};
+  /// Width of the lines in pixels
+  float width{2.f};
+
+  /// If set, the lines are appended to the existing lines, e.g. while
+  /// streaming tracking results. Only vertices, lineLengths and scalars are
+  /// used then; scalars must be given if the existing lines have scalars.
+  bool append{false};
+};
+
 } // namespace VolViz
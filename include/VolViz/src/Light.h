@@ -3,20 +3,35 @@
 
 #include "Types.h"
 
+#include <cmath>
+
 namespace VolViz {
 
-/// Directional light
+/// Directional, point or spot light
 class Light {
 public:
   /// Color of the light
   Color color{Color::Ones()};
-  /// Position of the light source. Since only directional light are supported,
-  /// the light is at an infinite position, therefore the position equals the
-  /// direction to the light source
+  /// Position of the light source in homogenous coordinates. If the fourth
+  /// component is 0, the light is at an infinite position, i.e. it is a
+  /// directional light and the position equals the direction to the light
+  /// source. Otherwise, it is a point or spot light at the given position,
+  /// which has the same units as the positions of the geometries.
   PositionH position{PositionH::Zero()};
 
   /// Factor that specifies how the light contributes to the ambient lighting
   float ambientFactor = 0.f;
+
+  /// Distance at which the light of a point or spot light has faded out. The
+  /// lighting pass only evaluates a light for pixels within its range.
+  float range = 1.f;
+
+  /// Direction of the cone of a spot light
+  Vector3f spotDirection{Vector3f(0, 0, -1)};
+
+  /// Half the opening angle of the cone of a spot light, in radians. Lights
+  /// with an angle of pi or more are point lights.
+  Angle spotCutoff = M_PI;
 };
 
 } // namespace VolViz
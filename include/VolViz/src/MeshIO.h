@@ -0,0 +1,26 @@
+#ifndef VolViz_MeshIO_h
+#define VolViz_MeshIO_h
+
+#include "GeometryDescriptor.h"
+
+#include <string>
+
+namespace VolViz {
+
+/// Loads a triangle mesh, the format is selected by the file extension.
+///
+/// Supported formats are PLY (ASCII and binary), STL (ASCII and binary) and
+/// OBJ. Binary files are memory mapped and decoded in parallel, ASCII files
+/// are split into chunks that are parsed in parallel. Polygons are
+/// triangulated as fans. Since STL stores every triangle separately, equal
+/// vertices are merged.
+///
+/// Only the vertices and indices of the returned descriptor are set, all
+/// other members keep their default values.
+///
+/// @throw std::runtime_error if the file cannot be read or is malformed
+MeshDescriptor loadMesh(std::string const &filename);
+
+} // namespace VolViz
+
+#endif // VolViz_MeshIO_h
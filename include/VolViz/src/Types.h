@@ -7,6 +7,7 @@
 #include <phys/units/quantity.hpp>
 
 #include <array>
+#include <vector>
 
 namespace VolViz {
 
@@ -50,6 +51,23 @@ inline auto Magenta() noexcept { return Red() + Blue(); }
 inline auto Cyan() noexcept { return Blue() + Green(); }
 }
 
+/// Maps scalars in [0, 1] to colors. The colors are distributed uniformly over
+/// [0, 1] and interpolated linearly in between.
+using Colormap = std::vector<Color>;
+
+namespace Colormaps {
+inline Colormap Gray() { return {Colors::Black(), Colors::White()}; }
+inline Colormap Rainbow() {
+  return {Colors::Blue(), Colors::Cyan(), Colors::Green(), Colors::Yellow(),
+          Colors::Red()};
+}
+/// Diverging blue to red colormap by Moreland
+inline Colormap CoolWarm() {
+  return {Color(0.230f, 0.299f, 0.754f), Color(0.865f, 0.865f, 0.865f),
+          Color(0.706f, 0.016f, 0.150f)};
+}
+}
+
 /// 6-DOF orientation, represented as a quaternion
 using Orientation = Eigen::Quaternionf;
 
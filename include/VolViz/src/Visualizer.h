@@ -11,6 +11,7 @@
 #include <Eigen/Core>
 
 #include <atomic>
+#include <chrono>
 #include <memory>
 #include <functional>
 
@@ -30,6 +31,68 @@ public:
 
   static auto constexpr kTitle = "Volume Visualizer";
 
+  /// Result of a pick query
+  struct PickResult {
+    /// Name of the hit geometry, empty if no geometry was hit
+    GeometryName geometry;
+    /// Index of the hit triangle, i.e. the row of MeshDescriptor::indices
+    std::uint32_t triangle{0};
+    /// Barycentric coordinates of the hit point with respect to the second
+    /// and third vertex of the triangle
+    Eigen::Vector2f barycentrics{Eigen::Vector2f::Zero()};
+    /// Hit point in world coordinates
+    Position position{Position::Zero()};
+
+    inline explicit operator bool() const noexcept {
+      return !geometry.empty();
+    }
+  };
+
+  /// Geometry under the cursor in selection mode
+  struct Selection {
+    /// Name of the selected geometry, empty if no geometry is selected
+    GeometryName geometry;
+    /// Index of the selected instance, i.e. the row of
+    /// InstancedCubesDescriptor::positions. Always 0 for geometry that is not
+    /// instanced.
+    std::uint32_t instance{0};
+
+    inline explicit operator bool() const noexcept {
+      return !geometry.empty();
+    }
+  };
+
+  /// Statistics of the last rendered frame
+  struct RenderStatistics {
+    /// Number of geometries in the scene
+    std::size_t geometries{0};
+    /// Number of geometries that were not rendered, since their bounding box
+    /// was outside of the view frustum
+    std::size_t culledGeometries{0};
+    /// Number of frames rendered since the visualizer was created
+    std::size_t renderedFrames{0};
+    /// Number of frames that were skipped since nothing changed, the
+    /// previous frame stayed on screen
+    std::size_t skippedFrames{0};
+    /// Mean interval between two presented frames, measured by renderAtFPS
+    std::chrono::duration<double> frameInterval{0};
+    /// Standard deviation of the interval between two presented frames,
+    /// measured by renderAtFPS
+    std::chrono::duration<double> frameIntervalJitter{0};
+    /// Number of frames renderAtFPS presented after their deadline
+    std::size_t missedFrames{0};
+    /// Scale of the render resolution relative to the window size
+    float renderScale{1.f};
+    /// Smoothed time the GPU spent rendering a frame
+    std::chrono::duration<double> gpuFrameTime{0};
+    /// Number of meshes that were optimized for rendering
+    std::size_t optimizedMeshes{0};
+    /// Mean average cache miss ratio (ACMR) of the optimized meshes before
+    /// and after the optimization, i.e. the vertices transformed per triangle
+    float cacheMissRatioBefore{0.f};
+    float cacheMissRatioAfter{0.f};
+  };
+
   Visualizer();
 
   ~Visualizer();
@@ -44,11 +107,24 @@ public:
 
   void enableMultithreading() noexcept;
 
+  /// Renders a frame if the scene, the camera or the window changed since
+  /// the last frame, otherwise the frame is skipped and only the events are
+  /// processed
   void renderOneFrame();
 
+  /// Like renderOneFrame, but waits for events afterwards. Any change of the
+  /// scene or the camera, also from other threads, ends the wait.
   void renderOneFrameAndWaitForEvents();
 
-  void renderAtFPS(double fps = 60.0);
+  /// Renders frames at a fixed rate until the window is closed. With vsync
+  /// the rate is rounded to an integer fraction of the refresh rate.
+  ///
+  /// @param fps the target frame rate
+  /// @param lowLatency if true, each frame is started as late as possible to
+  /// still be presented in time, so that the input is processed shortly
+  /// before the frame is shown. The start adapts to the time it takes to
+  /// render a frame.
+  void renderAtFPS(double fps = 60.0, bool lowLatency = false);
 
   void renderOnUserInteraction(double maxFps = 60.0);
 
@@ -69,15 +145,56 @@ public:
                 GeometryDescriptor, std::decay_t<Descriptor>>::value>>
   bool updateGeometry(GeometryName name, Descriptor &&geom);
 
-  std::atomic<bool> showGrid{true};
-  std::atomic<bool> showVolumeBoundingBox{true};
+  /// Finds the mesh triangle under a position in the window, given in pixels
+  /// relative to the top left corner like the cursor position. Only meshes
+  /// are hit.
+  ///
+  /// The query runs on the CPU against the scene as it was rendered in the
+  /// last frame, without waiting for the render thread. Meshes can be picked
+  /// once their BVH was built in the background after adding or updating
+  /// them.
+  PickResult pick(Position2 const &windowPosition) const;
+
+  /// Returns the geometry and the instance that were selected by the cursor
+  /// in the last frame. Can be called from any thread.
+  Selection selection() const;
+
+  /// Returns the statistics of the last rendered frame and the number of
+  /// rendered and skipped frames
+  RenderStatistics renderStatistics() const;
+
+  AtomicProperty<bool> showGrid{true};
+  AtomicProperty<bool> showVolumeBoundingBox{true};
   AtomicProperty<Length> scale{1 * milli * meter};
   AtomicProperty<Color> backgroundColor{Colors::Black()};
 
+  /// GPU time per frame the render resolution is scaled down to hold, the
+  /// image is then upscaled to the window size. Zero disables the scaling.
+  AtomicProperty<std::chrono::duration<double>> targetFrameTime{
+      std::chrono::duration<double>{0}};
+
+  /// If true, frames are rendered at a lower resolution and with coarser
+  /// meshes while the user moves the camera or a geometry with the mouse.
+  /// Programmatic camera changes render at full quality. Once the interaction
+  /// stopped for the refinement delay, the quality is refined over the next
+  /// frames, which are finally accumulated to smooth the edges.
+  AtomicProperty<bool> progressiveRefinement{true};
+  AtomicProperty<std::chrono::duration<double>> refinementDelay{
+      std::chrono::duration<double>{0.2}};
+
+  /// If true, the G-buffer stores the normals in RG16_SNORM and the material
+  /// in RG8 textures, and the lit image is stored in R11G11B10F. This more
+  /// than halves the memory and bandwidth of the render targets at a slightly
+  /// lower precision. Otherwise, they are stored as 32 bit floats.
+  AtomicProperty<bool> compactGBuffer{false};
+
   /// The camera
   Camera camera;
 
 private:
+  /// Connects the properties to the change tracking of the implementation
+  void observeProperties();
+
   std::unique_ptr<Private_::VisualizerImpl> impl_;
 };
 
@@ -92,6 +209,14 @@ Visualizer::addGeometry<CubeDescriptor>(GeometryName, CubeDescriptor const &);
 extern template void
 Visualizer::addGeometry<MeshDescriptor>(GeometryName, MeshDescriptor const &);
 
+extern template void Visualizer::addGeometry<InstancedCubesDescriptor>(
+    GeometryName, InstancedCubesDescriptor const &);
+
+extern template void Visualizer::addGeometry<PointCloudDescriptor>(
+    GeometryName, PointCloudDescriptor const &);
+extern template void Visualizer::addGeometry<PolylineDescriptor>(
+    GeometryName, PolylineDescriptor const &);
+
 extern template void
 Visualizer::setVolume<float const>(VolumeDescriptor const &, span<float const>);
 extern template void
@@ -125,6 +250,27 @@ extern template bool
 Visualizer::updateGeometry<MeshDescriptor &>(GeometryName name,
                                              MeshDescriptor &);
 
+extern template bool
+Visualizer::updateGeometry<InstancedCubesDescriptor const &>(
+    GeometryName name, InstancedCubesDescriptor const &);
+extern template bool Visualizer::updateGeometry<InstancedCubesDescriptor &&>(
+    GeometryName name, InstancedCubesDescriptor &&);
+extern template bool Visualizer::updateGeometry<InstancedCubesDescriptor &>(
+    GeometryName name, InstancedCubesDescriptor &);
+
+extern template bool Visualizer::updateGeometry<PointCloudDescriptor const &>(
+    GeometryName name, PointCloudDescriptor const &);
+extern template bool Visualizer::updateGeometry<PointCloudDescriptor &&>(
+    GeometryName name, PointCloudDescriptor &&);
+extern template bool Visualizer::updateGeometry<PointCloudDescriptor &>(
+    GeometryName name, PointCloudDescriptor &);
+extern template bool Visualizer::updateGeometry<PolylineDescriptor const &>(
+    GeometryName name, PolylineDescriptor const &);
+extern template bool Visualizer::updateGeometry<PolylineDescriptor &&>(
+    GeometryName name, PolylineDescriptor &&);
+extern template bool Visualizer::updateGeometry<PolylineDescriptor &>(
+    GeometryName name, PolylineDescriptor &);
+
 } // namespace VolViz
 
 #endif // VolViz_Visualizer_h